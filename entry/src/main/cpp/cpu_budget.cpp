@@ -0,0 +1,302 @@
+#include "cpu_budget.h"
+
+#include "ggml-cpu.h"
+#include "cpu.h" // ncnn::CpuSet / set_cpu_thread_affinity
+#include <hilog/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#undef LOG_DOMAIN
+#undef LOG_TAG
+#define LOG_DOMAIN 0x0000
+#define LOG_TAG "CPU_BUDGET"
+#define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+
+static const char* kEngineNames[CPU_ENGINE_COUNT] = {"asr", "llm", "tts"};
+static const char* kPhaseNames[3] = {"listening", "thinking", "speaking"};
+
+static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 当前进程的所有线程 ID
+static std::vector<int> ListThreads() {
+    std::vector<int> tids;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return tids;
+    while (struct dirent* ent = readdir(dir)) {
+        int tid = atoi(ent->d_name);
+        if (tid > 0) tids.push_back(tid);
+    }
+    closedir(dir);
+    std::sort(tids.begin(), tids.end());
+    return tids;
+}
+
+// 线程累计 CPU 时间 (utime + stime)，线程已退出时返回 -1
+static int64_t ThreadCpuMs(int tid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char buf[512];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // 线程名里可能有空格，从最后一个 ')' 之后开始数：第 3 个字段起，utime/stime 是第 14/15 个
+    char* p = strrchr(buf, ')');
+    if (!p) return -1;
+    unsigned long long utime = 0, stime = 0;
+    if (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return -1;
+    }
+    static const long ticks = sysconf(_SC_CLK_TCK);
+    return (int64_t)((utime + stime) * 1000 / (ticks > 0 ? ticks : 100));
+}
+
+CpuBudget::CpuBudget() {
+    num_cores = std::max(1, ncnn::get_cpu_count());
+    phase_since_ms = NowMs();
+    LOGI("🧮 CPU 预算: %{public}d 核", num_cores);
+}
+
+int CpuBudget::Threads(CpuEngine engine) const {
+    const int n = num_cores;
+    int asr = 1, llm = 1, tts = 1;
+    switch (phase.load()) {
+        case PHASE_LISTENING:
+            // 用户在说话：ASR 优先，LLM 用剩下的核做投机 prefill
+            asr = std::max(1, n / 2);
+            llm = std::max(1, n - asr);
+            break;
+        case PHASE_THINKING:
+            // 用户说完了：ASR 只留一个核收尾，其余给 LLM prefill/生成
+            llm = std::max(1, n - 1);
+            break;
+        case PHASE_SPEAKING:
+            // 边生成边播报：ASR 留一个核检测插话，TTS 和 LLM 分剩下的
+            // 回复已经生成完、只剩播报时，LLM 的核也给 TTS
+            if (active[CPU_ENGINE_LLM]) {
+                tts = std::max(1, (n - 1) / 3);
+                llm = std::max(1, n - asr - tts);
+            } else {
+                tts = std::max(1, n - asr);
+            }
+            break;
+    }
+    switch (engine) {
+        case CPU_ENGINE_ASR: return asr;
+        case CPU_ENGINE_LLM: return llm;
+        case CPU_ENGINE_TTS: return tts;
+        default: return 1;
+    }
+}
+
+// 各引擎的核心区间：ASR 固定用最高编号的核，TTS 紧挨着它，LLM 从 0 号核往上
+void CpuBudget::CoreSlice(CpuEngine engine, int* first, int* count) const {
+    const int n = num_cores;
+    int asr = Threads(CPU_ENGINE_ASR);
+    int tts = Threads(CPU_ENGINE_TTS);
+    if (engine == CPU_ENGINE_LLM) {
+        *first = 0;
+        *count = std::min(n, Threads(CPU_ENGINE_LLM));
+        return;
+    }
+    if (engine == CPU_ENGINE_ASR) {
+        *first = n - asr;
+        *count = asr;
+        return;
+    }
+    *count = tts;
+    switch (phase.load()) {
+        case PHASE_SPEAKING:
+            *first = std::max(0, n - asr - tts);
+            break;
+        case PHASE_THINKING:
+            // ASR 基本空闲，和它共用
+            *first = std::max(0, n - tts);
+            break;
+        default:
+            // 插话时 TTS 已被打断，放在 LLM 的第一个核上
+            *first = 0;
+            break;
+    }
+}
+
+void CpuBudget::Recompute() {
+    PipelinePhase next = PHASE_LISTENING;
+    if (active[CPU_ENGINE_TTS]) {
+        next = PHASE_SPEAKING;
+    } else if (active[CPU_ENGINE_LLM]) {
+        next = PHASE_THINKING;
+    }
+    PipelinePhase prev = phase.exchange(next);
+    bool llm_on = active[CPU_ENGINE_LLM];
+    bool llm_changed = speaking_llm.exchange(llm_on) != llm_on;
+    if (prev == next) {
+        // 播报中 LLM 生成完 (或又开始生成)：阶段不变，但 TTS 和 LLM 的核要重新分
+        if (next == PHASE_SPEAKING && llm_changed) {
+            generation++;
+            LOGI("🧮 播报中 LLM %{public}s (llm=%{public}d tts=%{public}d)", llm_on ? "开始生成" : "生成完",
+                 Threads(CPU_ENGINE_LLM), Threads(CPU_ENGINE_TTS));
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mtx);
+        int64_t now = NowMs();
+        phase_ms[prev] += now - phase_since_ms;
+        phase_since_ms = now;
+    }
+    generation++;
+    LOGI("🧮 阶段 %{public}s -> %{public}s (asr=%{public}d llm=%{public}d tts=%{public}d)",
+         kPhaseNames[prev], kPhaseNames[next],
+         Threads(CPU_ENGINE_ASR), Threads(CPU_ENGINE_LLM), Threads(CPU_ENGINE_TTS));
+}
+
+void CpuBudget::SetActive(CpuEngine engine, bool on) {
+    if (active[engine].exchange(on) != on) Recompute();
+}
+
+bool CpuBudget::Poll(CpuEngine engine, uint32_t* seen, int* threads) {
+    uint32_t g = generation.load();
+    if (*seen == g) return false;
+    *seen = g;
+    *threads = Threads(engine);
+    return true;
+}
+
+void CpuBudget::TrackNewThreads(CpuEngine engine, const std::vector<int>& before) {
+    std::vector<int> after = ListThreads();
+    std::lock_guard<std::mutex> lock(stats_mtx);
+    std::vector<int>& tids = engine_tids[engine];
+    // 换掉的线程池留下的线程已退出，不再统计
+    tids.erase(std::remove_if(tids.begin(), tids.end(), [&after](int tid) {
+        return !std::binary_search(after.begin(), after.end(), tid);
+    }), tids.end());
+    for (int tid : after) {
+        if (std::binary_search(before.begin(), before.end(), tid)) continue;
+        if (std::find(tids.begin(), tids.end(), tid) == tids.end()) tids.push_back(tid);
+    }
+}
+
+void CpuBudget::ApplyAffinity(CpuEngine engine, int threads) {
+    int first = 0;
+    int count = 0;
+    CoreSlice(engine, &first, &count);
+
+    ncnn::CpuSet mask;
+    mask.disable_all();
+    for (int i = 0; i < count && first + i < num_cores; i++) mask.enable(first + i);
+
+    // OpenMP 线程组第一次扩容时会新建线程，记到这个引擎名下
+    std::vector<int> before = ListThreads();
+    if (ncnn::set_cpu_thread_affinity(mask) != 0) {
+        LOGE("⚠️ %{public}s 绑核失败", kEngineNames[engine]);
+    }
+    TrackNewThreads(engine, before);
+    LOGI("🧮 %{public}s: %{public}d 线程 @ cpu[%{public}d..%{public}d]",
+         kEngineNames[engine], threads, first, first + count - 1);
+}
+
+void CpuBudget::RegisterCurrentThread(CpuEngine engine) {
+    int tid = (int)syscall(SYS_gettid);
+    std::lock_guard<std::mutex> lock(stats_mtx);
+    std::vector<int>& tids = engine_tids[engine];
+    if (std::find(tids.begin(), tids.end(), tid) == tids.end()) tids.push_back(tid);
+}
+
+void CpuBudget::AttachLlama(llama_context* ctx) {
+    int first = 0;
+    int count = 0;
+    CoreSlice(CPU_ENGINE_LLM, &first, &count);
+    if (!llm_pool || first != llm_first || count != llm_count) {
+        // 线程数等于区间的核数，strict_cpu 让每个线程固定在区间内的一个核上，不会漂到 ASR/TTS 的核；
+        // poll = 0：图计算间隙线程直接睡眠，不再自旋；
+        // paused：调用线程 (nativeLoad 时是 JS 线程) 不绑核，等第一次计算时才绑 LLM 线程
+        struct ggml_threadpool_params params = ggml_threadpool_params_default(count);
+        for (int i = 0; i < count && first + i < GGML_MAX_N_THREADS; i++) params.cpumask[first + i] = true;
+        params.strict_cpu = true;
+        params.poll = 0;
+        params.paused = true;
+        std::vector<int> before = ListThreads();
+        struct ggml_threadpool* pool = ggml_threadpool_new(&params);
+        if (!pool) {
+            LOGE("❌ ggml 线程池创建失败，%{public}s", llm_pool ? "沿用旧线程池" : "使用 llama 默认线程池");
+            if (!llm_pool) return;
+        } else {
+            TrackNewThreads(CPU_ENGINE_LLM, before);
+            // llama 每次计算前才把线程池交给 CPU 后端，先挂新的再释放旧的
+            llama_attach_threadpool(ctx, pool, pool);
+            if (llm_pool) ggml_threadpool_free(llm_pool);
+            llm_pool = pool;
+            llm_first = first;
+            llm_count = count;
+            LOGI("🧮 llm: %{public}d 线程 @ cpu[%{public}d..%{public}d]", count, first, first + count - 1);
+        }
+    }
+    llama_attach_threadpool(ctx, llm_pool, llm_pool);
+    llama_set_n_threads(ctx, llm_count, llm_count);
+}
+
+void CpuBudget::DetachLlama(llama_context* ctx) {
+    if (ctx && llm_pool) llama_detach_threadpool(ctx);
+}
+
+std::string CpuBudget::Report() {
+    std::vector<int> tids[CPU_ENGINE_COUNT];
+    int64_t phases[3];
+    PipelinePhase cur = phase.load();
+    {
+        std::lock_guard<std::mutex> lock(stats_mtx);
+        for (int e = 0; e < CPU_ENGINE_COUNT; e++) tids[e] = engine_tids[e];
+        std::copy(std::begin(phase_ms), std::end(phase_ms), phases);
+        phases[cur] += NowMs() - phase_since_ms;
+    }
+
+    std::string report;
+    char line[160];
+    snprintf(line, sizeof(line), "phase: %s (cores=%d)\n", kPhaseNames[cur], num_cores);
+    report += line;
+
+    int64_t attributed = 0;
+    for (int e = 0; e < CPU_ENGINE_COUNT; e++) {
+        int64_t ms = 0;
+        int alive = 0;
+        for (int tid : tids[e]) {
+            int64_t t = ThreadCpuMs(tid);
+            if (t < 0) continue;
+            ms += t;
+            alive++;
+        }
+        attributed += ms;
+        snprintf(line, sizeof(line), "%s: cpu %lld ms, %d threads, budget %d\n",
+                 kEngineNames[e], (long long)ms, alive, Threads((CpuEngine)e));
+        report += line;
+    }
+
+    struct rusage ru = {};
+    getrusage(RUSAGE_SELF, &ru);
+    int64_t total = (int64_t)ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000 +
+                    (int64_t)ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000;
+    snprintf(line, sizeof(line), "process: cpu %lld ms (other %lld ms)\n",
+             (long long)total, (long long)std::max<int64_t>(0, total - attributed));
+    report += line;
+
+    for (int p = 0; p < 3; p++) {
+        snprintf(line, sizeof(line), "time in %s: %lld ms\n", kPhaseNames[p], (long long)phases[p]);
+        report += line;
+    }
+    return report;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "llama.h"
+
+// ==========================================
+// CPU 核心预算
+// ASR (ncnn/OpenMP)、LLM (ggml 线程池)、TTS (ncnn/OpenMP) 三个引擎的线程数和绑核
+// 统一由这里决定，按流水线阶段动态调整，避免同时跑时互相抢核
+// ==========================================
+
+enum CpuEngine {
+    CPU_ENGINE_ASR = 0,
+    CPU_ENGINE_LLM,
+    CPU_ENGINE_TTS,
+    CPU_ENGINE_COUNT
+};
+
+// 阶段由引擎活动状态推导：TTS 在合成 -> SPEAKING，否则 LLM 在生成 -> THINKING，否则 LISTENING
+enum PipelinePhase {
+    PHASE_LISTENING = 0,
+    PHASE_THINKING,
+    PHASE_SPEAKING
+};
+
+class CpuBudget {
+public:
+    static CpuBudget& Instance() {
+        static CpuBudget instance;
+        return instance;
+    }
+
+    int NumCores() const { return num_cores; }
+    PipelinePhase Phase() const { return phase.load(); }
+
+    // 引擎开始/结束一段工作 (LLM 只在正式回复时标记，投机 prefill 不算)
+    void SetActive(CpuEngine engine, bool active);
+
+    // 当前阶段分给引擎的线程数
+    int Threads(CpuEngine engine) const;
+
+    // 引擎线程在每批计算前调用：预算变化后返回 true 并给出新的线程数
+    // generation 由调用方保存，初始为 0
+    bool Poll(CpuEngine engine, uint32_t* generation, int* threads);
+
+    // ncnn 引擎：在引擎自己的线程里调用，把当前线程及其 OpenMP 线程组绑到分到的核心上
+    void ApplyAffinity(CpuEngine engine, int threads);
+
+    // 引擎工作线程启动时登记，用于统计 CPU 时间
+    void RegisterCurrentThread(CpuEngine engine);
+
+    // LLM：按当前阶段的 LLM 核心区间建显式 ggml 线程池 (不自旋，每个线程固定一个核) 并挂到 context 上
+    // 阶段变化后 LLM 线程在两次 decode 之间再调用一次，区间变了就换线程池；重新加载模型前先 Detach
+    void AttachLlama(llama_context* ctx);
+    void DetachLlama(llama_context* ctx);
+
+    // 各引擎 CPU 时间 (线程级 utime + stime) 与阶段统计
+    std::string Report();
+
+private:
+    CpuBudget();
+
+    void Recompute();
+    void CoreSlice(CpuEngine engine, int* first, int* count) const;
+    void TrackNewThreads(CpuEngine engine, const std::vector<int>& before);
+
+    int num_cores = 1;
+    std::atomic<bool> active[CPU_ENGINE_COUNT] = {};
+    std::atomic<PipelinePhase> phase{PHASE_LISTENING};
+    std::atomic<uint32_t> generation{1};
+    std::atomic<bool> speaking_llm{false};  // 上次分配时 LLM 是否在生成，播报中它变了也要重新分
+
+    struct ggml_threadpool* llm_pool = nullptr;
+    int llm_first = 0;   // llm_pool 绑定的核心区间
+    int llm_count = 0;
+
+    // 统计
+    std::mutex stats_mtx;
+    std::vector<int> engine_tids[CPU_ENGINE_COUNT];
+    int64_t phase_ms[3] = {};
+    int64_t phase_since_ms = 0;
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a 64，缓存文件名和模型指纹用，不需要抗碰撞
+// 可以接着上一段的结果继续算：h = Fnv1a(b, nb, Fnv1a(a, na))
+inline uint64_t Fnv1a(const void* data, size_t len, uint64_t h = 1469598103934665603ULL) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
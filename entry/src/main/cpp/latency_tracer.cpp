@@ -0,0 +1,251 @@
+#include "latency_tracer.h"
+
+#include "sherpa-ncnn/csrc/net-timing.h"
+#include <hilog/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#undef LOG_DOMAIN
+#undef LOG_TAG
+#define LOG_DOMAIN 0x0000
+#define LOG_TAG "LATENCY"
+#define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+
+static const char* kEventNames[TURN_EVENT_COUNT] = {
+    "first_audio", "last_audio", "asr_final", "prompt_tokenized", "prefill_done",
+    "first_token", "first_tts_sentence", "first_pcm", "last_pcm",
+};
+
+struct LatencyStage {
+    const char* name;
+    TurnEvent from;
+    TurnEvent to;
+};
+
+// 各阶段的起止事件；起点缺失的阶段不记录 (比如文字提问没有音频)
+static const LatencyStage kStages[] = {
+    {"speech", TURN_FIRST_AUDIO, TURN_LAST_AUDIO},
+    {"asr_final", TURN_LAST_AUDIO, TURN_ASR_FINAL},
+    {"tokenize", TURN_ASR_FINAL, TURN_PROMPT_TOKENIZED},
+    {"prefill", TURN_PROMPT_TOKENIZED, TURN_PREFILL_DONE},
+    {"first_token", TURN_PREFILL_DONE, TURN_FIRST_TOKEN},
+    {"first_tts_sentence", TURN_FIRST_TOKEN, TURN_FIRST_SENTENCE},
+    {"tts_first_pcm", TURN_FIRST_SENTENCE, TURN_FIRST_PCM},
+    {"tts_total", TURN_FIRST_SENTENCE, TURN_LAST_PCM},
+    {"speech_end_to_first_pcm", TURN_LAST_AUDIO, TURN_FIRST_PCM},
+    {"request_to_first_pcm", TURN_ASR_FINAL, TURN_FIRST_PCM},
+};
+static_assert(sizeof(kStages) / sizeof(kStages[0]) == 10, "kStageCount 与阶段表不一致");
+
+// 会话 ID 来自 JS，拼进 JSON 前转义
+static std::string JsonEscape(const std::string& in) {
+    std::string out;
+    for (char c : in) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c >= 0x20) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ==========================================
+// LatencyHistogram
+// ==========================================
+
+int LatencyHistogram::BucketIndex(int64_t us) {
+    if (us < kSubBuckets) return (int)std::max<int64_t>(us, 0);
+    int msb = 63 - __builtin_clzll((unsigned long long)us); // >= 3
+    int shift = msb - 3;
+    int sub = (int)((us >> shift) & (kSubBuckets - 1));
+    int index = kSubBuckets + shift * kSubBuckets + sub;
+    return std::min(index, kBuckets - 1);
+}
+
+int64_t LatencyHistogram::BucketUpper(int index) {
+    if (index < kSubBuckets) return index;
+    int shift = (index - kSubBuckets) / kSubBuckets;
+    int sub = (index - kSubBuckets) % kSubBuckets;
+    return ((int64_t)(kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t us) {
+    if (us < 0) us = 0;
+    counts[BucketIndex(us)]++;
+    if (count == 0 || us < min_us) min_us = us;
+    if (us > max_us) max_us = us;
+    count++;
+    sum_us += us;
+}
+
+int64_t LatencyHistogram::Percentile(double p) const {
+    if (count == 0) return 0;
+    int64_t rank = (int64_t)(p / 100.0 * count + 0.5);
+    rank = std::min(std::max<int64_t>(rank, 1), count);
+    int64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(BucketUpper(i), max_us);
+    }
+    return max_us;
+}
+
+// ==========================================
+// LatencyTracer
+// ==========================================
+
+void LatencyTracer::SetEvent(Turn& turn, TurnEvent event, int64_t now) {
+    bool last = (event == TURN_LAST_AUDIO || event == TURN_LAST_PCM);
+    if (turn.Has(event) && !last) return;
+    if (turn.id == 0) turn.id = next_turn_id++;
+    turn.t[event] = now;
+    if (!last) RecordStages(turn, event);
+}
+
+void LatencyTracer::RecordStages(const Turn& turn, TurnEvent to) {
+    for (int i = 0; i < kStageCount; i++) {
+        const LatencyStage& st = kStages[i];
+        if (st.to != to || !turn.Has(st.from) || !turn.Has(st.to)) continue;
+        stage_hist[i].Record(turn.t[st.to] - turn.t[st.from]);
+    }
+}
+
+void LatencyTracer::CloseTurn(const std::string& sessionId, Turn& turn) {
+    if (turn.id == 0) return;
+    RecordStages(turn, TURN_LAST_PCM);
+
+    ClosedTurn& slot = recent[recent_next];
+    slot.session = sessionId;
+    slot.turn = turn;
+    recent_next = (recent_next + 1) % kRecentTurns;
+    recent_count = std::min(recent_count + 1, kRecentTurns);
+    turn = Turn();
+}
+
+void LatencyTracer::OnAudio(const std::string& sessionId) {
+    int64_t now = NowUs();
+    std::lock_guard<std::mutex> lock(mtx);
+    Turn& turn = sessions[sessionId].listening;
+    SetEvent(turn, TURN_FIRST_AUDIO, now);
+    SetEvent(turn, TURN_LAST_AUDIO, now);
+}
+
+void LatencyTracer::OnRequest(const std::string& sessionId) {
+    int64_t now = NowUs();
+    std::lock_guard<std::mutex> lock(mtx);
+    SessionTurns& st = sessions[sessionId];
+    // 上一轮的回复到此结束 (被打断或已经播完)
+    CloseTurn(sessionId, st.responding);
+    st.responding = st.listening;
+    st.listening = Turn();
+    RecordStages(st.responding, TURN_LAST_AUDIO);
+    SetEvent(st.responding, TURN_ASR_FINAL, now);
+}
+
+void LatencyTracer::Mark(const std::string& sessionId, TurnEvent event) {
+    int64_t now = NowUs();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = sessions.find(sessionId);
+    // 只追踪由 OnRequest 开始的回复 (投机 prefill 等不算)
+    if (it == sessions.end() || it->second.responding.id == 0) return;
+    SetEvent(it->second.responding, event, now);
+}
+
+void LatencyTracer::Release(const std::string& sessionId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = sessions.find(sessionId);
+    if (it == sessions.end()) return;
+    CloseTurn(sessionId, it->second.responding);
+    sessions.erase(it);
+}
+
+void LatencyTracer::SetLlamaPerf(const llama_perf_context_data& perf) {
+    std::lock_guard<std::mutex> lock(mtx);
+    llama_perf = perf;
+    has_llama_perf = true;
+}
+
+std::string LatencyTracer::Report() {
+    std::string out = "{";
+    char buf[256];
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // 1. 最近的轮次：各事件相对本轮第一个事件的毫秒数，未发生为 null
+    out += "\"turns\":[";
+    for (int i = 0; i < recent_count; i++) {
+        int idx = (recent_next - recent_count + i + kRecentTurns) % kRecentTurns;
+        const ClosedTurn& ct = recent[idx];
+        int64_t base = 0;
+        for (int e = 0; e < TURN_EVENT_COUNT; e++) {
+            if (ct.turn.t[e] != 0 && (base == 0 || ct.turn.t[e] < base)) base = ct.turn.t[e];
+        }
+        // 字符串直接拼接，snprintf 只格式化数字：转义后的会话 ID 可能超出 buf
+        snprintf(buf, sizeof(buf), "%s{\"id\":%llu,\"session\":\"", i ? "," : "",
+                 (unsigned long long)ct.turn.id);
+        out += buf;
+        out += JsonEscape(ct.session);
+        out += "\"";
+        for (int e = 0; e < TURN_EVENT_COUNT; e++) {
+            if (ct.turn.t[e] == 0) {
+                snprintf(buf, sizeof(buf), ",\"%s\":null", kEventNames[e]);
+            } else {
+                snprintf(buf, sizeof(buf), ",\"%s\":%.3f", kEventNames[e], (ct.turn.t[e] - base) / 1000.0);
+            }
+            out += buf;
+        }
+        out += "}";
+    }
+    out += "],";
+
+    // 2. 阶段直方图 (ms)
+    out += "\"stages\":{";
+    for (int i = 0; i < kStageCount; i++) {
+        const LatencyHistogram& h = stage_hist[i];
+        snprintf(buf, sizeof(buf),
+                 "%s\"%s\":{\"count\":%lld,\"min\":%.3f,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                 i ? "," : "", kStages[i].name, (long long)h.Count(), h.Min() / 1000.0, h.Mean() / 1000.0,
+                 h.Percentile(50) / 1000.0, h.Percentile(90) / 1000.0, h.Percentile(99) / 1000.0,
+                 h.Max() / 1000.0);
+        out += buf;
+    }
+    out += "},";
+
+    // 3. llama_perf_context (上一次回复结束时的累计值)
+    if (has_llama_perf) {
+        const llama_perf_context_data& p = llama_perf;
+        snprintf(buf, sizeof(buf),
+                 "\"llama\":{\"load_ms\":%.3f,\"prompt_eval_ms\":%.3f,\"prompt_tokens\":%d,"
+                 "\"eval_ms\":%.3f,\"eval_tokens\":%d,\"graph_reused\":%d,"
+                 "\"prompt_tok_per_s\":%.2f,\"eval_tok_per_s\":%.2f},",
+                 p.t_load_ms, p.t_p_eval_ms, p.n_p_eval, p.t_eval_ms, p.n_eval, p.n_reused,
+                 p.t_p_eval_ms > 0 ? p.n_p_eval * 1000.0 / p.t_p_eval_ms : 0.0,
+                 p.t_eval_ms > 0 ? p.n_eval * 1000.0 / p.t_eval_ms : 0.0);
+        out += buf;
+    } else {
+        out += "\"llama\":null,";
+    }
+
+    // 4. ncnn 各网络累计耗时
+    out += "\"ncnn\":{";
+    std::vector<sherpa_ncnn::NetTimingStats> nets = sherpa_ncnn::GetNetTimings();
+    for (size_t i = 0; i < nets.size(); i++) {
+        const sherpa_ncnn::NetTimingStats& n = nets[i];
+        out += i ? ",\"" : "\"";
+        out += JsonEscape(n.name);
+        snprintf(buf, sizeof(buf), "\":{\"calls\":%lld,\"total_ms\":%.3f,\"mean_ms\":%.3f,\"max_ms\":%.3f}",
+                 (long long)n.calls, n.total_us / 1000.0,
+                 n.calls ? n.total_us / 1000.0 / n.calls : 0.0, n.max_us / 1000.0);
+        out += buf;
+    }
+    out += "}}";
+    return out;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "llama.h"
+
+// ==========================================
+// 语音轮次延迟追踪
+// 每个会话每轮记录一组单调时钟时间戳，阶段耗时进 HDR 风格直方图，
+// 连同 llama_perf_context 和 ncnn 各网络耗时一起由 getMetrics() 导出
+// ==========================================
+
+enum TurnEvent {
+    TURN_FIRST_AUDIO = 0,   // 第一个音频包
+    TURN_LAST_AUDIO,        // 最后一个音频包
+    TURN_ASR_FINAL,         // 最终识别结果交给 LLM (文字提问时为收到提问)
+    TURN_PROMPT_TOKENIZED,  // 用户输入分词完成
+    TURN_PREFILL_DONE,      // prefill 完成
+    TURN_FIRST_TOKEN,       // 第一个生成 token
+    TURN_FIRST_SENTENCE,    // 第一句送入 TTS 队列
+    TURN_FIRST_PCM,         // 第一段 PCM 可取
+    TURN_LAST_PCM,          // 最后一段 PCM 可取
+    TURN_EVENT_COUNT
+};
+
+// 对数-线性分桶的延迟直方图 (微秒)：每个 2 的幂区间 8 个子桶，相对误差 < 12.5%
+class LatencyHistogram {
+public:
+    static constexpr int kSubBuckets = 8;
+    static constexpr int kBuckets = kSubBuckets + 38 * kSubBuckets;
+
+    void Record(int64_t us);
+    // p 取 [0, 100]，返回所在桶的上界
+    int64_t Percentile(double p) const;
+
+    int64_t Count() const { return count; }
+    int64_t Min() const { return count ? min_us : 0; }
+    int64_t Max() const { return max_us; }
+    int64_t Mean() const { return count ? sum_us / count : 0; }
+
+private:
+    static int BucketIndex(int64_t us);
+    static int64_t BucketUpper(int index);
+
+    int64_t counts[kBuckets] = {};
+    int64_t count = 0;
+    int64_t sum_us = 0;
+    int64_t min_us = 0;
+    int64_t max_us = 0;
+};
+
+class LatencyTracer {
+public:
+    static LatencyTracer& Instance() {
+        static LatencyTracer instance;
+        return instance;
+    }
+
+    // 收到音频包：上一轮已经提问过，就开始新的一轮
+    void OnAudio(const std::string& sessionId);
+    // 提问交给 LLM：聆听中的这一轮进入回复阶段，同时标记 ASR_FINAL
+    void OnRequest(const std::string& sessionId);
+    // 回复阶段的事件 (分词/prefill/token/TTS/PCM)，FIRST_* 只记第一次，LAST_* 每次覆盖
+    void Mark(const std::string& sessionId, TurnEvent event);
+    // 会话断开，结算还在进行的轮次
+    void Release(const std::string& sessionId);
+
+    // 回复结束后由 LLM 线程刷新 (getMetrics 不直接碰 llama_context)
+    void SetLlamaPerf(const llama_perf_context_data& perf);
+
+    // JSON：最近几轮的时间戳、各阶段直方图、llama 与 ncnn 统计
+    std::string Report();
+
+private:
+    LatencyTracer() = default;
+
+    struct Turn {
+        uint64_t id = 0;
+        int64_t t[TURN_EVENT_COUNT] = {}; // 单调时钟 µs，0 表示未发生
+        bool Has(TurnEvent e) const { return t[e] != 0; }
+    };
+    struct SessionTurns {
+        Turn listening;   // 正在接收音频
+        Turn responding;  // 已提问，LLM/TTS 事件记在这里
+    };
+
+    // 阶段 = 两个事件之间的耗时，见 latency_tracer.cpp 的 kStages
+    static constexpr int kStageCount = 10;
+
+    void SetEvent(Turn& turn, TurnEvent event, int64_t now);
+    // 事件的时间戳不会再变时，记录以它结尾的阶段
+    void RecordStages(const Turn& turn, TurnEvent to);
+    void CloseTurn(const std::string& sessionId, Turn& turn);
+
+    std::mutex mtx;
+    std::unordered_map<std::string, SessionTurns> sessions;
+    uint64_t next_turn_id = 1;
+
+    // 最近结束的轮次，环形保存
+    static constexpr int kRecentTurns = 16;
+    struct ClosedTurn {
+        std::string session;
+        Turn turn;
+    };
+    ClosedTurn recent[kRecentTurns];
+    int recent_next = 0;
+    int recent_count = 0;
+
+    LatencyHistogram stage_hist[kStageCount];
+    llama_perf_context_data llama_perf = {};
+    bool has_llama_perf = false;
+};
@@ -0,0 +1,170 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compare OnlineFbank with a plain scalar implementation of the same
+// pipeline (kiss_fftr + dense mel matrix) and report the speed of both.
+//
+// Usage:
+//   ./bin/benchmark-online-fbank [num_seconds]
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/feature-fbank.h"
+#include "kaldi-native-fbank/csrc/feature-window.h"
+#include "kaldi-native-fbank/csrc/mel-computations.h"
+#include "kaldi-native-fbank/csrc/online-feature.h"
+#include "kiss_fftr.h"
+
+// The same steps as FbankComputer with the default options and dither = 0,
+// written without any of the optimized building blocks
+static std::vector<float> ReferenceFbank(const knf::FbankOptions &opts,
+                                         const std::vector<float> &samples,
+                                         int32_t num_frames) {
+  const auto &frame_opts = opts.frame_opts;
+  int32_t frame_length = frame_opts.WindowSize();
+  int32_t padded_length = frame_opts.PaddedWindowSize();
+  int32_t num_fft_bins = padded_length / 2 + 1;
+  int32_t num_bins = opts.mel_opts.num_bins;
+
+  std::vector<float> window_function = knf::GetWindow(
+      frame_opts.window_type, frame_length, frame_opts.blackman_coeff);
+
+  knf::MelBanks mel_banks(opts.mel_opts, frame_opts, 1.0f);
+  std::vector<float> mel_matrix = mel_banks.GetMatrix();
+
+  kiss_fftr_cfg cfg = kiss_fftr_alloc(padded_length, 0, nullptr, nullptr);
+  std::vector<kiss_fft_cpx> spectrum(num_fft_bins);
+  std::vector<float> frame(padded_length);
+  std::vector<float> power(num_fft_bins);
+
+  std::vector<float> features(num_frames * num_bins);
+  for (int32_t f = 0; f != num_frames; ++f) {
+    int64_t start = knf::FirstSampleOfFrame(f, frame_opts);
+    std::fill(frame.begin(), frame.end(), 0);
+    std::copy(samples.begin() + start, samples.begin() + start + frame_length,
+              frame.begin());
+
+    if (frame_opts.remove_dc_offset) {
+      double sum = 0;
+      for (int32_t i = 0; i != frame_length; ++i) {
+        sum += frame[i];
+      }
+      float mean = sum / frame_length;
+      for (int32_t i = 0; i != frame_length; ++i) {
+        frame[i] -= mean;
+      }
+    }
+
+    float coeff = frame_opts.preemph_coeff;
+    for (int32_t i = frame_length - 1; i > 0; --i) {
+      frame[i] -= coeff * frame[i - 1];
+    }
+    frame[0] -= coeff * frame[0];
+
+    for (int32_t i = 0; i != frame_length; ++i) {
+      frame[i] *= window_function[i];
+    }
+
+    kiss_fftr(cfg, frame.data(), spectrum.data());
+    for (int32_t i = 0; i != num_fft_bins; ++i) {
+      power[i] = spectrum[i].r * spectrum[i].r + spectrum[i].i * spectrum[i].i;
+    }
+
+    float *out = features.data() + f * num_bins;
+    for (int32_t b = 0; b != num_bins; ++b) {
+      const float *w = mel_matrix.data() + b * num_fft_bins;
+      float energy = 0;
+      for (int32_t i = 0; i != num_fft_bins; ++i) {
+        energy += w[i] * power[i];
+      }
+      energy = std::max(energy, std::numeric_limits<float>::epsilon());
+      out[b] = std::log(energy);
+    }
+  }
+
+  kiss_fftr_free(cfg);
+  return features;
+}
+
+static double Now() {
+  using Clock = std::chrono::steady_clock;
+  return std::chrono::duration<double>(Clock::now().time_since_epoch())
+      .count();
+}
+
+int main(int32_t argc, char *argv[]) {
+  float num_seconds = argc > 1 ? atof(argv[1]) : 60;
+
+  knf::FbankOptions opts;
+  opts.frame_opts.dither = 0;
+  opts.frame_opts.samp_freq = 16000;
+  opts.mel_opts.num_bins = 80;
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-0.5, 0.5);
+  std::vector<float> samples(static_cast<int32_t>(num_seconds * 16000));
+  for (auto &s : samples) {
+    s = dist(gen);
+  }
+
+  // Feed 10 ms at a time, as the recognizer does
+  double start = Now();
+  knf::OnlineFbank fbank(opts);
+  for (size_t i = 0; i < samples.size(); i += 160) {
+    int32_t n = std::min<size_t>(160, samples.size() - i);
+    fbank.AcceptWaveform(16000, samples.data() + i, n);
+  }
+  int32_t num_frames = fbank.NumFramesReady();
+  double fbank_time = Now() - start;
+
+  start = Now();
+  std::vector<float> expected = ReferenceFbank(opts, samples, num_frames);
+  double reference_time = Now() - start;
+
+  float max_abs_diff = 0;
+  int32_t num_bins = opts.mel_opts.num_bins;
+  for (int32_t f = 0; f != num_frames; ++f) {
+    const float *frame = fbank.GetFrame(f);
+    for (int32_t b = 0; b != num_bins; ++b) {
+      float diff = std::abs(frame[b] - expected[f * num_bins + b]);
+      max_abs_diff = std::max(max_abs_diff, diff);
+    }
+  }
+
+  fprintf(stderr, "frames: %d, %d bins, %d-point FFT\n", num_frames, num_bins,
+          opts.frame_opts.PaddedWindowSize());
+  fprintf(stderr, "OnlineFbank: %.0f frames/s\n", num_frames / fbank_time);
+  fprintf(stderr, "reference:   %.0f frames/s\n",
+          num_frames / reference_time);
+  fprintf(stderr, "max abs diff: %g\n", max_abs_diff);
+
+  // Only the order of float additions differs, which moves log-mel values
+  // by well under 1e-2; anything larger is a bug in the fast path
+  if (max_abs_diff > 1e-2) {
+    fprintf(stderr, "Mismatch!\n");
+    return -1;
+  }
+
+  return 0;
+}
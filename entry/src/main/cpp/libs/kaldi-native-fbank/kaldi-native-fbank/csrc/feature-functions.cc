@@ -23,6 +23,8 @@
 #include <cstdint>
 #include <vector>
 
+#include "kaldi-native-fbank/csrc/simd.h"
+
 namespace knf {
 
 void ComputePowerSpectrum(std::vector<float> *complex_fft) {
@@ -36,7 +38,25 @@ void ComputePowerSpectrum(std::vector<float> *complex_fft) {
   float first_energy = p[0] * p[0];
   float last_energy = p[1] * p[1];  // handle this special case
 
-  for (int32_t i = 1; i < half_dim; ++i) {
+  // The computation is in-place: p[i] is written after p[2i] and p[2i+1]
+  // are read. A block of 4 outputs starting at i >= 4 only overwrites
+  // entries below 2i, which have all been read already.
+  int32_t i = 1;
+  for (; i < 4 && i < half_dim; ++i) {
+    float real = p[i * 2];
+    float im = p[i * 2 + 1];
+    p[i] = real * real + im * im;
+  }
+
+#if KNF_HAVE_NEON
+  for (; i + 4 <= half_dim; i += 4) {
+    float32x4x2_t c = vld2q_f32(p + 2 * i);
+    vst1q_f32(p + i, vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1],
+                               c.val[1]));
+  }
+#endif
+
+  for (; i < half_dim; ++i) {
     float real = p[i * 2];
     float im = p[i * 2 + 1];
     p[i] = real * real + im * im;
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/kaldi-math.h"
+#include "kaldi-native-fbank/csrc/simd.h"
 
 namespace knf {
 
@@ -81,7 +82,13 @@ FeatureWindowFunction::FeatureWindowFunction(const std::vector<float> &window)
 void FeatureWindowFunction::Apply(float *wave) const {
   int32_t window_size = window_.size();
   const float *p = window_.data();
-  for (int32_t k = 0; k != window_size; ++k) {
+  int32_t k = 0;
+#if KNF_HAVE_NEON
+  for (; k + 4 <= window_size; k += 4) {
+    vst1q_f32(wave + k, vmulq_f32(vld1q_f32(wave + k), vld1q_f32(p + k)));
+  }
+#endif
+  for (; k != window_size; ++k) {
     wave[k] *= p[k];
   }
 }
@@ -202,20 +209,43 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
 
 static void RemoveDcOffset(float *d, int32_t n) {
   float sum = 0;
-  for (int32_t i = 0; i != n; ++i) {
+  int32_t i = 0;
+#if KNF_HAVE_NEON
+  float32x4_t acc = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4) {
+    acc = vaddq_f32(acc, vld1q_f32(d + i));
+  }
+  sum = HorizontalSum(acc);
+#endif
+  for (; i != n; ++i) {
     sum += d[i];
   }
 
   float mean = sum / n;
 
-  for (int32_t i = 0; i != n; ++i) {
+  i = 0;
+#if KNF_HAVE_NEON
+  float32x4_t vmean = vdupq_n_f32(mean);
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(d + i, vsubq_f32(vld1q_f32(d + i), vmean));
+  }
+#endif
+  for (; i != n; ++i) {
     d[i] -= mean;
   }
 }
 
 float InnerProduct(const float *a, const float *b, int32_t n) {
   float sum = 0;
-  for (int32_t i = 0; i != n; ++i) {
+  int32_t i = 0;
+#if KNF_HAVE_NEON
+  float32x4_t acc = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4) {
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+  sum = HorizontalSum(acc);
+#endif
+  for (; i != n; ++i) {
     sum += a[i] * b[i];
   }
   return sum;
@@ -239,7 +269,18 @@ static void Preemphasize(float *d, int32_t n, float preemph_coeff) {
 
   KNF_CHECK(preemph_coeff >= 0.0 && preemph_coeff <= 1.0);
 
-  for (int32_t i = n - 1; i > 0; --i) {
+  int32_t i = n - 1;
+#if KNF_HAVE_NEON
+  // Go downwards in blocks of 4 so that d[i - 4 .. i - 1] still hold the
+  // original samples when the block d[i - 3 .. i] is updated
+  float32x4_t coeff = vdupq_n_f32(preemph_coeff);
+  for (; i >= 4; i -= 4) {
+    float32x4_t cur = vld1q_f32(d + i - 3);
+    float32x4_t prev = vld1q_f32(d + i - 4);
+    vst1q_f32(d + i - 3, vmlsq_f32(cur, prev, coeff));
+  }
+#endif
+  for (; i > 0; --i) {
     d[i] -= preemph_coeff * d[i - 1];
   }
   d[0] -= preemph_coeff * d[0];
@@ -29,6 +29,7 @@
 #include "kaldi-native-fbank/csrc/feature-window.h"
 #include "kaldi-native-fbank/csrc/kaldi-math.h"
 #include "kaldi-native-fbank/csrc/log.h"
+#include "kaldi-native-fbank/csrc/simd.h"
 
 namespace knf {
 
@@ -117,6 +118,7 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
   } else {
     InitKaldiMelBanks(opts, frame_opts, vtln_warp_factor);
   }
+  PackWeights();
 }
 
 void MelBanks::InitKaldiMelBanks(const MelBanksOptions &opts,
@@ -410,6 +412,27 @@ MelBanks::MelBanks(const float *weights, int32_t num_rows, int32_t num_cols)
     bins_[bin].second.insert(bins_[bin].second.end(), this_bin + first_index,
                              this_bin + first_index + size);
   }
+  PackWeights();
+}
+
+void MelBanks::PackWeights() {
+  int32_t num_bins = bins_.size();
+  int32_t num_cols = num_fft_bins_ / 2 + 1;
+
+  packed_begin_.resize(num_bins + 1);
+  packed_weights_.clear();
+  for (int32_t i = 0; i < num_bins; ++i) {
+    int32_t offset = bins_[i].first;
+    const auto &v = bins_[i].second;
+
+    int32_t padded = (static_cast<int32_t>(v.size()) + 3) / 4 * 4;
+    padded = std::max<int32_t>(std::min(padded, num_cols - offset), v.size());
+
+    packed_begin_[i] = packed_weights_.size();
+    packed_weights_.insert(packed_weights_.end(), v.begin(), v.end());
+    packed_weights_.resize(packed_begin_[i] + padded, 0);
+  }
+  packed_begin_[num_bins] = packed_weights_.size();
 }
 
 // "power_spectrum" contains fft energies.
@@ -418,11 +441,21 @@ void MelBanks::Compute(const float *power_spectrum,
   int32_t num_bins = bins_.size();
 
   for (int32_t i = 0; i < num_bins; i++) {
-    int32_t offset = bins_[i].first;
-    const auto &v = bins_[i].second;
+    const float *w = packed_weights_.data() + packed_begin_[i];
+    const float *p = power_spectrum + bins_[i].first;
+    int32_t size = packed_begin_[i + 1] - packed_begin_[i];
+
     float energy = 0;
-    for (int32_t k = 0; k != v.size(); ++k) {
-      energy += v[k] * power_spectrum[k + offset];
+    int32_t k = 0;
+#if KNF_HAVE_NEON
+    float32x4_t acc = vdupq_n_f32(0);
+    for (; k + 4 <= size; k += 4) {
+      acc = vmlaq_f32(acc, vld1q_f32(w + k), vld1q_f32(p + k));
+    }
+    energy = HorizontalSum(acc);
+#endif
+    for (; k != size; ++k) {
+      energy += w[k] * p[k];
     }
 
     // HTK-like flooring- for testing purposes (we prefer dither)
@@ -172,11 +172,22 @@ class MelBanks {
                            const FrameExtractionOptions &frame_opts,
                            float vtln_warp_factor);
 
+  // Copy bins_ into packed_weights_. Called at the end of each constructor.
+  void PackWeights();
+
  private:
   // the "bins_" vector is a vector, one for each bin, of a pair:
   // (the first nonzero fft-bin), (the vector of weights).
   std::vector<std::pair<int32_t, std::vector<float>>> bins_;
 
+  // The weights of all bins in one contiguous array, used by Compute().
+  // The weights of bin i start at packed_begin_[i] and are zero-padded to
+  // a multiple of 4 as long as that stays within the num_fft_bins_/2+1
+  // entries of the power spectrum, so the inner loop of Compute() needs
+  // no tail for almost all bins.
+  std::vector<float> packed_weights_;
+  std::vector<int32_t> packed_begin_;  // size is NumBins() + 1
+
   // TODO(fangjun): Remove debug_ and htk_mode_
   bool debug_ = false;
   bool htk_mode_ = false;
@@ -31,11 +31,18 @@
 
 namespace knf {
 
+// Initial capacity of an unlimited RecyclingVector, in frames
+static constexpr int32_t kInitialCapacity = 64;
+
 RecyclingVector::RecyclingVector(int32_t items_to_hold)
     : items_to_hold_(items_to_hold == 0 ? -1 : items_to_hold),
       first_available_index_(0) {}
 
 const float *RecyclingVector::At(int32_t index) const {
+  return Frames(index, 1);
+}
+
+const float *RecyclingVector::Frames(int32_t index, int32_t n) const {
   if (index < first_available_index_) {
     KNF_LOG(FATAL) << "Attempted to retrieve feature vector that was "
                       "already removed by the RecyclingVector (index = "
@@ -44,29 +51,73 @@ const float *RecyclingVector::At(int32_t index) const {
                    << "; "
                    << "size = " << Size() << ")";
   }
-  // 'at' does size checking.
-  return items_.at(index - first_available_index_).data();
+
+  if (n < 0 || index + n > Size()) {
+    KNF_LOG(FATAL) << "Attempted to retrieve feature vectors [" << index
+                   << ", " << (index + n) << ") beyond the end (size = "
+                   << Size() << ")";
+  }
+
+  if (capacity_ == 0) {
+    return nullptr;  // n == 0 and nothing has been pushed yet
+  }
+
+  // The mirrored second half makes the run contiguous even if it wraps
+  int32_t slot = (head_ + index - first_available_index_) % capacity_;
+  return data_.data() + slot * dim_;
 }
 
-void RecyclingVector::PushBack(std::vector<float> item) {
-  // Note: -1 is a larger number when treated as unsigned
-  if (items_.size() == static_cast<size_t>(items_to_hold_)) {
-    items_.pop_front();
-    ++first_available_index_;
+void RecyclingVector::PushBack(const float *item, int32_t dim) {
+  if (capacity_ == 0) {
+    dim_ = dim;
+    capacity_ = items_to_hold_ > 0 ? items_to_hold_ : kInitialCapacity;
+    data_.resize(2 * capacity_ * dim_);
+  }
+  KNF_CHECK_EQ(dim, dim_);
+
+  if (num_items_ == capacity_) {
+    if (items_to_hold_ > 0) {
+      head_ = (head_ + 1) % capacity_;
+      --num_items_;
+      ++first_available_index_;
+    } else {
+      Grow();
+    }
   }
-  items_.push_back(std::move(item));
+
+  int32_t slot = (head_ + num_items_) % capacity_;
+  std::copy(item, item + dim_, Slot(slot));
+  std::copy(item, item + dim_, Slot(slot + capacity_));
+  ++num_items_;
+}
+
+void RecyclingVector::Grow() {
+  int32_t new_capacity = 2 * capacity_;
+  std::vector<float> data(2 * new_capacity * dim_);
+
+  const float *src = Frames(first_available_index_, num_items_);
+  std::copy(src, src + num_items_ * dim_, data.begin());
+  std::copy(src, src + num_items_ * dim_, data.begin() + new_capacity * dim_);
+
+  retired_.push_back(std::move(data_));
+  data_ = std::move(data);
+  capacity_ = new_capacity;
+  head_ = 0;
 }
 
 int32_t RecyclingVector::Size() const {
-  return first_available_index_ + static_cast<int32_t>(items_.size());
+  return first_available_index_ + num_items_;
 }
 
 // discard the first n frames
 void RecyclingVector::Pop(int32_t n) {
-  for (int32_t i = 0; i < n && !items_.empty(); ++i) {
-    items_.pop_front();
-    ++first_available_index_;
+  n = std::max(0, std::min(n, num_items_));
+  if (n > 0) {
+    head_ = (head_ + n) % capacity_;
+    num_items_ -= n;
+    first_available_index_ += n;
   }
+  retired_.clear();
 }
 
 template <class C>
@@ -118,20 +169,18 @@ void OnlineGenericBaseFeature<C>::ComputeFeatures() {
   // note: this online feature-extraction code does not support VTLN.
   float vtln_warp = 1.0;
 
-  std::vector<float> window;
   bool need_raw_log_energy = computer_.NeedRawLogEnergy();
+  feature_.resize(computer_.Dim());
 
   for (int32_t frame = num_frames_old; frame < num_frames_new; ++frame) {
-    std::fill(window.begin(), window.end(), 0);
+    std::fill(window_.begin(), window_.end(), 0);
     float raw_log_energy = 0.0;
     ExtractWindow(waveform_offset_, waveform_remainder_, frame, frame_opts,
-                  window_function_, &window,
+                  window_function_, &window_,
                   need_raw_log_energy ? &raw_log_energy : nullptr);
 
-    std::vector<float> this_feature(computer_.Dim());
-
-    computer_.Compute(raw_log_energy, vtln_warp, &window, this_feature.data());
-    features_.PushBack(std::move(this_feature));
+    computer_.Compute(raw_log_energy, vtln_warp, &window_, feature_.data());
+    features_.PushBack(feature_.data(), static_cast<int32_t>(feature_.size()));
   }
 
   // OK, we will now discard any portion of the signal that will not be
@@ -151,13 +200,11 @@ void OnlineGenericBaseFeature<C>::ComputeFeatures() {
       waveform_offset_ += waveform_remainder_.size();
       waveform_remainder_.resize(0);
     } else {
-      std::vector<float> new_remainder(new_num_samples);
-
-      std::copy(waveform_remainder_.begin() + samples_to_discard,
-                waveform_remainder_.end(), new_remainder.begin());
+      // Shift in place, keeping the capacity for the next call
+      waveform_remainder_.erase(
+          waveform_remainder_.begin(),
+          waveform_remainder_.begin() + samples_to_discard);
       waveform_offset_ += samples_to_discard;
-
-      waveform_remainder_.swap(new_remainder);
     }
   }
 }
@@ -40,6 +40,12 @@ namespace knf {
 /// This is useful when processing very long recordings which would otherwise
 /// cause the memory to eventually blow up when the features are not being
 /// removed.
+///
+/// Frames are kept in one contiguous ring buffer instead of one heap block
+/// per frame. Every slot is stored twice, at slot i and at slot
+/// i + capacity, so any run of consecutive frames can be read as a single
+/// contiguous block (see Frames()) even when it wraps around the ring.
+/// With an unlimited size, the ring doubles when it is full.
 class RecyclingVector {
  public:
   /// By default it does not remove any elements.
@@ -53,7 +59,19 @@ class RecyclingVector {
   // Users should not free it
   const float *At(int32_t index) const;
 
-  void PushBack(std::vector<float> item);
+  // Return n consecutive frames starting at index, stored contiguously,
+  // i.e., frame index + i starts at offset i * dim.
+  //
+  // The memory stays valid until the next call to Pop(). Pushing more
+  // frames in between does not invalidate it, unless items_to_hold is
+  // positive and the frames are recycled.
+  const float *Frames(int32_t index, int32_t n) const;
+
+  void PushBack(const float *item, int32_t dim);
+
+  void PushBack(const std::vector<float> &item) {
+    PushBack(item.data(), static_cast<int32_t>(item.size()));
+  }
 
   /// This method returns the size as if no "recycling" had happened,
   /// i.e. equivalent to the number of times the PushBack method has been
@@ -64,9 +82,27 @@ class RecyclingVector {
   void Pop(int32_t n);
 
  private:
-  std::deque<std::vector<float>> items_;
+  // Return a pointer to the frame stored at the given slot
+  float *Slot(int32_t slot) { return data_.data() + slot * dim_; }
+
+  // Double the capacity, keeping all frames
+  void Grow();
+
+ private:
   int32_t items_to_hold_;
   int32_t first_available_index_;
+
+  int32_t dim_ = 0;
+  int32_t capacity_ = 0;   // number of frames the ring can hold
+  int32_t head_ = 0;       // slot of frame first_available_index_
+  int32_t num_items_ = 0;  // number of frames in the ring
+
+  // 2 * capacity_ slots of dim_ floats each
+  std::vector<float> data_;
+
+  // Buffers replaced by Grow(). Pointers returned by Frames() may still
+  // refer to them, so they are kept until the next Pop().
+  std::vector<std::vector<float>> retired_;
 };
 
 /// This is a templated class for online feature extraction;
@@ -94,6 +130,13 @@ class OnlineGenericBaseFeature {
 
   const float *GetFrame(int32_t frame) const { return features_.At(frame); }
 
+  // Return n consecutive frames starting at frame as one contiguous block
+  // of n * Dim() floats. See RecyclingVector::Frames() for how long the
+  // memory stays valid.
+  const float *GetFrames(int32_t frame, int32_t n) const {
+    return features_.Frames(frame, n);
+  }
+
   // This would be called from the application, when you get
   // more wave data.  Note: the sampling_rate is only provided so
   // the code can assert that it matches the sampling rate
@@ -143,6 +186,10 @@ class OnlineGenericBaseFeature {
   // will be required for the next phase of computation).
   // It is a 1-D tensor
   std::vector<float> waveform_remainder_;
+
+  // Scratch space reused for every frame
+  std::vector<float> window_;
+  std::vector<float> feature_;
 };
 
 using OnlineRawAudioSamples = OnlineGenericBaseFeature<RawAudioSamplesComputer>;
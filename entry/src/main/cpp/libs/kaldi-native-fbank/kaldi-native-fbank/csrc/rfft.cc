@@ -23,10 +23,202 @@
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/log.h"
+#include "kaldi-native-fbank/csrc/simd.h"
 #include "kiss_fftr.h"
 
 namespace knf {
 
+static constexpr double kPi = 3.14159265358979323846;
+
+static bool IsPowerOfTwo(int32_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+// Smaller transforms are left to kissfft; they are not used for features
+// and the tables would cost more than they save.
+static constexpr int32_t kMinPowerOfTwoSize = 64;
+
+// Forward real FFT for n a power of two, n >= kMinPowerOfTwoSize.
+//
+// The n real inputs are treated as n/2 complex numbers z[k] = x[2k] +
+// i*x[2k+1]. An iterative radix-2 complex FFT of size n/2 runs on them,
+// and a final pass splits the result into the spectrum of x. Complex
+// values are kept in separate real and imaginary arrays, so each
+// butterfly stage is a plain element-wise loop that maps onto 4-lane NEON
+// vectors. All tables are computed in the constructor and Compute() does
+// not allocate.
+class PowerOfTwoRfft {
+ public:
+  explicit PowerOfTwoRfft(int32_t n) : n_(n), m_(n / 2) {
+    int32_t log_m = 0;
+    while ((1 << log_m) < m_) {
+      ++log_m;
+    }
+
+    bit_reverse_.resize(m_);
+    for (int32_t k = 0; k != m_; ++k) {
+      int32_t r = 0;
+      for (int32_t b = 0; b != log_m; ++b) {
+        r |= ((k >> b) & 1) << (log_m - 1 - b);
+      }
+      bit_reverse_[k] = r;
+    }
+
+    // Twiddles of the stage with half-size h are stored at offset h - 1:
+    // w_j = exp(-2*pi*i*j / (2h)), 0 <= j < h
+    stage_cos_.resize(m_);
+    stage_sin_.resize(m_);
+    for (int32_t h = 1; h < m_; h *= 2) {
+      for (int32_t j = 0; j != h; ++j) {
+        double theta = -kPi * j / h;
+        stage_cos_[h - 1 + j] = static_cast<float>(std::cos(theta));
+        stage_sin_[h - 1 + j] = static_cast<float>(std::sin(theta));
+      }
+    }
+
+    // exp(-2*pi*i*k / n), 0 <= k < n/2, for the final split pass
+    split_cos_.resize(m_);
+    split_sin_.resize(m_);
+    for (int32_t k = 0; k != m_; ++k) {
+      double theta = -2 * kPi * k / n_;
+      split_cos_[k] = static_cast<float>(std::cos(theta));
+      split_sin_[k] = static_cast<float>(std::sin(theta));
+    }
+
+    re_.resize(m_);
+    im_.resize(m_);
+  }
+
+  void Compute(float *in_out) {
+    float *re = re_.data();
+    float *im = im_.data();
+
+    for (int32_t k = 0; k != m_; ++k) {
+      int32_t r = bit_reverse_[k];
+      re[r] = in_out[2 * k];
+      im[r] = in_out[2 * k + 1];
+    }
+
+    for (int32_t h = 1; h < m_; h *= 2) {
+      const float *wr = stage_cos_.data() + h - 1;
+      const float *wi = stage_sin_.data() + h - 1;
+      for (int32_t base = 0; base < m_; base += 2 * h) {
+        Butterflies(re + base, im + base, re + base + h, im + base + h, wr, wi,
+                    h);
+      }
+    }
+
+    Split(in_out);
+  }
+
+ private:
+  // a = a + w * b, b = a - w * b, element-wise for n elements
+  static void Butterflies(float *ar, float *ai, float *br, float *bi,
+                          const float *wr, const float *wi, int32_t n) {
+    int32_t j = 0;
+#if KNF_HAVE_NEON
+    for (; j + 4 <= n; j += 4) {
+      float32x4_t vbr = vld1q_f32(br + j);
+      float32x4_t vbi = vld1q_f32(bi + j);
+      float32x4_t vwr = vld1q_f32(wr + j);
+      float32x4_t vwi = vld1q_f32(wi + j);
+
+      float32x4_t tr = vmlsq_f32(vmulq_f32(vbr, vwr), vbi, vwi);
+      float32x4_t ti = vmlaq_f32(vmulq_f32(vbr, vwi), vbi, vwr);
+
+      float32x4_t var = vld1q_f32(ar + j);
+      float32x4_t vai = vld1q_f32(ai + j);
+
+      vst1q_f32(ar + j, vaddq_f32(var, tr));
+      vst1q_f32(ai + j, vaddq_f32(vai, ti));
+      vst1q_f32(br + j, vsubq_f32(var, tr));
+      vst1q_f32(bi + j, vsubq_f32(vai, ti));
+    }
+#endif
+    for (; j < n; ++j) {
+      float tr = br[j] * wr[j] - bi[j] * wi[j];
+      float ti = br[j] * wi[j] + bi[j] * wr[j];
+      float r = ar[j];
+      float i = ai[j];
+      ar[j] = r + tr;
+      ai[j] = i + ti;
+      br[j] = r - tr;
+      bi[j] = i - ti;
+    }
+  }
+
+  // Compute X[k] from Z = FFT(z):
+  //   X[k] = E[k] + exp(-2*pi*i*k/n) * O[k]
+  // where E[k] = (Z[k] + conj(Z[m-k])) / 2 and
+  //       O[k] = -i * (Z[k] - conj(Z[m-k])) / 2
+  // are the spectra of the even and odd samples of x.
+  void Split(float *out) const {
+    const float *re = re_.data();
+    const float *im = im_.data();
+    const float *wr = split_cos_.data();
+    const float *wi = split_sin_.data();
+
+    float x0 = re[0] + im[0];
+    float xm = re[0] - im[0];
+
+    int32_t k = 1;
+#if KNF_HAVE_NEON
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; k + 4 <= m_; k += 4) {
+      // Z[m-k-3 .. m-k], reversed so that lane j holds Z[m-k-j]
+      float32x4_t cr = vld1q_f32(re + m_ - k - 3);
+      float32x4_t ci = vld1q_f32(im + m_ - k - 3);
+      cr = vrev64q_f32(vcombine_f32(vget_high_f32(cr), vget_low_f32(cr)));
+      ci = vrev64q_f32(vcombine_f32(vget_high_f32(ci), vget_low_f32(ci)));
+
+      float32x4_t ar = vld1q_f32(re + k);
+      float32x4_t ai = vld1q_f32(im + k);
+
+      float32x4_t er = vmulq_f32(vaddq_f32(ar, cr), half);
+      float32x4_t ei = vmulq_f32(vsubq_f32(ai, ci), half);
+      float32x4_t or_ = vmulq_f32(vaddq_f32(ai, ci), half);
+      float32x4_t oi = vmulq_f32(vsubq_f32(cr, ar), half);
+
+      float32x4_t vwr = vld1q_f32(wr + k);
+      float32x4_t vwi = vld1q_f32(wi + k);
+
+      float32x4x2_t x;
+      x.val[0] = vmlsq_f32(vmlaq_f32(er, vwr, or_), vwi, oi);
+      x.val[1] = vmlaq_f32(vmlaq_f32(ei, vwr, oi), vwi, or_);
+      vst2q_f32(out + 2 * k, x);
+    }
+#endif
+    for (; k < m_; ++k) {
+      float ar = re[k];
+      float ai = im[k];
+      float cr = re[m_ - k];
+      float ci = im[m_ - k];
+
+      float er = 0.5f * (ar + cr);
+      float ei = 0.5f * (ai - ci);
+      float or_ = 0.5f * (ai + ci);
+      float oi = 0.5f * (cr - ar);
+
+      out[2 * k] = er + wr[k] * or_ - wi[k] * oi;
+      out[2 * k + 1] = ei + wr[k] * oi + wi[k] * or_;
+    }
+
+    out[0] = x0;
+    out[1] = xm;
+  }
+
+ private:
+  int32_t n_;
+  int32_t m_;  // n_ / 2
+  std::vector<int32_t> bit_reverse_;
+  std::vector<float> stage_cos_;
+  std::vector<float> stage_sin_;
+  std::vector<float> split_cos_;
+  std::vector<float> split_sin_;
+
+  // scratch space
+  std::vector<float> re_;
+  std::vector<float> im_;
+};
+
 class Rfft::RfftImpl {
  public:
   RfftImpl(int32_t n, bool inverse) : n_(n), inverse_(inverse) {
@@ -39,8 +231,24 @@ class Rfft::RfftImpl {
       fprintf(stderr, "n should be positive. Given: %d \n", n);
       exit(-1);
     }
+
+    if (!inverse_ && n_ >= kMinPowerOfTwoSize && IsPowerOfTwo(n_)) {
+      pow2_ = std::make_unique<PowerOfTwoRfft>(n_);
+    } else {
+      cfg_ = kiss_fftr_alloc(n_, inverse_, nullptr, nullptr);
+      out_.resize(n_ / 2 + 1);
+    }
   }
 
+  ~RfftImpl() {
+    if (cfg_) {
+      kiss_fftr_free(cfg_);
+    }
+  }
+
+  RfftImpl(const RfftImpl &) = delete;
+  RfftImpl &operator=(const RfftImpl &) = delete;
+
   void Compute(float *in_out) {
     if (!inverse_) {
       Forward(in_out);
@@ -58,47 +266,48 @@ class Rfft::RfftImpl {
   }
 
  private:
-  void Forward(float *in_out) const {
-    kiss_fftr_cfg cfg = kiss_fftr_alloc(n_, 0, nullptr, nullptr);
-
-    std::vector<kiss_fft_cpx> out(n_ / 2 + 1);
-
-    kiss_fftr(cfg, in_out, out.data());
+  void Forward(float *in_out) {
+    if (pow2_) {
+      pow2_->Compute(in_out);
+      return;
+    }
 
-    kiss_fftr_free(cfg);
+    kiss_fftr(cfg_, in_out, out_.data());
 
-    in_out[0] = out[0].r;
-    in_out[1] = out[n_ / 2].r;
+    in_out[0] = out_[0].r;
+    in_out[1] = out_[n_ / 2].r;
 
     for (int32_t i = 1; i < n_ / 2; ++i) {
-      in_out[2 * i] = out[i].r;
-      in_out[2 * i + 1] = out[i].i;
+      in_out[2 * i] = out_[i].r;
+      in_out[2 * i + 1] = out_[i].i;
     }
   }
 
-  void Reverse(float *in_out) const {
-    std::vector<kiss_fft_cpx> out(n_ / 2 + 1);
-    out[0].r = in_out[0];
-    out[0].i = 0;
+  void Reverse(float *in_out) {
+    out_[0].r = in_out[0];
+    out_[0].i = 0;
 
-    out[n_ / 2].r = in_out[1];
-    out[n_ / 2].i = 0;
+    out_[n_ / 2].r = in_out[1];
+    out_[n_ / 2].i = 0;
 
     for (int32_t i = 1; i < n_ / 2; ++i) {
-      out[i].r = in_out[2 * i];
-      out[i].i = in_out[2 * i + 1];
+      out_[i].r = in_out[2 * i];
+      out_[i].i = in_out[2 * i + 1];
     }
 
-    kiss_fftr_cfg cfg = kiss_fftr_alloc(n_, 1, nullptr, nullptr);
-
-    kiss_fftri(cfg, out.data(), in_out);
-
-    kiss_fftr_free(cfg);
+    kiss_fftri(cfg_, out_.data(), in_out);
   }
 
  private:
   int32_t n_;
   bool inverse_ = false;
+
+  // Used for forward transforms when n_ is a power of two
+  std::unique_ptr<PowerOfTwoRfft> pow2_;
+
+  // Used otherwise. Allocated once, not on every call.
+  kiss_fftr_cfg cfg_ = nullptr;
+  std::vector<kiss_fft_cpx> out_;
 };
 
 Rfft::Rfft(int32_t n, bool inverse /*=false*/)
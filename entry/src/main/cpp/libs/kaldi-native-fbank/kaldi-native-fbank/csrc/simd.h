@@ -0,0 +1,46 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KALDI_NATIVE_FBANK_CSRC_SIMD_H_
+#define KALDI_NATIVE_FBANK_CSRC_SIMD_H_
+
+// KNF_HAVE_NEON is 1 when compiling for ARM with NEON. The vectorized
+// loops guarded by it always have a scalar version computing the same
+// values, which is used on other platforms and for the tail elements.
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KNF_HAVE_NEON 1
+#else
+#define KNF_HAVE_NEON 0
+#endif
+
+#if KNF_HAVE_NEON
+namespace knf {
+
+// Return the sum of the 4 lanes of v
+inline float HorizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_f32(v);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+
+}  // namespace knf
+#endif
+
+#endif  // KALDI_NATIVE_FBANK_CSRC_SIMD_H_
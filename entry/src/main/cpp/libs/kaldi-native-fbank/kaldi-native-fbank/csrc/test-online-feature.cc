@@ -16,16 +16,22 @@
  * limitations under the License.
  */
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "kaldi-native-fbank/csrc/online-feature.h"
 namespace knf {
 
+static std::vector<float> Frame(int32_t i) {
+  return {static_cast<float>(i), static_cast<float>(i + 1),
+          static_cast<float>(i + 2)};
+}
+
 TEST(RecyclingVector, TestUnlimited) {
   RecyclingVector v(-1);
   constexpr int32_t N = 100;
   for (int32_t i = 0; i != N; ++i) {
-    std::unique_ptr<float[]> p(new float[3]{i, i + 1, i + 2});
-    v.PushBack(std::move(p));
+    v.PushBack(Frame(i));
   }
   ASSERT_EQ(v.Size(), N);
 
@@ -42,8 +48,7 @@ TEST(RecyclingVector, Testlimited) {
   constexpr int32_t N = 10;
   RecyclingVector v(K);
   for (int32_t i = 0; i != N; ++i) {
-    std::unique_ptr<float[]> p(new float[3]{i, i + 1, i + 2});
-    v.PushBack(std::move(p));
+    v.PushBack(Frame(i));
   }
 
   ASSERT_EQ(v.Size(), N);
@@ -55,5 +60,61 @@ TEST(RecyclingVector, Testlimited) {
       EXPECT_EQ(t[k], (i + k));
     }
   }
+
+  // The last K frames are contiguous although they wrap around the ring
+  const float *t = v.Frames(N - K, K);
+  for (int32_t i = 0; i != K; ++i) {
+    for (int32_t k = 0; k != 3; ++k) {
+      EXPECT_EQ(t[i * 3 + k], (N - K + i + k));
+    }
+  }
 }
+
+TEST(RecyclingVector, TestFramesAfterPop) {
+  RecyclingVector v(-1);
+  constexpr int32_t N = 1000;
+  constexpr int32_t Chunk = 45;
+  int32_t next = 0;
+  int32_t popped = 0;
+  for (int32_t i = 0; i != N; ++i) {
+    v.PushBack(Frame(i));
+
+    // Read overlapping chunks and drop what is no longer needed, like
+    // a streaming encoder does
+    if (v.Size() - next >= Chunk) {
+      v.Pop(next - popped);
+      popped = next;
+      const float *t = v.Frames(next, Chunk);
+      for (int32_t j = 0; j != Chunk; ++j) {
+        for (int32_t k = 0; k != 3; ++k) {
+          EXPECT_EQ(t[j * 3 + k], (next + j + k));
+        }
+      }
+      next += 32;
+    }
+  }
+}
+
+TEST(RecyclingVector, TestFramesSurviveGrow) {
+  RecyclingVector v(-1);
+  for (int32_t i = 0; i != 10; ++i) {
+    v.PushBack(Frame(i));
+  }
+
+  // Pushing many more frames reallocates the ring; the old block is kept
+  // until the next Pop()
+  const float *t = v.Frames(0, 10);
+  for (int32_t i = 10; i != 1000; ++i) {
+    v.PushBack(Frame(i));
+  }
+  for (int32_t i = 0; i != 10; ++i) {
+    EXPECT_EQ(t[i * 3], i);
+  }
+
+  v.Pop(500);
+  EXPECT_EQ(v.Size(), 1000);
+  EXPECT_EQ(v.At(500)[0], 500);
+  EXPECT_EQ(v.At(999)[2], 1001);
+}
+
 }  // namespace knf
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 
+#include <cmath>
 #include <cstdint>
 #include <vector>
 
@@ -98,4 +99,44 @@ TEST(NotPowerOfTwo, TestRfft) {
   }
 }
 
+// Sizes used for features go through a separate power-of-two
+// implementation; compare it with a direct DFT in double precision
+TEST(PowerOfTwo, TestRfftLarge) {
+  for (int32_t n : {64, 256, 512, 1024}) {
+    std::vector<float> original(n);
+    for (int32_t i = 0; i != n; ++i) {
+      original[i] = std::sin(0.1 * i * i) + 0.25 * std::cos(3.0 * i);
+    }
+
+    std::vector<float> d = original;
+    knf::Rfft fft(n);
+    fft.Compute(d.data());
+
+    for (int32_t k = 0; k <= n / 2; ++k) {
+      double re = 0;
+      double im = 0;
+      for (int32_t i = 0; i != n; ++i) {
+        double theta = -2 * 3.14159265358979323846 * k * i / n;
+        re += original[i] * std::cos(theta);
+        im += original[i] * std::sin(theta);
+      }
+
+      if (k == 0) {
+        EXPECT_NEAR(d[0], re, 1e-3);
+      } else if (k == n / 2) {
+        EXPECT_NEAR(d[1], re, 1e-3);
+      } else {
+        EXPECT_NEAR(d[2 * k], re, 1e-3);
+        EXPECT_NEAR(d[2 * k + 1], im, 1e-3);
+      }
+    }
+
+    knf::Rfft ifft(n, true);
+    ifft.Compute(d.data());
+    for (int32_t i = 0; i != n; ++i) {
+      EXPECT_NEAR(d[i] / n, original[i], 1e-5);
+    }
+  }
+}
+
 }  // namespace knf
@@ -0,0 +1,330 @@
+#include "llm_sampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LLM_SAMPLER_NEON 1
+#endif
+
+// 分块大小：每块 64 个 logit (16 个 NEON 向量)
+static const int kBlock = 64;
+
+// ==========================================
+// SIMD 工具
+// ==========================================
+
+#if LLM_SAMPLER_NEON
+static inline float HorizontalMax(float32x4_t v) {
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+}
+
+static inline bool AnyLane(uint32x4_t mask) {
+    uint32x2_t m = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+    m = vpmax_u32(m, m);
+    return vget_lane_u32(m, 0) != 0;
+}
+#endif
+
+llama_token ArgmaxLogits(const float* logits, int n) {
+    if (n <= 0) return 0;
+    int i = 0;
+    llama_token best = 0;
+    float best_val = logits[0];
+
+#if LLM_SAMPLER_NEON
+    if (n >= 4) {
+        static const uint32_t kIdx[4] = {0, 1, 2, 3};
+        float32x4_t vmax = vld1q_f32(logits);
+        uint32x4_t vidx = vld1q_u32(kIdx);
+        uint32x4_t vbest = vidx;
+        const uint32x4_t vstep = vdupq_n_u32(4);
+        for (i = 4; i + 4 <= n; i += 4) {
+            vidx = vaddq_u32(vidx, vstep);
+            float32x4_t v = vld1q_f32(logits + i);
+            uint32x4_t gt = vcgtq_f32(v, vmax);
+            vmax = vbslq_f32(gt, v, vmax);
+            vbest = vbslq_u32(gt, vidx, vbest);
+        }
+        float lane_val[4];
+        uint32_t lane_idx[4];
+        vst1q_f32(lane_val, vmax);
+        vst1q_u32(lane_idx, vbest);
+        best_val = lane_val[0];
+        best = (llama_token)lane_idx[0];
+        for (int l = 1; l < 4; l++) {
+            if (lane_val[l] > best_val || (lane_val[l] == best_val && (llama_token)lane_idx[l] < best)) {
+                best_val = lane_val[l];
+                best = (llama_token)lane_idx[l];
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (logits[i] > best_val) {
+            best_val = logits[i];
+            best = i;
+        }
+    }
+    return best;
+}
+
+static float BlockMax(const float* p, int len) {
+    int i = 0;
+    float m = -INFINITY;
+#if LLM_SAMPLER_NEON
+    if (len >= 16) {
+        float32x4_t m0 = vld1q_f32(p);
+        float32x4_t m1 = vld1q_f32(p + 4);
+        float32x4_t m2 = vld1q_f32(p + 8);
+        float32x4_t m3 = vld1q_f32(p + 12);
+        for (i = 16; i + 16 <= len; i += 16) {
+            m0 = vmaxq_f32(m0, vld1q_f32(p + i));
+            m1 = vmaxq_f32(m1, vld1q_f32(p + i + 4));
+            m2 = vmaxq_f32(m2, vld1q_f32(p + i + 8));
+            m3 = vmaxq_f32(m3, vld1q_f32(p + i + 12));
+        }
+        m = HorizontalMax(vmaxq_f32(vmaxq_f32(m0, m1), vmaxq_f32(m2, m3)));
+    }
+#endif
+    for (; i < len; i++) m = std::max(m, p[i]);
+    return m;
+}
+
+static void CollectAtLeast(const float* p, int base, int len, float tau, std::vector<llama_token_data>& out) {
+    int i = 0;
+#if LLM_SAMPLER_NEON
+    const float32x4_t vtau = vdupq_n_f32(tau);
+    for (; i + 4 <= len; i += 4) {
+        if (!AnyLane(vcgeq_f32(vld1q_f32(p + i), vtau))) continue;
+        for (int l = 0; l < 4; l++) {
+            if (p[i + l] >= tau) out.push_back({base + i + l, p[i + l], 0.0f});
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (p[i] >= tau) out.push_back({base + i, p[i], 0.0f});
+    }
+}
+
+int SelectTopK(const float* logits, int n, int k, std::vector<llama_token_data>& out, std::vector<float>& scratch) {
+    out.clear();
+    if (n <= 0) return 0;
+    if (k <= 0 || k > n) k = n;
+
+    // 1. 一次 SIMD 扫描得到每块最大值
+    int n_blocks = (n + kBlock - 1) / kBlock;
+    scratch.resize(2 * (size_t)n_blocks);
+    float* block_max = scratch.data();
+    for (int b = 0; b < n_blocks; b++) {
+        int len = std::min(kBlock, n - b * kBlock);
+        block_max[b] = BlockMax(logits + b * kBlock, len);
+    }
+
+    // 2. 第 k 大的块最大值是第 k 大 logit 的下界：至少有 k 个块各贡献一个 >= tau 的元素
+    float tau = -INFINITY;
+    if (k <= n_blocks) {
+        float* sorted = scratch.data() + n_blocks;
+        std::copy(block_max, block_max + n_blocks, sorted);
+        std::nth_element(sorted, sorted + (k - 1), sorted + n_blocks, std::greater<float>());
+        tau = sorted[k - 1];
+    }
+
+    // 3. 只扫描可能含候选的块
+    for (int b = 0; b < n_blocks; b++) {
+        if (block_max[b] < tau) continue;
+        int len = std::min(kBlock, n - b * kBlock);
+        CollectAtLeast(logits + b * kBlock, b * kBlock, len, tau, out);
+    }
+
+    auto by_logit = [](const llama_token_data& a, const llama_token_data& b) {
+        return a.logit > b.logit || (a.logit == b.logit && a.id < b.id);
+    };
+    if ((int)out.size() > k) {
+        std::nth_element(out.begin(), out.begin() + (k - 1), out.end(), by_logit);
+        out.resize(k);
+    }
+    std::sort(out.begin(), out.end(), by_logit);
+    return (int)out.size();
+}
+
+// ==========================================
+// LlmSampler
+// ==========================================
+
+LlmSampler::LlmSampler(const LlmSamplingParams& p) : params(p) {
+    if (HasPenalties()) {
+        penalties = llama_sampler_init_penalties(params.penalty_last_n, params.penalty_repeat,
+                                                 params.penalty_freq, params.penalty_present);
+    }
+
+    if (params.temperature > 0.0f) {
+        chain = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        if (params.top_p < 1.0f) llama_sampler_chain_add(chain, llama_sampler_init_top_p(params.top_p, 1));
+        if (params.min_p > 0.0f) llama_sampler_chain_add(chain, llama_sampler_init_min_p(params.min_p, 1));
+        llama_sampler_chain_add(chain, llama_sampler_init_temp(params.temperature));
+        llama_sampler_chain_add(chain, llama_sampler_init_dist(params.seed));
+    }
+}
+
+LlmSampler::~LlmSampler() {
+    if (penalties) llama_sampler_free(penalties);
+    if (chain) llama_sampler_free(chain);
+}
+
+bool LlmSampler::HasPenalties() const {
+    return params.penalty_last_n != 0 &&
+           (params.penalty_repeat != 1.0f || params.penalty_freq != 0.0f || params.penalty_present != 0.0f);
+}
+
+void LlmSampler::Reset() {
+    recent.clear();
+    if (penalties) llama_sampler_reset(penalties);
+    if (chain) llama_sampler_reset(chain);
+}
+
+void LlmSampler::ApplyPenalties(float* logits) {
+    if (!penalties || recent.empty()) return;
+
+    // 只把窗口里出现过的 token 交给 penalties 采样器，结果写回 logits
+    candidates.clear();
+    for (llama_token t : recent) candidates.push_back({t, 0.0f, 0.0f});
+    std::sort(candidates.begin(), candidates.end(),
+              [](const llama_token_data& a, const llama_token_data& b) { return a.id < b.id; });
+    candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                 [](const llama_token_data& a, const llama_token_data& b) { return a.id == b.id; }),
+                     candidates.end());
+    for (auto& c : candidates) c.logit = logits[c.id];
+
+    llama_token_data_array arr = {candidates.data(), candidates.size(), -1, false};
+    llama_sampler_apply(penalties, &arr);
+    for (size_t i = 0; i < arr.size; i++) logits[arr.data[i].id] = arr.data[i].logit;
+}
+
+llama_token LlmSampler::Sample(float* logits, int n_vocab) {
+    ApplyPenalties(logits);
+
+    if (!chain) {
+        return ArgmaxLogits(logits, n_vocab);
+    }
+
+    SelectTopK(logits, n_vocab, params.top_k, candidates, scratch);
+    llama_token_data_array arr = {candidates.data(), candidates.size(), -1, true};
+    llama_sampler_apply(chain, &arr);
+    if (arr.selected < 0 || arr.selected >= (int64_t)arr.size) {
+        return candidates.empty() ? 0 : candidates[0].id;
+    }
+    return arr.data[arr.selected].id;
+}
+
+void LlmSampler::Accept(llama_token token) {
+    if (!penalties) return;
+    llama_sampler_accept(penalties, token);
+    int last_n = params.penalty_last_n;
+    recent.push_back(token);
+    if (last_n > 0) {
+        while ((int)recent.size() > last_n) recent.pop_front();
+    }
+}
+
+// ==========================================
+// 采样开销基准
+// ==========================================
+
+static llama_token ScalarArgmax(const float* logits, int n) {
+    llama_token best = 0;
+    float max_p = -1e9;
+    for (int j = 0; j < n; j++) {
+        if (logits[j] > max_p) {
+            max_p = logits[j];
+            best = j;
+        }
+    }
+    return best;
+}
+
+std::string BenchmarkSampling(int n_vocab, int iterations) {
+    if (n_vocab <= 0) n_vocab = 151936; // Qwen 词表大小
+    if (iterations <= 0) iterations = 200;
+
+    // 模拟真实分布：大部分 logit 很低，少量候选突出
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 2.0f);
+    std::uniform_int_distribution<int> pick(0, n_vocab - 1);
+    std::vector<std::vector<float>> inputs(8, std::vector<float>(n_vocab));
+    for (auto& row : inputs) {
+        for (auto& v : row) v = noise(rng);
+        for (int i = 0; i < 32; i++) row[pick(rng)] += 12.0f + noise(rng);
+    }
+    std::vector<float> work(n_vocab);
+
+    std::string report;
+    char line[160];
+    llama_token sink = 0;
+
+    auto run = [&](const char* name, auto&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            const auto& src = inputs[it % inputs.size()];
+            std::copy(src.begin(), src.end(), work.begin());
+            sink ^= fn(work.data());
+        }
+        auto end = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+        snprintf(line, sizeof(line), "%s: %.1f us/token\n", name, us);
+        report += line;
+    };
+
+    // 拷贝本身的开销，作为基线
+    run("copy-only", [&](float*) { return (llama_token)0; });
+
+    run("greedy scalar", [&](float* l) { return ScalarArgmax(l, n_vocab); });
+    run("greedy simd", [&](float* l) { return ArgmaxLogits(l, n_vocab); });
+
+    // llama_sampler 原生链：每个 token 构造全词表候选数组
+    {
+        llama_sampler* full = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        llama_sampler_chain_add(full, llama_sampler_init_top_k(40));
+        llama_sampler_chain_add(full, llama_sampler_init_top_p(0.95f, 1));
+        llama_sampler_chain_add(full, llama_sampler_init_min_p(0.05f, 1));
+        llama_sampler_chain_add(full, llama_sampler_init_temp(0.8f));
+        llama_sampler_chain_add(full, llama_sampler_init_dist(1234));
+        std::vector<llama_token_data> cur(n_vocab);
+        run("top-k40/top-p/min-p/temp full-vocab", [&](float* l) {
+            for (int i = 0; i < n_vocab; i++) cur[i] = {i, l[i], 0.0f};
+            llama_token_data_array arr = {cur.data(), cur.size(), -1, false};
+            llama_sampler_apply(full, &arr);
+            return arr.data[arr.selected].id;
+        });
+        llama_sampler_free(full);
+    }
+
+    LlmSamplingParams p;
+    p.temperature = 0.8f;
+    p.seed = 1234;
+    {
+        LlmSampler s(p);
+        run("top-k40/top-p/min-p/temp simd", [&](float* l) { return s.Sample(l, n_vocab); });
+    }
+
+    p.penalty_repeat = 1.1f;
+    {
+        LlmSampler s(p);
+        run("top-k40/top-p/min-p/temp/penalties simd", [&](float* l) {
+            llama_token t = s.Sample(l, n_vocab);
+            s.Accept(t);
+            return t;
+        });
+    }
+
+    snprintf(line, sizeof(line), "n_vocab=%d iterations=%d (checksum %d)\n", n_vocab, iterations, (int)sink);
+    report += line;
+    return report;
+}
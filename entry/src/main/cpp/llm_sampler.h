@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include "llama.h"
+
+// 采样参数 (每个会话一份，可由 NAPI 配置)
+struct LlmSamplingParams {
+    float temperature = 0.0f;    // <= 0 为贪心解码
+    int32_t top_k = 40;          // <= 0 表示不截断 (退化为全词表)
+    float top_p = 0.95f;
+    float min_p = 0.05f;
+    int32_t penalty_last_n = 64;
+    float penalty_repeat = 1.0f;
+    float penalty_freq = 0.0f;
+    float penalty_present = 0.0f;
+    uint32_t seed = LLAMA_DEFAULT_SEED;
+};
+
+// 基于 llama_sampler 的采样器
+// 全词表只做一次 SIMD 扫描 (argmax 或分块求最大值)，之后 top-p/min-p/temp/dist
+// 只作用在 top-k 候选上；惩罚项只改动历史里出现过的 token
+class LlmSampler {
+public:
+    explicit LlmSampler(const LlmSamplingParams& params);
+    ~LlmSampler();
+
+    LlmSampler(const LlmSampler&) = delete;
+    LlmSampler& operator=(const LlmSampler&) = delete;
+
+    // 每轮回复开始时调用，清空惩罚窗口
+    void Reset();
+
+    // logits 会被原地施加惩罚
+    llama_token Sample(float* logits, int n_vocab);
+
+    void Accept(llama_token token);
+
+    const LlmSamplingParams& Params() const { return params; }
+
+private:
+    bool HasPenalties() const;
+    void ApplyPenalties(float* logits);
+
+    LlmSamplingParams params;
+    llama_sampler* penalties = nullptr;
+    llama_sampler* chain = nullptr;   // top_p -> min_p -> temp -> dist
+    std::deque<llama_token> recent;
+    std::vector<llama_token_data> candidates;
+    std::vector<float> scratch;
+};
+
+// ---- SIMD 工具 (NEON，非 ARM 平台回退到标量) ----
+
+// 全词表 argmax，相同值取下标最小者
+llama_token ArgmaxLogits(const float* logits, int n);
+
+// 选出 logit 最大的 k 个 token，按降序写入 out，返回实际数量
+int SelectTopK(const float* logits, int n, int k, std::vector<llama_token_data>& out, std::vector<float>& scratch);
+
+// 采样开销基准：对随机 logits 统计各采样链的 µs/token
+std::string BenchmarkSampling(int n_vocab, int iterations);
@@ -0,0 +1,439 @@
+#include "llm_session.h"
+#include "latency_tracer.h"
+#include "hash_util.h"
+
+#include <hilog/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#undef LOG_DOMAIN
+#undef LOG_TAG
+#define LOG_DOMAIN 0x0000
+#define LOG_TAG "LLM_SESSION"
+#define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+
+// seq 0 专门存放系统提示词前缀，会话从 1 开始分配
+static const llama_seq_id kPrefixSeq = 0;
+
+void LlmSessionManager::Bind(llama_model* m, llama_context* c) {
+    Unbind();
+    model = m;
+    ctx = c;
+    n_batch = (int)llama_n_batch(ctx);
+    batch = llama_batch_init(n_batch, 0, 1);
+}
+
+void LlmSessionManager::Unbind() {
+    if (batch.token) {
+        llama_batch_free(batch);
+        batch = {};
+    }
+    sessions.clear();
+    std::fill(std::begin(seq_used), std::end(seq_used), false);
+    prefix_ready = false;
+    prefix_len = 0;
+    state_cache_dir.clear();
+    model_fingerprint = 0;
+    model = nullptr;
+    ctx = nullptr;
+}
+
+void LlmSessionManager::SetStateCacheDir(const std::string& dir, const std::string& model_path) {
+    state_cache_dir = dir;
+    model_fingerprint = 0;
+    if (dir.empty() || !model || !ctx) return;
+
+    // 不读整个 GGUF：用文件大小/修改时间 + 模型描述 + 影响 KV 布局的上下文参数做指纹
+    struct stat st = {};
+    stat(model_path.c_str(), &st);
+    char desc[256] = {0};
+    llama_model_desc(model, desc, sizeof(desc));
+    uint64_t fields[] = {
+        (uint64_t)st.st_size, (uint64_t)st.st_mtime, llama_model_n_params(model),
+        (uint64_t)llama_n_ctx(ctx), (uint64_t)llama_n_seq_max(ctx),
+    };
+    uint64_t h = Fnv1a(model_path.data(), model_path.size());
+    h = Fnv1a(desc, strlen(desc), h);
+    model_fingerprint = Fnv1a(fields, sizeof(fields), h);
+}
+
+std::string LlmSessionManager::PrefixSnapshotPath(const std::string& text) const {
+    char name[64];
+    snprintf(name, sizeof(name), "/prefix-%016llx-%016llx.kv",
+             (unsigned long long)model_fingerprint,
+             (unsigned long long)Fnv1a(text.data(), text.size()));
+    return state_cache_dir + name;
+}
+
+bool LlmSessionManager::LoadPrefixSnapshot(const std::string& path, const std::vector<llama_token>& tokens) {
+    if (access(path.c_str(), R_OK) != 0) return false;
+
+    std::vector<llama_token> saved(tokens.size());
+    size_t n_saved = 0;
+    size_t n_read = llama_state_seq_load_file(ctx, path.c_str(), kPrefixSeq,
+                                              saved.data(), saved.size(), &n_saved);
+    // 词表或提示词对不上就当作没有快照
+    if (n_read == 0 || n_saved != tokens.size() ||
+        !std::equal(tokens.begin(), tokens.end(), saved.begin())) {
+        llama_memory_seq_rm(llama_get_memory(ctx), kPrefixSeq, -1, -1);
+        return false;
+    }
+    return true;
+}
+
+void LlmSessionManager::SetSystemPrompt(const std::string& text) {
+    std::lock_guard<std::mutex> lock(pending_mtx);
+    pending_system_prompt = text;
+    has_pending_system_prompt = true;
+}
+
+void LlmSessionManager::Release(const std::string& id) {
+    std::lock_guard<std::mutex> lock(pending_mtx);
+    pending_release.push_back(id);
+    sampling_params.erase(id);
+}
+
+void LlmSessionManager::SetSamplingParams(const std::string& id, const LlmSamplingParams& params) {
+    std::lock_guard<std::mutex> lock(pending_mtx);
+    sampling_params[id] = params;
+    sampling_dirty = true;
+}
+
+void LlmSessionManager::ApplyPending() {
+    std::deque<std::string> releases;
+    {
+        std::lock_guard<std::mutex> lock(pending_mtx);
+        // 正在生成的会话还在用旧的采样器/KV，相关变更等它结束后再生效
+        bool any_busy = false;
+        if (sampling_dirty) {
+            sampling_dirty = false;
+            for (auto& kv : sessions) {
+                auto it = sampling_params.find(kv.first);
+                if (it == sampling_params.end()) continue;
+                if (kv.second.busy) {
+                    sampling_dirty = true;
+                    continue;
+                }
+                kv.second.sampling = it->second;
+                kv.second.sampler.reset();
+            }
+        }
+        for (auto& kv : sessions) any_busy = any_busy || kv.second.busy;
+        if (has_pending_system_prompt && !any_busy) {
+            if (pending_system_prompt != system_prompt) {
+                system_prompt = pending_system_prompt;
+                prefix_ready = false;
+            }
+            has_pending_system_prompt = false;
+        }
+        releases.swap(pending_release);
+    }
+
+    llama_memory_t mem = llama_get_memory(ctx);
+    for (const auto& id : releases) {
+        auto it = sessions.find(id);
+        if (it == sessions.end()) continue;
+        if (it->second.busy) {
+            std::lock_guard<std::mutex> lock(pending_mtx);
+            pending_release.push_back(id);
+            continue;
+        }
+        llama_memory_seq_rm(mem, it->second.seq_id, -1, -1);
+        seq_used[it->second.seq_id] = false;
+        sessions.erase(it);
+        LOGI("🗑️ 释放会话: %{public}s", id.c_str());
+    }
+}
+
+std::vector<llama_token> LlmSessionManager::Tokenize(const std::string& text, bool add_special) {
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+    std::vector<llama_token> tokens(text.length() + 16);
+    int n = llama_tokenize(vocab, text.c_str(), text.length(), tokens.data(), tokens.size(), add_special, true);
+    if (n < 0) {
+        tokens.resize(-n);
+        n = llama_tokenize(vocab, text.c_str(), text.length(), tokens.data(), tokens.size(), add_special, true);
+    }
+    tokens.resize(std::max(n, 0));
+    return tokens;
+}
+
+int LlmSessionManager::DecodeTokens(llama_seq_id seq, llama_pos pos, const std::vector<llama_token>& tokens) {
+    // 按 n_batch 分块，只有整段最后一个 token 需要 logits
+    for (size_t start = 0; start < tokens.size(); start += n_batch) {
+        size_t n = std::min(tokens.size() - start, (size_t)n_batch);
+        batch.n_tokens = (int32_t)n;
+        for (size_t i = 0; i < n; i++) {
+            batch.token[i] = tokens[start + i];
+            batch.pos[i] = pos + (llama_pos)i;
+            batch.n_seq_id[i] = 1;
+            batch.seq_id[i][0] = seq;
+            batch.logits[i] = (start + i == tokens.size() - 1);
+        }
+        int ret = llama_decode(ctx, batch);
+        if (ret != 0) return ret;
+        pos += (llama_pos)n;
+    }
+    return 0;
+}
+
+bool LlmSessionManager::EnsurePrefix() {
+    if (prefix_ready) return true;
+
+    llama_memory_t mem = llama_get_memory(ctx);
+    llama_memory_seq_rm(mem, kPrefixSeq, -1, -1);
+    prefix_len = 0;
+
+    std::string text = "<|im_start|>system\n" + system_prompt + "<|im_end|>\n";
+    std::vector<llama_token> tokens = Tokenize(text, true);
+    std::string snapshot = state_cache_dir.empty() ? "" : PrefixSnapshotPath(text);
+    if (!snapshot.empty() && LoadPrefixSnapshot(snapshot, tokens)) {
+        LOGI("💾 加载系统提示词快照: %{public}s", snapshot.c_str());
+    } else {
+        if (DecodeTokens(kPrefixSeq, 0, tokens) != 0) {
+            LOGE("❌ 系统提示词 prefill 失败");
+            llama_memory_seq_rm(mem, kPrefixSeq, -1, -1);
+            return false;
+        }
+        // 先写临时文件再改名，避免中途断电留下半个快照
+        if (!snapshot.empty()) {
+            std::string tmp = snapshot + ".tmp";
+            if (llama_state_seq_save_file(ctx, tmp.c_str(), kPrefixSeq, tokens.data(), tokens.size()) > 0 &&
+                rename(tmp.c_str(), snapshot.c_str()) == 0) {
+                LOGI("💾 保存系统提示词快照: %{public}s", snapshot.c_str());
+            } else {
+                unlink(tmp.c_str());
+            }
+        }
+    }
+    prefix_len = (llama_pos)tokens.size();
+    seq_used[kPrefixSeq] = true;
+    prefix_ready = true;
+    LOGI("📌 系统提示词前缀已缓存: %{public}d tokens", (int)prefix_len);
+
+    // 前缀变了，已有会话的历史全部作废
+    for (auto& kv : sessions) {
+        ResetToPrefix(&kv.second);
+    }
+    return true;
+}
+
+void LlmSessionManager::ResetToPrefix(LlmSession* s) {
+    llama_memory_t mem = llama_get_memory(ctx);
+    llama_memory_seq_rm(mem, s->seq_id, -1, -1);
+    llama_memory_seq_cp(mem, kPrefixSeq, s->seq_id, -1, -1);
+    s->n_past = prefix_len;
+    s->reply_open = false;
+    s->spec_tokens.clear();
+}
+
+void LlmSessionManager::DropSpeculation(LlmSession* s) {
+    if (s->spec_tokens.empty()) return;
+    llama_memory_seq_rm(llama_get_memory(ctx), s->seq_id, s->n_past, -1);
+    s->spec_tokens.clear();
+}
+
+std::string LlmSessionManager::UserTurnHead(const LlmSession* s) const {
+    return s->reply_open ? "<|im_end|>\n<|im_start|>user\n" : "<|im_start|>user\n";
+}
+
+bool LlmSessionManager::EvictOne(const LlmSession* keep) {
+    auto victim = sessions.end();
+    for (auto it = sessions.begin(); it != sessions.end(); ++it) {
+        if (&it->second == keep || it->second.busy) continue;
+        if (victim == sessions.end() || it->second.last_used < victim->second.last_used) {
+            victim = it;
+        }
+    }
+    if (victim == sessions.end()) return false;
+
+    LOGI("♻️ 淘汰会话: %{public}s", victim->first.c_str());
+    llama_memory_seq_rm(llama_get_memory(ctx), victim->second.seq_id, -1, -1);
+    seq_used[victim->second.seq_id] = false;
+    sessions.erase(victim);
+    return true;
+}
+
+LlmSession* LlmSessionManager::Acquire(const std::string& id) {
+    return AcquireSession(id, true);
+}
+
+LlmSession* LlmSessionManager::TryAcquire(const std::string& id) {
+    return AcquireSession(id, false);
+}
+
+LlmSession* LlmSessionManager::AcquireSession(const std::string& id, bool may_evict) {
+    if (!model || !ctx) return nullptr;
+
+    ApplyPending();
+    if (!EnsurePrefix()) return nullptr;
+
+    auto it = sessions.find(id);
+    if (it != sessions.end()) {
+        it->second.last_used = ++use_counter;
+        return &it->second;
+    }
+
+    int max_seq = std::min((int)llama_n_seq_max(ctx), kMaxSeq);
+    llama_seq_id seq = -1;
+    for (int i = 1; i < max_seq && seq < 0; i++) {
+        if (!seq_used[i]) seq = i;
+    }
+    if (seq < 0) {
+        if (!may_evict || !EvictOne(nullptr)) return nullptr;
+        for (int i = 1; i < max_seq && seq < 0; i++) {
+            if (!seq_used[i]) seq = i;
+        }
+        if (seq < 0) return nullptr;
+    }
+
+    LlmSession& s = sessions[id];
+    s.id = id;
+    {
+        std::lock_guard<std::mutex> lock(pending_mtx);
+        auto pit = sampling_params.find(id);
+        if (pit != sampling_params.end()) s.sampling = pit->second;
+    }
+    s.seq_id = seq;
+    s.last_used = ++use_counter;
+    seq_used[seq] = true;
+    ResetToPrefix(&s);
+    LOGI("🆕 新建会话: %{public}s -> seq %{public}d", id.c_str(), (int)seq);
+    return &s;
+}
+
+bool LlmSessionManager::Speculate(LlmSession* s, const std::string& partial) {
+    std::vector<llama_token> tokens = Tokenize(UserTurnHead(s) + partial, false);
+    // 最后一个 token 可能和后面识别出的字合并成别的 token，先不写入
+    if (!tokens.empty()) tokens.pop_back();
+
+    // 与已写入的投机 token 比较，删掉分歧之后的部分
+    size_t common = 0;
+    while (common < tokens.size() && common < s->spec_tokens.size() &&
+           tokens[common] == s->spec_tokens[common]) {
+        common++;
+    }
+    if (common < s->spec_tokens.size()) {
+        llama_memory_seq_rm(llama_get_memory(ctx), s->seq_id, s->n_past + (llama_pos)common, -1);
+        s->spec_tokens.resize(common);
+    }
+    if (common == tokens.size()) return true;
+
+    // 投机只用空闲的 KV，不挤占回复预留，也不淘汰其他会话
+    int n_ctx = (int)llama_n_ctx(ctx);
+    if (s->n_past + (int)tokens.size() + kReserveForReply > n_ctx) return false;
+
+    std::vector<llama_token> tail(tokens.begin() + common, tokens.end());
+    if (DecodeTokens(s->seq_id, s->n_past + (llama_pos)common, tail) != 0) {
+        DropSpeculation(s);
+        return false;
+    }
+    s->spec_tokens.swap(tokens);
+    s->last_used = ++use_counter;
+    return true;
+}
+
+bool LlmSessionManager::PrefillUserTurn(LlmSession* s, const std::string& prompt) {
+    std::string body = prompt + "<|im_end|>\n<|im_start|>assistant\n";
+    std::vector<llama_token> tokens = Tokenize(UserTurnHead(s) + body, false);
+    LatencyTracer::Instance().Mark(s->id, TURN_PROMPT_TOKENIZED);
+
+    // 历史过长：丢弃历史，只保留系统提示词前缀
+    int n_ctx = (int)llama_n_ctx(ctx);
+    if (s->n_past + (int)tokens.size() + kReserveForReply > n_ctx) {
+        LOGI("✂️ 会话 %{public}s 历史过长，回退到系统提示词", s->id.c_str());
+        ResetToPrefix(s);
+        tokens = Tokenize(UserTurnHead(s) + body, false);
+    }
+
+    // 复用投机 prefill 中与最终输入一致的前缀 (至少留一个 token 重新解码以拿到 logits)
+    size_t reused = 0;
+    while (reused + 1 < tokens.size() && reused < s->spec_tokens.size() &&
+           tokens[reused] == s->spec_tokens[reused]) {
+        reused++;
+    }
+    llama_memory_seq_rm(llama_get_memory(ctx), s->seq_id, s->n_past + (llama_pos)reused, -1);
+    if (!s->spec_tokens.empty()) {
+        LOGI("⚡ 复用投机 prefill: %{public}d/%{public}d tokens", (int)reused, (int)tokens.size());
+    }
+    s->spec_tokens.clear();
+
+    llama_pos n_past_before = s->n_past;
+    while (true) {
+        std::vector<llama_token> todo(tokens.begin() + reused, tokens.end());
+        int ret = DecodeTokens(s->seq_id, n_past_before + (llama_pos)reused, todo);
+        if (ret == 0) break;
+
+        // 回滚本轮写入的全部内容，再尝试腾出 KV 空间
+        llama_memory_seq_rm(llama_get_memory(ctx), s->seq_id, n_past_before, -1);
+        reused = 0;
+        if (ret != 1) {
+            LOGE("❌ prefill 失败: %{public}d", ret);
+            return false;
+        }
+        if (EvictOne(s)) continue;
+        if (n_past_before > prefix_len) {
+            ResetToPrefix(s);
+            n_past_before = s->n_past;
+            tokens = Tokenize(UserTurnHead(s) + body, false);
+            continue;
+        }
+        LOGE("❌ KV 空间不足");
+        return false;
+    }
+    s->n_past = n_past_before + (llama_pos)tokens.size();
+    s->reply_open = false;
+    return true;
+}
+
+bool LlmSessionManager::DecodeToken(LlmSession* s, llama_token token) {
+    s->reply_open = true;
+    DropSpeculation(s);
+    if (DecodeTokens(s->seq_id, s->n_past, {token}) != 0) return false;
+    s->n_past++;
+    return true;
+}
+
+bool LlmSessionManager::DecodeStep(const std::vector<LlmSession*>& ss, const std::vector<llama_token>& tokens) {
+    if (ss.empty() || ss.size() > (size_t)n_batch) return false;
+    for (LlmSession* s : ss) {
+        s->reply_open = true;
+        DropSpeculation(s);
+    }
+    while (true) {
+        batch.n_tokens = (int32_t)ss.size();
+        for (size_t i = 0; i < ss.size(); i++) {
+            batch.token[i] = tokens[i];
+            batch.pos[i] = ss[i]->n_past;
+            batch.n_seq_id[i] = 1;
+            batch.seq_id[i][0] = ss[i]->seq_id;
+            batch.logits[i] = true;
+        }
+        int ret = llama_decode(ctx, batch);
+        if (ret == 0) break;
+        // KV 满了就淘汰一个空闲会话再试
+        if (ret == 1 && EvictOne(nullptr)) continue;
+        LOGE("❌ 批量解码失败: %{public}d (%{public}d 个会话)", ret, (int)ss.size());
+        return false;
+    }
+    for (LlmSession* s : ss) {
+        s->n_past++;
+        s->last_used = ++use_counter;
+    }
+    return true;
+}
+
+LlmSampler* LlmSessionManager::GetSampler(LlmSession* s) {
+    if (!s->sampler) {
+        s->sampler.reset(new LlmSampler(s->sampling));
+    }
+    return s->sampler.get();
+}
+
+void LlmSessionManager::EndReply(LlmSession* s) {
+    s->reply_open = true;
+    s->last_used = ++use_counter;
+}
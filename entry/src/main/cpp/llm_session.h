@@ -0,0 +1,123 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include "llama.h"
+#include "llm_sampler.h"
+
+// 单个对话会话：独占一个 llama_seq_id
+// KV 中的布局为 [系统提示词前缀 | 历史轮次 ...]，每轮只追加新内容
+struct LlmSession {
+    std::string id;
+    llama_seq_id seq_id = -1;
+    llama_pos n_past = 0;      // 该序列已写入 KV 的 token 数 (即下一个 token 的位置)
+    bool reply_open = false;   // 上一轮回复还没有 <|im_end|> 收尾
+    // 用户还在说话时按 ASR 中间结果预先写入 KV 的 token，位置从 n_past 开始，尚未提交
+    std::vector<llama_token> spec_tokens;
+    uint64_t last_used = 0;    // LRU 淘汰用
+    bool busy = false;         // 正在生成回复：不淘汰、不释放、不重建采样器
+    LlmSamplingParams sampling;
+    std::unique_ptr<LlmSampler> sampler; // 按 sampling 懒构建
+};
+
+// 会话管理器：seq 0 固定保存预解码的系统提示词，
+// 新会话通过 llama_memory_seq_cp 共享这段前缀，避免每轮重复 prefill
+class LlmSessionManager {
+public:
+    static LlmSessionManager& Instance() {
+        static LlmSessionManager instance;
+        return instance;
+    }
+
+    // 最多同时保留的序列数 (含 seq 0 前缀)
+    static constexpr int kMaxSeq = 8;
+    // 为生成预留的 KV 空间，历史过长时先丢弃历史再 prefill
+    static constexpr int kReserveForReply = 512;
+
+    // 绑定/解绑模型与上下文 (由 NativeLoad 调用)
+    void Bind(llama_model* model, llama_context* ctx);
+    void Unbind();
+
+    // 开启系统提示词 KV 快照：dir 为空则关闭
+    // 快照文件按 模型指纹 + 提示词哈希 命名，重启后直接加载，跳过前缀 prefill
+    void SetStateCacheDir(const std::string& dir, const std::string& model_path);
+
+    // 以下两个接口可在任意线程调用，真正的 KV 操作延迟到 LLM 线程执行
+    void SetSystemPrompt(const std::string& text);
+    void Release(const std::string& id);
+    void SetSamplingParams(const std::string& id, const LlmSamplingParams& params);
+
+    // ---- 以下接口只允许在 LLM 后台线程调用 ----
+
+    // 获取 (或新建) 会话，必要时淘汰最久未用的会话
+    LlmSession* Acquire(const std::string& id);
+
+    // 同上，但没有空闲序列时返回 nullptr，不淘汰其他会话 (投机 prefill 用)
+    LlmSession* TryAcquire(const std::string& id);
+
+    // 按 ASR 中间结果投机 prefill 本轮用户输入的前半段 (不提交 n_past)，
+    // 与上次投机结果不一致的尾部会先从 KV 删除再重新解码
+    bool Speculate(LlmSession* s, const std::string& partial);
+
+    // 追加一轮用户输入，只 prefill 新增 token；成功后最后一个 token 的 logits 可用
+    // 投机结果中与最终文本一致的前缀直接复用，只解码分歧之后的部分
+    bool PrefillUserTurn(LlmSession* s, const std::string& prompt);
+
+    // 解码一个生成出来的 token
+    bool DecodeToken(LlmSession* s, llama_token token);
+
+    // 多个会话各解码一个生成出来的 token，合成一个 batch 只跑一次前向；
+    // 成功后第 i 个会话的 logits 用 llama_get_logits_ith(ctx, i) 取
+    bool DecodeStep(const std::vector<LlmSession*>& ss, const std::vector<llama_token>& tokens);
+
+    // 取会话的采样器 (参数变更后重建)
+    LlmSampler* GetSampler(LlmSession* s);
+
+    // 本轮回复结束 (EOG 本身不写入 KV，下一轮开头补上 <|im_end|>)
+    void EndReply(LlmSession* s);
+
+private:
+    LlmSessionManager() = default;
+
+    void ApplyPending();
+    bool EnsurePrefix();
+    void ResetToPrefix(LlmSession* s);
+    bool EvictOne(const LlmSession* keep);
+    LlmSession* AcquireSession(const std::string& id, bool may_evict);
+    std::vector<llama_token> Tokenize(const std::string& text, bool add_special);
+    std::string UserTurnHead(const LlmSession* s) const;
+    // 从 pos 开始把 tokens 写入 seq，返回值同 llama_decode
+    int DecodeTokens(llama_seq_id seq, llama_pos pos, const std::vector<llama_token>& tokens);
+    void DropSpeculation(LlmSession* s);
+    std::string PrefixSnapshotPath(const std::string& text) const;
+    bool LoadPrefixSnapshot(const std::string& path, const std::vector<llama_token>& tokens);
+
+    llama_model* model = nullptr;
+    llama_context* ctx = nullptr;
+    llama_batch batch = {};
+    int n_batch = 0;
+
+    std::unordered_map<std::string, LlmSession> sessions;
+    bool seq_used[kMaxSeq] = {};
+    uint64_t use_counter = 0;
+
+    std::string system_prompt = "You are a helpful assistant.";
+    bool prefix_ready = false;
+    llama_pos prefix_len = 0;
+
+    std::string state_cache_dir;
+    uint64_t model_fingerprint = 0;
+
+    // 跨线程的待处理请求
+    std::mutex pending_mtx;
+    std::string pending_system_prompt;
+    bool has_pending_system_prompt = false;
+    std::deque<std::string> pending_release;
+    // 采样参数按会话 ID 保存，会话被淘汰后重建时仍然生效
+    std::unordered_map<std::string, LlmSamplingParams> sampling_params;
+    bool sampling_dirty = false;
+};
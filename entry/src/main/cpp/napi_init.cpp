@@ -1,13 +1,22 @@
 #include "napi/native_api.h"
 #include "llama.h"
 #include "tts_manager.h"
+#include "llm_session.h"
+#include "native_events.h"
+#include "cpu_budget.h"
+#include "latency_tracer.h"
+#include "sherpa_napi.h"
 #include <string>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <cstdio>
 #include <cstring>
 #include <hilog/log.h>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <unistd.h>
 #include <iostream>
@@ -23,6 +32,7 @@
 extern napi_value InitSherpa(napi_env env, napi_callback_info info);
 extern napi_value AcceptWaveform(napi_env env, napi_callback_info info);
 extern napi_value ResetSherpa(napi_env env, napi_callback_info info);
+extern napi_value FinishSherpa(napi_env env, napi_callback_info info);
 extern napi_value GetRecognizedText(napi_env env, napi_callback_info info);
 extern napi_value GetQueueSize(napi_env env, napi_callback_info info);
 
@@ -33,13 +43,39 @@ static llama_model* g_model = nullptr;
 static llama_context* g_ctx = nullptr;
 
 static std::mutex g_llm_mutex;
-static std::string g_llm_input_prompt = "";
-static std::string g_llm_output_buffer = "";
+static std::condition_variable g_llm_cv; // 有新问题时唤醒 LLM 线程
+
+// 一次提问：每个会话最多排一个，新的提问覆盖还没开始的旧提问
+struct LlmRequest {
+    std::string prompt;
+    std::string session_id;
+    napi_threadsafe_function on_token = nullptr; // nativeChat 传入的 onToken
+};
+static std::deque<LlmRequest> g_llm_requests;
+// 投机 prefill：用户还在说话时，ASR 中间结果先写入该会话的 KV (每个会话只保留最新一条)
+static std::unordered_map<std::string, std::string> g_llm_spec_texts;
+// 被打断 (stopTts / 断开) 的会话，LLM 线程下一步结束它们正在生成的回复
+static std::unordered_set<std::string> g_llm_cancel;
+// 没有 onToken 监听时给 getLlmResult 轮询的缓冲区
+static std::unordered_map<std::string, std::string> g_llm_output_buffers;
 static std::atomic<bool> g_llm_running = false;
 static std::thread* g_llm_thread = nullptr;
-
-// 🔥 TTS 专用分句缓冲区 🔥
-static std::string g_sentence_accumulator = "";
+// nativeLoad 换模型时先让 LLM 线程停在安全点：结束所有回复后等着，换完再继续 (g_llm_mutex 保护)
+static bool g_llm_reload = false;
+static bool g_llm_parked = false;
+static std::condition_variable g_llm_parked_cv; // LLM 线程停好后通知 nativeLoad
+
+// 正在生成的回复 (只在 LLM 线程访问)：所有回复每步合成一个 batch 解码，轮流出 token
+struct ActiveReply {
+    std::string session_id;
+    LlmSession* session = nullptr;
+    LlmSampler* sampler = nullptr;
+    napi_threadsafe_function on_token = nullptr;
+    llama_token pending = 0;     // 已采样、待写入 KV 的 token
+    int n_generated = 0;
+    std::string reply;
+    std::string sentence;        // 🔥 TTS 专用分句缓冲区 🔥
+};
 
 // 分句结果结构体
 struct SplitInfo {
@@ -76,146 +112,344 @@ SplitInfo FindFirstPunctuation(const std::string& text) {
     return {false, 0, 0};
 }
 
+// 单回复最多生成的 token 数
+static const int kMaxReplyTokens = 512;
+
+// 安全的循环分句：缓冲区里有完整的句子（可能不止一句）就切下来送给这个会话的 TTS
+static void FlushSentences(ActiveReply& r) {
+    while (true) {
+        SplitInfo info = FindFirstPunctuation(r.sentence);
+        
+        if (info.found) {
+            // 计算截取长度：标点位置 + 标点长度
+            size_t cutLength = info.startPos + info.length;
+            
+            std::string sentence = r.sentence.substr(0, cutLength);
+            
+            // 发送这一句给 TTS
+            if (!sentence.empty()) {
+                LOGI("🗣️ 完整分句 TTS [%{public}s]: %{public}s", r.session_id.c_str(), sentence.c_str());
+                TtsManager::Instance().PushText(r.session_id, sentence);
+            }
+            
+            // 从缓冲区移除这一句，保留剩下的
+            r.sentence = r.sentence.substr(cutLength);
+        } else {
+            // 没找到标点，但如果太长了 (超过60字节，约20汉字)，强制切断防止卡顿
+            if (r.sentence.length() > 60) {
+                 LOGI("🗣️ 长度强制 TTS [%{public}s]: %{public}s", r.session_id.c_str(), r.sentence.c_str());
+                 TtsManager::Instance().PushText(r.session_id, r.sentence);
+                 r.sentence = "";
+            }
+            break; // 退出循环，等待下一个 Token
+        }
+    }
+}
+
+// 处理采样出的 token：推送给 JS 和 TTS，返回 false 表示回复结束 (EOG)
+static bool HandleToken(ActiveReply& r, const llama_vocab* vocab, llama_token token) {
+    if (r.n_generated == 0) LatencyTracer::Instance().Mark(r.session_id, TURN_FIRST_TOKEN);
+    r.sampler->Accept(token);
+    if (llama_vocab_is_eog(vocab, token)) return false;
+
+    char buf[256];
+    int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+    if (n < 0) {
+         n = -n;
+         llama_token_to_piece(vocab, token, buf, n, 0, true);
+    }
+    buf[n] = '\0';
+    std::string piece(buf);
+    r.reply += piece;
+
+    // 推送给 JS：请求级回调优先，其次全局 onToken，都没有才进轮询缓冲区
+    bool pushed = false;
+    if (r.on_token) {
+        CallTokenCallback(r.on_token, piece, r.session_id);
+        pushed = true;
+    } else {
+        pushed = EmitToken(piece, r.session_id);
+    }
+    if (!pushed) {
+        std::lock_guard<std::mutex> lock(g_llm_mutex);
+        g_llm_output_buffers[r.session_id] += piece; // 给界面显示
+    }
+
+    r.sentence += piece; // 给 TTS 缓冲
+    FlushSentences(r);
+
+    r.pending = token;
+    r.n_generated++;
+    return true;
+}
+
+// 结束回复：flush 为 false 时是被打断，剩下的半句不再送 TTS
+static void FinishReply(ActiveReply& r, bool flush) {
+    LlmSessionManager& sessions = LlmSessionManager::Instance();
+    // 4. 收尾：把剩下的文本也发出去
+    if (flush && !r.sentence.empty()) {
+         LOGI("🗣️ 剩余文本 TTS [%{public}s]: %{public}s", r.session_id.c_str(), r.sentence.c_str());
+         TtsManager::Instance().PushText(r.session_id, r.sentence);
+    }
+    r.sentence = "";
+    if (r.session) {
+        sessions.EndReply(r.session);
+        r.session->busy = false;
+    }
+    ReleaseTokenCallback(r.on_token);
+    r.on_token = nullptr;
+    if (g_ctx) LatencyTracer::Instance().SetLlamaPerf(llama_perf_context(g_ctx));
+    EmitFinal("llm", r.reply, r.session_id);
+    LOGI("✅ LLM 回复完成 [%{public}s]%{public}s", r.session_id.c_str(), flush ? "" : " (打断)");
+}
+
+// 开始一轮回复：prefill 用户输入并采样第一个 token，失败或立即结束时返回 false
+static bool StartReply(ActiveReply& r, const std::string& prompt) {
+    LlmSessionManager& sessions = LlmSessionManager::Instance();
+    LOGI("🤖 LLM 开始思考 [%{public}s]: %{public}s", r.session_id.c_str(), prompt.c_str());
+
+    // 1. 取会话 (新会话直接复用已解码的系统提示词前缀)
+    r.session = sessions.Acquire(r.session_id);
+    if (!r.session) {
+        LOGE("❌ 无可用会话");
+        FinishReply(r, false);
+        return false;
+    }
+    r.session->busy = true;
+
+    // 2. 只 prefill 本轮新增的用户输入
+    if (!sessions.PrefillUserTurn(r.session, prompt)) {
+        LOGE("❌ Llama decode failed");
+        r.session->busy = false;
+        r.session = nullptr;
+        FinishReply(r, false);
+        return false;
+    }
+    LatencyTracer::Instance().Mark(r.session_id, TURN_PREFILL_DONE);
+
+    // 3. prefill 刚写完 logits，马上采样第一个 token
+    const llama_vocab* vocab = llama_model_get_vocab(g_model);
+    r.sampler = sessions.GetSampler(r.session);
+    r.sampler->Reset();
+    float* logits = llama_get_logits_ith(g_ctx, -1);
+    llama_token token = r.sampler->Sample(logits, llama_vocab_n_tokens(vocab));
+    if (!HandleToken(r, vocab, token)) {
+        FinishReply(r, true);
+        return false;
+    }
+    return true;
+}
+
 // 🔥 LLM 后台工作线程 🔥
+// 多会话调度：新提问先 prefill 并出第一个 token，之后所有进行中的回复
+// 每步合成一个 batch 一起解码，每个会话每步出一个 token，互不阻塞
 void LlmBackgroundWorker() {
     LOGI("🧵 LLM 后台线程已启动");
+    CpuBudget& budget = CpuBudget::Instance();
+    budget.RegisterCurrentThread(CPU_ENGINE_LLM);
+    uint32_t budget_gen = 0;
+    // 阶段变化后按新的 LLM 核心区间换线程池、调整线程数
+    auto apply_budget = [&budget, &budget_gen]() {
+        int threads = 0;
+        if (g_ctx && budget.Poll(CPU_ENGINE_LLM, &budget_gen, &threads)) {
+            budget.AttachLlama(g_ctx);
+        }
+    };
+
+    std::vector<ActiveReply> replies;
+    std::vector<LlmSession*> step_sessions;
+    std::vector<llama_token> step_tokens;
     while (g_llm_running) {
-        std::string prompt;
+        std::deque<LlmRequest> admit;
+        std::unordered_set<std::string> cancels;
+        std::string spec_session;
+        std::string spec_text;
         {
-            std::lock_guard<std::mutex> lock(g_llm_mutex);
-            if (!g_llm_input_prompt.empty()) {
-                prompt = g_llm_input_prompt;
-                g_llm_input_prompt = "";
-                // 新任务开始：彻底清空 TTS 缓冲区
-                g_sentence_accumulator = ""; 
+            // 没有任务时阻塞等待，不再 20ms 轮询
+            std::unique_lock<std::mutex> lock(g_llm_mutex);
+            g_llm_cv.wait(lock, [&replies] {
+                return !replies.empty() || !g_llm_requests.empty() || !g_llm_cancel.empty() ||
+                       !g_llm_spec_texts.empty() || g_llm_reload || !g_llm_running;
+            });
+            if (!g_llm_running) break;
+
+            if (g_llm_reload) {
+                // 旧模型的会话和 KV 马上要释放：回复全部作废，停下来等新模型
+                lock.unlock();
+                for (auto& r : replies) FinishReply(r, false);
+                replies.clear();
+                budget.SetActive(CPU_ENGINE_LLM, false);
+                lock.lock();
+                g_llm_parked = true;
+                g_llm_parked_cv.notify_all();
+                g_llm_cv.wait(lock, [] { return !g_llm_reload || !g_llm_running; });
+                g_llm_parked = false;
+                continue;
+            }
+
+            admit.swap(g_llm_requests);
+            cancels.swap(g_llm_cancel);
+            if (admit.empty() && replies.empty() && !g_llm_spec_texts.empty()) {
+                // 没有正式提问时，用空闲时间 prefill 最新的 ASR 中间结果
+                auto it = g_llm_spec_texts.begin();
+                spec_session = it->first;
+                spec_text = it->second;
+                g_llm_spec_texts.erase(it);
             }
         }
 
-        if (prompt.empty()) {
-            usleep(20000); 
-            continue;
+        // 被打断的会话：丢掉正在生成的回复
+        for (size_t i = 0; i < replies.size();) {
+            if (cancels.count(replies[i].session_id)) {
+                FinishReply(replies[i], false);
+                replies.erase(replies.begin() + i);
+            } else {
+                i++;
+            }
         }
 
         if (!g_model || !g_ctx) {
-            LOGE("❌ 模型未加载");
+            for (auto& req : admit) {
+                LOGE("❌ 模型未加载");
+                ReleaseTokenCallback(req.on_token);
+                EmitFinal("llm", "", req.session_id);
+            }
             continue;
         }
 
-        LOGI("🤖 LLM 开始思考: %{public}s", prompt.c_str());
-        
-        // 1. Tokenize
-        std::string full_prompt = "<|im_start|>user\n" + prompt + "<|im_end|>\n<|im_start|>assistant\n";
-        const llama_vocab* vocab = llama_model_get_vocab(g_model);
-        std::vector<llama_token> tokens(full_prompt.length() + 100);
-        int n_tokens = llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), tokens.data(), tokens.size(), true, true);
-        if (n_tokens < 0) {
-            n_tokens = -n_tokens;
-            tokens.resize(n_tokens);
-            n_tokens = llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), tokens.data(), tokens.size(), true, true);
-        }
-        tokens.resize(n_tokens);
-
-        llama_batch batch = llama_batch_get_one(tokens.data(), tokens.size());
-        if (llama_decode(g_ctx, batch) != 0) {
-            LOGE("❌ Llama decode failed");
+        if (!spec_text.empty()) {
+            apply_budget();
+            LlmSessionManager& sessions = LlmSessionManager::Instance();
+            // 投机不淘汰其他会话：没有空闲序列就跳过，等正式提问再 Acquire
+            LlmSession* session = sessions.TryAcquire(spec_session);
+            if (session) sessions.Speculate(session, spec_text);
             continue;
         }
 
-        // 3. Generation Loop
-        for (int i = 0; i < 512; i++) {
-            auto * logits = llama_get_logits_ith(g_ctx, batch.n_tokens - 1);
-            int n_vocab = llama_vocab_n_tokens(vocab);
-            
-            llama_token next_token = 0;
-            float max_p = -1e9;
-            for (int j = 0; j < n_vocab; j++) {
-                if (logits[j] > max_p) {
-                    max_p = logits[j];
-                    next_token = j;
-                }
+        for (auto& req : admit) {
+            budget.SetActive(CPU_ENGINE_LLM, true);
+            apply_budget();
+            // 同一会话的新提问打断它还在生成的旧回复
+            for (size_t i = 0; i < replies.size(); i++) {
+                if (replies[i].session_id != req.session_id) continue;
+                FinishReply(replies[i], false);
+                replies.erase(replies.begin() + i);
+                break;
             }
+            ActiveReply r;
+            r.session_id = req.session_id;
+            r.on_token = req.on_token;
+            if (StartReply(r, req.prompt)) replies.push_back(std::move(r));
+        }
+
+        if (replies.empty()) {
+            budget.SetActive(CPU_ENGINE_LLM, false);
+            continue;
+        }
 
-            if (llama_vocab_is_eog(vocab, next_token)) break;
+        // 所有回复的待解码 token 合成一个 batch
+        LlmSessionManager& sessions = LlmSessionManager::Instance();
+        step_sessions.clear();
+        step_tokens.clear();
+        for (auto& r : replies) {
+            step_sessions.push_back(r.session);
+            step_tokens.push_back(r.pending);
+        }
+        apply_budget();
+        bool decoded = sessions.DecodeStep(step_sessions, step_tokens);
 
-            char buf[256];
-            int n = llama_token_to_piece(vocab, next_token, buf, sizeof(buf), 0, true);
-            if (n < 0) {
-                 n = -n;
-                 llama_token_to_piece(vocab, next_token, buf, n, 0, true);
+        const llama_vocab* vocab = llama_model_get_vocab(g_model);
+        int n_vocab = llama_vocab_n_tokens(vocab);
+        std::vector<ActiveReply> next;
+        next.reserve(replies.size());
+        for (size_t i = 0; i < replies.size(); i++) {
+            ActiveReply& r = replies[i];
+            bool alive = decoded && r.n_generated < kMaxReplyTokens;
+            if (alive) {
+                float* logits = llama_get_logits_ith(g_ctx, (int32_t)i);
+                alive = HandleToken(r, vocab, r.sampler->Sample(logits, n_vocab));
             }
-            buf[n] = '\0';
-            std::string piece(buf);
-
-            // 🔥 核心修改：安全的循环分句逻辑 🔥
-            {
-                std::lock_guard<std::mutex> lock(g_llm_mutex);
-                
-                g_llm_output_buffer += piece; // 给界面显示
-                g_sentence_accumulator += piece; // 给 TTS 缓冲
-
-                // 循环检查：如果缓冲区里有完整的句子（可能不止一句），就切下来发送
-                while (true) {
-                    SplitInfo info = FindFirstPunctuation(g_sentence_accumulator);
-                    
-                    if (info.found) {
-                        // 计算截取长度：标点位置 + 标点长度
-                        size_t cutLength = info.startPos + info.length;
-                        
-                        std::string sentence = g_sentence_accumulator.substr(0, cutLength);
-                        
-                        // 发送这一句给 TTS
-                        if (!sentence.empty()) {
-                            LOGI("🗣️ 完整分句 TTS: %{public}s", sentence.c_str());
-                            TtsManager::Instance().PushText(sentence);
-                        }
-                        
-                        // 从缓冲区移除这一句，保留剩下的
-                        g_sentence_accumulator = g_sentence_accumulator.substr(cutLength);
-                    } else {
-                        // 没找到标点，但如果太长了 (超过60字节，约20汉字)，强制切断防止卡顿
-                        if (g_sentence_accumulator.length() > 60) {
-                             LOGI("🗣️ 长度强制 TTS: %{public}s", g_sentence_accumulator.c_str());
-                             TtsManager::Instance().PushText(g_sentence_accumulator);
-                             g_sentence_accumulator = "";
-                        }
-                        break; // 退出循环，等待下一个 Token
-                    }
-                }
+            if (alive) {
+                next.push_back(std::move(r));
+            } else {
+                FinishReply(r, true);
             }
+        }
+        replies.swap(next);
+        if (replies.empty()) budget.SetActive(CPU_ENGINE_LLM, false);
+    }
+}
 
-            batch = llama_batch_get_one(&next_token, 1);
-            if (llama_decode(g_ctx, batch) != 0) break;
+// ASR 线程调用：识别结果变化时提交给 LLM 线程做投机 prefill，每个会话只保留最新一条
+void LlmSpeculate(const std::string& sessionId, const std::string& partial) {
+    if (!g_llm_running) return;
+    {
+        std::lock_guard<std::mutex> lock(g_llm_mutex);
+        // 这个会话的正式提问已经到了
+        for (const auto& req : g_llm_requests) {
+            if (req.session_id == sessionId) return;
         }
-        
-        // 4. 收尾：把剩下的文本也发出去
-        {
-            std::lock_guard<std::mutex> lock(g_llm_mutex);
-            if (!g_sentence_accumulator.empty()) {
-                 LOGI("🗣️ 剩余文本 TTS: %{public}s", g_sentence_accumulator.c_str());
-                 TtsManager::Instance().PushText(g_sentence_accumulator);
-                 g_sentence_accumulator = "";
-            }
+        g_llm_spec_texts[sessionId] = partial;
+    }
+    g_llm_cv.notify_one();
+}
+
+// 取消会话排队中的提问和投机文本，并让 LLM 线程结束它正在生成的回复，调用方持有 g_llm_mutex
+static void CancelLlmLocked(const std::string& sessionId) {
+    for (auto it = g_llm_requests.begin(); it != g_llm_requests.end();) {
+        if (it->session_id == sessionId) {
+            ReleaseTokenCallback(it->on_token);
+            it = g_llm_requests.erase(it);
+        } else {
+            ++it;
         }
-        
-        LOGI("✅ LLM 回复完成");
     }
+    g_llm_spec_texts.erase(sessionId);
+    g_llm_cancel.insert(sessionId);
 }
 
-// 1. 加载 LLM
+// 1. 加载 LLM: nativeLoad(modelPath, cacheDir?)
+//    传 cacheDir 进入热启动模式：mmap 加载模型 (走页缓存，预读由 llama-mmap 的
+//    MAP_POPULATE/madvise 完成)，并把系统提示词的 KV 快照存到 cacheDir
 static napi_value NativeLoad(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     char pathBuf[512];
     size_t strSize;
     napi_get_value_string_utf8(env, args[0], pathBuf, 512, &strSize);
 
+    std::string cacheDir;
+    if (argc >= 2) {
+        napi_valuetype t = napi_undefined;
+        napi_typeof(env, args[1], &t);
+        if (t == napi_string) {
+            char dirBuf[512];
+            napi_get_value_string_utf8(env, args[1], dirBuf, sizeof(dirBuf), &strSize);
+            cacheDir = dirBuf;
+        }
+    }
+    bool warmStart = !cacheDir.empty();
+
+    // LLM 线程可能正在生成回复或投机 prefill，等它停在安全点再释放旧模型
+    {
+        std::unique_lock<std::mutex> lock(g_llm_mutex);
+        if (g_llm_running) {
+            g_llm_reload = true;
+            g_llm_cv.notify_one();
+            g_llm_parked_cv.wait(lock, [] { return g_llm_parked; });
+        }
+    }
+
+    LlmSessionManager::Instance().Unbind();
+    CpuBudget::Instance().DetachLlama(g_ctx);
     if (g_ctx) { llama_free(g_ctx); g_ctx = nullptr; }
     if (g_model) { llama_free_model(g_model); g_model = nullptr; }
 
     llama_backend_init();
     llama_model_params model_params = llama_model_default_params();
-    model_params.use_mmap = false;
+    model_params.use_mmap = warmStart;
+    if (warmStart) model_params.use_direct_io = false; // direct io 会覆盖 mmap
 
     g_model = llama_model_load_from_file(pathBuf, model_params);
     bool success = (g_model != nullptr);
@@ -223,10 +457,19 @@ static napi_value NativeLoad(napi_env env, napi_callback_info info) {
     if (success) {
         llama_context_params ctx_params = llama_context_default_params();
         ctx_params.n_ctx = 2048;
-        ctx_params.n_threads = 2; 
-        ctx_params.n_threads_batch = 2;
+        // 线程数由 CPU 预算按阶段调整，计算走共享的显式 ggml 线程池
+        ctx_params.n_threads = CpuBudget::Instance().Threads(CPU_ENGINE_LLM);
+        ctx_params.n_threads_batch = ctx_params.n_threads;
         ctx_params.n_batch = 128; 
+        // 多会话共享同一块 KV，系统提示词前缀只存一份
+        ctx_params.n_seq_max = LlmSessionManager::kMaxSeq;
+        ctx_params.kv_unified = true;
         g_ctx = llama_new_context_with_model(g_model, ctx_params);
+        if (g_ctx) {
+            CpuBudget::Instance().AttachLlama(g_ctx);
+            LlmSessionManager::Instance().Bind(g_model, g_ctx);
+            if (warmStart) LlmSessionManager::Instance().SetStateCacheDir(cacheDir, pathBuf);
+        }
         
         if (!g_llm_running) {
             g_llm_running = true;
@@ -235,44 +478,92 @@ static napi_value NativeLoad(napi_env env, napi_callback_info info) {
         }
     }
 
+    // 放 LLM 线程继续 (加载失败时它看到 g_model 为空，排队的提问直接结束)
+    {
+        std::lock_guard<std::mutex> lock(g_llm_mutex);
+        g_llm_reload = false;
+    }
+    g_llm_cv.notify_one();
+
     napi_value result;
     napi_get_boolean(env, success, &result);
     return result;
 }
 
-// 2. 发送问题
+// 提交一次提问 (JS 线程的 nativeChat 和 ASR 线程的端点判定都走这里)
+// LLM 还没加载时返回 false
+bool LlmSubmit(const std::string& sessionId, const std::string& prompt, napi_threadsafe_function onToken) {
+    // 停止这个会话的 TTS 播放
+    TtsManager::Instance().Stop(sessionId);
+    LatencyTracer::Instance().OnRequest(sessionId);
+    if (!g_llm_running) {
+        ReleaseTokenCallback(onToken);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_llm_mutex);
+        // 同一会话还没被取走的请求被覆盖，释放它的回调
+        for (auto it = g_llm_requests.begin(); it != g_llm_requests.end(); ++it) {
+            if (it->session_id != sessionId) continue;
+            ReleaseTokenCallback(it->on_token);
+            g_llm_requests.erase(it);
+            break;
+        }
+        g_llm_requests.push_back({prompt, sessionId, onToken});
+        g_llm_spec_texts.erase(sessionId); // 正式提问已到，未处理的中间结果作废
+        g_llm_output_buffers[sessionId] = "";
+    }
+    g_llm_cv.notify_one();
+
+    return true;
+}
+
+// 2. 发送问题: nativeChat(question, sessionId?, onToken?)
+//    sessionId 不传则使用 "default"；onToken 为本次回复的逐 token 回调
 static napi_value NativeChat(napi_env env, napi_callback_info info) {
-    size_t argc = 1; 
-    napi_value args[1];
+    size_t argc = 3; 
+    napi_value args[3];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
 
     char qBuf[1024];
     size_t strSize;
     napi_get_value_string_utf8(env, args[0], qBuf, 1024, &strSize);
-    
-    // 停止 TTS 播放
-    TtsManager::Instance().Stop();
 
-    {
-        std::lock_guard<std::mutex> lock(g_llm_mutex);
-        g_llm_input_prompt = std::string(qBuf);
-        g_llm_output_buffer = ""; 
-        g_sentence_accumulator = ""; // 清空缓冲区
+    std::string sessionId = "default";
+    napi_threadsafe_function onToken = nullptr;
+    for (size_t i = 1; i < argc; i++) {
+        napi_valuetype t = napi_undefined;
+        napi_typeof(env, args[i], &t);
+        if (t == napi_string) {
+            char idBuf[128];
+            napi_get_value_string_utf8(env, args[i], idBuf, sizeof(idBuf), &strSize);
+            sessionId = idBuf;
+        } else if (t == napi_function && !onToken) {
+            onToken = CreateTokenCallback(env, args[i]);
+        }
     }
+    
+    LlmSubmit(sessionId, std::string(qBuf), onToken);
 
     napi_value result;
     napi_create_string_utf8(env, "OK", NAPI_AUTO_LENGTH, &result);
     return result;
 }
 
-// 3. 获取 LLM 文本
+// 3. 获取 LLM 文本: getLlmResult(sessionId?)
 static napi_value GetLlmResult(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
     std::string res = "";
     {
         std::lock_guard<std::mutex> lock(g_llm_mutex);
-        if (!g_llm_output_buffer.empty()) {
-            res = g_llm_output_buffer;
-            g_llm_output_buffer = ""; 
+        auto it = g_llm_output_buffers.find(sessionId);
+        if (it != g_llm_output_buffers.end() && !it->second.empty()) {
+            res.swap(it->second);
         }
     }
     napi_value output;
@@ -280,48 +571,245 @@ static napi_value GetLlmResult(napi_env env, napi_callback_info info) {
     return output;
 }
 
-// 4. 初始化 TTS
+// 4. 初始化 TTS: initTts(modelPath, cacheDir?)
+//    传 cacheDir 时常用句的合成结果会落盘，重启后直接命中
 static napi_value InitTts(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     char pathBuf[512];
     size_t strSize;
     napi_get_value_string_utf8(env, args[0], pathBuf, 512, &strSize);
 
-    bool ret = TtsManager::Instance().Init(std::string(pathBuf));
+    std::string cacheDir;
+    if (argc >= 2) {
+        napi_valuetype t = napi_undefined;
+        napi_typeof(env, args[1], &t);
+        if (t == napi_string) {
+            char dirBuf[512];
+            napi_get_value_string_utf8(env, args[1], dirBuf, sizeof(dirBuf), &strSize);
+            cacheDir = dirBuf;
+        }
+    }
+
+    bool ret = TtsManager::Instance().Init(std::string(pathBuf), cacheDir);
     
     napi_value result;
     napi_get_boolean(env, ret, &result);
     return result;
 }
 
-// 5. 获取 TTS 音频
+// 预加载常用句: preloadTts(texts)，TTS 空闲时合成进缓存，返回排队的句数
+static napi_value PreloadTts(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    std::vector<std::string> texts;
+    bool isArray = false;
+    if (argc >= 1) napi_is_array(env, args[0], &isArray);
+    if (isArray) {
+        uint32_t len = 0;
+        napi_get_array_length(env, args[0], &len);
+        for (uint32_t i = 0; i < len; i++) {
+            napi_value item;
+            napi_get_element(env, args[0], i, &item);
+            size_t n = 0;
+            if (napi_get_value_string_utf8(env, item, nullptr, 0, &n) != napi_ok) continue;
+            std::string text(n, '\0');
+            napi_get_value_string_utf8(env, item, &text[0], n + 1, &n);
+            texts.push_back(std::move(text));
+        }
+    }
+
+    size_t queued = TtsManager::Instance().Preload(texts);
+    napi_value result;
+    napi_create_uint32(env, (uint32_t)queued, &result);
+    return result;
+}
+
+// 5. 获取 TTS 音频: getTtsAudio(sessionId?)
 static napi_value GetTtsAudio(napi_env env, napi_callback_info info) {
-    std::vector<int16_t> pcm = TtsManager::Instance().PopAudio();
-    if (pcm.empty()) return nullptr;
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    const int16_t* p1;
+    const int16_t* p2;
+    size_t n1, n2;
+    size_t count = TtsManager::Instance().PeekAudio(sessionId, 8192, &p1, &n1, &p2, &n2);
+    if (count == 0) return nullptr;
 
+    // 环形缓冲里的两段直接拷进 ArrayBuffer
     void* data;
     napi_value arraybuffer;
-    size_t byteLength = pcm.size() * sizeof(int16_t);
-    napi_create_arraybuffer(env, byteLength, &data, &arraybuffer);
-    memcpy(data, pcm.data(), byteLength);
+    napi_create_arraybuffer(env, count * sizeof(int16_t), &data, &arraybuffer);
+    memcpy(data, p1, n1 * sizeof(int16_t));
+    if (n2 > 0) memcpy(static_cast<int16_t*>(data) + n1, p2, n2 * sizeof(int16_t));
+    TtsManager::Instance().ConsumeAudio(sessionId, count);
     return arraybuffer;
 }
 
-// 6. 停止 TTS
+// 6. 停止 TTS: stopTts(sessionId?)，同时打断这个会话正在生成的回复
 static napi_value StopTts(napi_env env, napi_callback_info info) {
-    TtsManager::Instance().Stop();
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    TtsManager::Instance().Stop(sessionId);
     {
         std::lock_guard<std::mutex> lock(g_llm_mutex);
-        g_llm_input_prompt = "";
-        g_sentence_accumulator = ""; // 清空缓冲区
+        CancelLlmLocked(sessionId);
     }
+    g_llm_cv.notify_one();
     napi_value result;
     napi_create_int32(env, 1, &result);
     return result;
 }
 
+// 7. 设置系统提示词 (下一次对话前在 LLM 线程重新预解码)
+static napi_value SetSystemPrompt(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    char textBuf[2048];
+    size_t strSize;
+    napi_get_value_string_utf8(env, args[0], textBuf, sizeof(textBuf), &strSize);
+    LlmSessionManager::Instance().SetSystemPrompt(std::string(textBuf));
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// 8. 释放会话 (客户端断开时调用，归还其 KV 序列)
+static napi_value ReleaseLlmSession(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    char idBuf[128];
+    size_t strSize;
+    napi_get_value_string_utf8(env, args[0], idBuf, sizeof(idBuf), &strSize);
+    LlmSessionManager::Instance().Release(std::string(idBuf));
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// 9. 设置会话采样参数: setSamplingParams(sessionId, {temperature, topK, topP, minP, ...})
+static bool GetNamedDouble(napi_env env, napi_value obj, const char* name, double* out) {
+    bool has = false;
+    napi_has_named_property(env, obj, name, &has);
+    if (!has) return false;
+    napi_value v;
+    napi_get_named_property(env, obj, name, &v);
+    napi_valuetype t;
+    napi_typeof(env, v, &t);
+    if (t != napi_number) return false;
+    napi_get_value_double(env, v, out);
+    return true;
+}
+
+static napi_value SetSamplingParams(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    napi_value result;
+    if (argc < 2) {
+        napi_get_boolean(env, false, &result);
+        return result;
+    }
+
+    char idBuf[128];
+    size_t strSize;
+    napi_get_value_string_utf8(env, args[0], idBuf, sizeof(idBuf), &strSize);
+
+    LlmSamplingParams params;
+    double v;
+    if (GetNamedDouble(env, args[1], "temperature", &v)) params.temperature = (float)v;
+    if (GetNamedDouble(env, args[1], "topK", &v)) params.top_k = (int32_t)v;
+    if (GetNamedDouble(env, args[1], "topP", &v)) params.top_p = (float)v;
+    if (GetNamedDouble(env, args[1], "minP", &v)) params.min_p = (float)v;
+    if (GetNamedDouble(env, args[1], "penaltyLastN", &v)) params.penalty_last_n = (int32_t)v;
+    if (GetNamedDouble(env, args[1], "repeatPenalty", &v)) params.penalty_repeat = (float)v;
+    if (GetNamedDouble(env, args[1], "frequencyPenalty", &v)) params.penalty_freq = (float)v;
+    if (GetNamedDouble(env, args[1], "presencePenalty", &v)) params.penalty_present = (float)v;
+    if (GetNamedDouble(env, args[1], "seed", &v)) params.seed = (uint32_t)v;
+
+    LlmSessionManager::Instance().SetSamplingParams(std::string(idBuf), params);
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// 10. 采样开销基准: benchmarkSampling(nVocab?, iterations?) -> 报告文本
+static napi_value BenchmarkSamplingNapi(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int32_t nVocab = 0;
+    int32_t iterations = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &nVocab);
+    if (argc >= 2) napi_get_value_int32(env, args[1], &iterations);
+    if (nVocab <= 0 && g_model) nVocab = llama_vocab_n_tokens(llama_model_get_vocab(g_model));
+
+    std::string report = BenchmarkSampling(nVocab, iterations);
+    LOGI("📊 采样基准:\n%{public}s", report.c_str());
+
+    napi_value output;
+    napi_create_string_utf8(env, report.c_str(), NAPI_AUTO_LENGTH, &output);
+    return output;
+}
+
+// 11. 客户端断开: releaseSession(sessionId)
+//     一次性释放该会话的识别 stream、TTS 队列/缓冲、LLM 回复和 KV 序列
+static napi_value ReleaseSession(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    ReleaseAsrSession(sessionId);
+    TtsManager::Instance().Release(sessionId);
+    LatencyTracer::Instance().Release(sessionId);
+    {
+        std::lock_guard<std::mutex> lock(g_llm_mutex);
+        CancelLlmLocked(sessionId);
+        g_llm_output_buffers.erase(sessionId);
+    }
+    g_llm_cv.notify_one();
+    // 正在生成的会话由 LLM 线程结束回复后再归还 KV 序列
+    LlmSessionManager::Instance().Release(sessionId);
+    LOGI("👋 会话已释放: %{public}s", sessionId.c_str());
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// 12. CPU 预算统计: getCpuStats() -> 各引擎 CPU 时间、线程数与阶段耗时
+static napi_value GetCpuStats(napi_env env, napi_callback_info info) {
+    std::string report = CpuBudget::Instance().Report();
+    napi_value output;
+    napi_create_string_utf8(env, report.c_str(), NAPI_AUTO_LENGTH, &output);
+    return output;
+}
+
+// 13. 延迟指标: getMetrics() -> JSON
+//     最近各轮的时间戳、各阶段延迟直方图 (p50/p90/p99)、llama_perf_context、ncnn 各网络耗时
+static napi_value GetMetrics(napi_env env, napi_callback_info info) {
+    std::string report = LatencyTracer::Instance().Report();
+    napi_value output;
+    napi_create_string_utf8(env, report.c_str(), NAPI_AUTO_LENGTH, &output);
+    return output;
+}
+
 EXTERN_C_START
 static napi_value Init(napi_env env, napi_value exports) {
     napi_property_descriptor desc[] = {
@@ -331,11 +819,25 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"initSherpa", nullptr, InitSherpa, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"acceptWaveform", nullptr, AcceptWaveform, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"resetSherpa", nullptr, ResetSherpa, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"finishSherpa", nullptr, FinishSherpa, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getRecognizedText", nullptr, GetRecognizedText, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getQueueSize", nullptr, GetQueueSize, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"initTts", nullptr, InitTts, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"preloadTts", nullptr, PreloadTts, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getTtsAudio", nullptr, GetTtsAudio, nullptr, nullptr, nullptr, napi_default, nullptr},
-        {"stopTts", nullptr, StopTts, nullptr, nullptr, nullptr, napi_default, nullptr}
+        {"stopTts", nullptr, StopTts, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setSystemPrompt", nullptr, SetSystemPrompt, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"releaseLlmSession", nullptr, ReleaseLlmSession, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setSamplingParams", nullptr, SetSamplingParams, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"benchmarkSampling", nullptr, BenchmarkSamplingNapi, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"releaseSession", nullptr, ReleaseSession, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getCpuStats", nullptr, GetCpuStats, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getMetrics", nullptr, GetMetrics, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onToken", nullptr, OnToken, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onAudioChunk", nullptr, OnAudioChunk, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onPartialTranscript", nullptr, OnPartialTranscript, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onFinal", nullptr, OnFinal, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onVad", nullptr, OnVad, nullptr, nullptr, nullptr, napi_default, nullptr}
     };
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
     return exports;
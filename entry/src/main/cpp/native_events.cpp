@@ -0,0 +1,192 @@
+#include "native_events.h"
+
+#include <hilog/log.h>
+#include <mutex>
+#include <cstring>
+
+#undef LOG_DOMAIN
+#undef LOG_TAG
+#define LOG_DOMAIN 0x0000
+#define LOG_TAG "NATIVE_EVENTS"
+#define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+
+// 从后台线程带到 JS 线程的数据
+struct EventPayload {
+    NativeEventType type;
+    std::string text;
+    std::string extra; // sessionId / source
+    std::vector<int16_t> pcm;
+    std::string session; // EVENT_FINAL 的 sessionId
+};
+
+static std::mutex g_event_mutex;
+static napi_threadsafe_function g_listeners[EVENT_COUNT] = {};
+
+// JS 线程上执行：把 payload 转成 JS 参数并调用回调
+static void CallJs(napi_env env, napi_value js_cb, void* context, void* data) {
+    EventPayload* payload = static_cast<EventPayload*>(data);
+    if (env != nullptr && js_cb != nullptr) {
+        napi_value undefined;
+        napi_get_undefined(env, &undefined);
+
+        napi_value argv[3];
+        size_t argc = 0;
+        switch (payload->type) {
+            case EVENT_TOKEN:
+            case EVENT_PARTIAL_TRANSCRIPT:
+            case EVENT_VAD:
+                napi_create_string_utf8(env, payload->text.c_str(), payload->text.size(), &argv[0]);
+                napi_create_string_utf8(env, payload->extra.c_str(), payload->extra.size(), &argv[1]);
+                argc = 2;
+                break;
+            case EVENT_FINAL:
+                napi_create_string_utf8(env, payload->extra.c_str(), payload->extra.size(), &argv[0]);
+                napi_create_string_utf8(env, payload->text.c_str(), payload->text.size(), &argv[1]);
+                napi_create_string_utf8(env, payload->session.c_str(), payload->session.size(), &argv[2]);
+                argc = 3;
+                break;
+            case EVENT_AUDIO_CHUNK: {
+                void* buf = nullptr;
+                size_t byteLength = payload->pcm.size() * sizeof(int16_t);
+                napi_create_arraybuffer(env, byteLength, &buf, &argv[0]);
+                if (byteLength > 0) memcpy(buf, payload->pcm.data(), byteLength);
+                napi_create_string_utf8(env, payload->extra.c_str(), payload->extra.size(), &argv[1]);
+                argc = 2;
+                break;
+            }
+            default:
+                break;
+        }
+        if (argc > 0) {
+            napi_call_function(env, undefined, js_cb, argc, argv, nullptr);
+        }
+    }
+    delete payload;
+}
+
+static napi_threadsafe_function CreateTsfn(napi_env env, napi_value fn, const char* name) {
+    napi_value resource_name;
+    napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resource_name);
+
+    napi_threadsafe_function tsfn = nullptr;
+    napi_status status = napi_create_threadsafe_function(env, fn, nullptr, resource_name,
+                                                         0, 1, nullptr, nullptr, nullptr, CallJs, &tsfn);
+    if (status != napi_ok) {
+        LOGE("❌ 创建回调失败: %{public}s", name);
+        return nullptr;
+    }
+    return tsfn;
+}
+
+static bool Dispatch(NativeEventType type, EventPayload* payload) {
+    std::lock_guard<std::mutex> lock(g_event_mutex);
+    napi_threadsafe_function tsfn = g_listeners[type];
+    if (!tsfn || napi_call_threadsafe_function(tsfn, payload, napi_tsfn_nonblocking) != napi_ok) {
+        delete payload;
+        return false;
+    }
+    return true;
+}
+
+bool HasEventListener(NativeEventType type) {
+    std::lock_guard<std::mutex> lock(g_event_mutex);
+    return g_listeners[type] != nullptr;
+}
+
+bool EmitToken(const std::string& token, const std::string& sessionId) {
+    return Dispatch(EVENT_TOKEN, new EventPayload{EVENT_TOKEN, token, sessionId, {}, ""});
+}
+
+bool EmitAudioChunk(const int16_t* pcm, size_t count, const std::string& sessionId) {
+    EventPayload* payload = new EventPayload{EVENT_AUDIO_CHUNK, "", sessionId, {}, ""};
+    payload->pcm.assign(pcm, pcm + count);
+    return Dispatch(EVENT_AUDIO_CHUNK, payload);
+}
+
+bool EmitPartialTranscript(const std::string& text, const std::string& sessionId) {
+    return Dispatch(EVENT_PARTIAL_TRANSCRIPT, new EventPayload{EVENT_PARTIAL_TRANSCRIPT, text, sessionId, {}, ""});
+}
+
+bool EmitFinal(const std::string& source, const std::string& text, const std::string& sessionId) {
+    return Dispatch(EVENT_FINAL, new EventPayload{EVENT_FINAL, text, source, {}, sessionId});
+}
+
+bool EmitVad(bool speech, const std::string& sessionId) {
+    return Dispatch(EVENT_VAD, new EventPayload{EVENT_VAD, speech ? "start" : "end", sessionId, {}, ""});
+}
+
+// 注册/取消注册：替换旧回调时释放旧的 tsfn
+static napi_value RegisterListener(napi_env env, napi_callback_info info, NativeEventType type, const char* name) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    napi_valuetype t = napi_undefined;
+    if (argc >= 1) napi_typeof(env, args[0], &t);
+
+    napi_threadsafe_function tsfn = nullptr;
+    if (t == napi_function) {
+        tsfn = CreateTsfn(env, args[0], name);
+    }
+
+    napi_threadsafe_function old = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_event_mutex);
+        old = g_listeners[type];
+        g_listeners[type] = tsfn;
+    }
+    if (old) napi_release_threadsafe_function(old, napi_tsfn_release);
+    LOGI("📡 %{public}s %{public}s", name, tsfn ? "已注册" : "已取消");
+
+    napi_value result;
+    napi_get_boolean(env, tsfn != nullptr, &result);
+    return result;
+}
+
+napi_value OnToken(napi_env env, napi_callback_info info) {
+    return RegisterListener(env, info, EVENT_TOKEN, "onToken");
+}
+
+napi_value OnAudioChunk(napi_env env, napi_callback_info info) {
+    return RegisterListener(env, info, EVENT_AUDIO_CHUNK, "onAudioChunk");
+}
+
+napi_value OnPartialTranscript(napi_env env, napi_callback_info info) {
+    return RegisterListener(env, info, EVENT_PARTIAL_TRANSCRIPT, "onPartialTranscript");
+}
+
+napi_value OnFinal(napi_env env, napi_callback_info info) {
+    return RegisterListener(env, info, EVENT_FINAL, "onFinal");
+}
+
+napi_value OnVad(napi_env env, napi_callback_info info) {
+    return RegisterListener(env, info, EVENT_VAD, "onVad");
+}
+
+std::string GetOptionalSessionId(napi_env env, napi_value* args, size_t argc, size_t index) {
+    if (index >= argc) return "default";
+    napi_valuetype t = napi_undefined;
+    napi_typeof(env, args[index], &t);
+    if (t != napi_string) return "default";
+    char idBuf[128];
+    size_t strSize = 0;
+    napi_get_value_string_utf8(env, args[index], idBuf, sizeof(idBuf), &strSize);
+    return std::string(idBuf, strSize);
+}
+
+napi_threadsafe_function CreateTokenCallback(napi_env env, napi_value fn) {
+    return CreateTsfn(env, fn, "nativeChat.onToken");
+}
+
+void CallTokenCallback(napi_threadsafe_function tsfn, const std::string& token, const std::string& sessionId) {
+    if (!tsfn) return;
+    EventPayload* payload = new EventPayload{EVENT_TOKEN, token, sessionId, {}, ""};
+    if (napi_call_threadsafe_function(tsfn, payload, napi_tsfn_nonblocking) != napi_ok) {
+        delete payload;
+    }
+}
+
+void ReleaseTokenCallback(napi_threadsafe_function tsfn) {
+    if (tsfn) napi_release_threadsafe_function(tsfn, napi_tsfn_release);
+}
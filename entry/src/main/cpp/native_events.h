@@ -0,0 +1,45 @@
+#pragma once
+#include "napi/native_api.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ==========================================
+// 推送式事件 (napi_threadsafe_function)
+// 后台线程产生数据后直接回调 ArkTS，取代 50ms 轮询
+// ==========================================
+
+enum NativeEventType {
+    EVENT_TOKEN = 0,          // LLM 生成的文本片段: cb(token, sessionId)
+    EVENT_AUDIO_CHUNK,        // TTS 合成好的 PCM16: cb(ArrayBuffer, sessionId)
+    EVENT_PARTIAL_TRANSCRIPT, // ASR 中间结果: cb(text, sessionId)
+    EVENT_FINAL,              // 阶段结束: cb(source, text, sessionId)，source 为 "asr" / "llm"
+    EVENT_VAD,                // 语音起止: cb(state, sessionId)，state 为 "start" / "end"
+    EVENT_COUNT
+};
+
+// 是否有 JS 监听者 (没有时调用方继续走轮询缓冲区)
+bool HasEventListener(NativeEventType type);
+
+// 以下函数可在任意线程调用，没有监听者时返回 false
+bool EmitToken(const std::string& token, const std::string& sessionId);
+bool EmitAudioChunk(const int16_t* pcm, size_t count, const std::string& sessionId);
+bool EmitPartialTranscript(const std::string& text, const std::string& sessionId);
+bool EmitFinal(const std::string& source, const std::string& text, const std::string& sessionId);
+bool EmitVad(bool speech, const std::string& sessionId);
+
+// NAPI 注册入口: onToken(cb) / onAudioChunk(cb) / onPartialTranscript(cb) / onFinal(cb) / onVad(cb)
+// 传 null 取消注册
+napi_value OnToken(napi_env env, napi_callback_info info);
+napi_value OnAudioChunk(napi_env env, napi_callback_info info);
+napi_value OnPartialTranscript(napi_env env, napi_callback_info info);
+napi_value OnFinal(napi_env env, napi_callback_info info);
+napi_value OnVad(napi_env env, napi_callback_info info);
+
+// 读取可选的 sessionId 参数 (args[index] 为字符串时)，不传则为 "default"
+std::string GetOptionalSessionId(napi_env env, napi_value* args, size_t argc, size_t index);
+
+// 单次请求级别的 token 回调 (nativeChat(question, onToken))
+napi_threadsafe_function CreateTokenCallback(napi_env env, napi_value fn);
+void CallTokenCallback(napi_threadsafe_function tsfn, const std::string& token, const std::string& sessionId);
+void ReleaseTokenCallback(napi_threadsafe_function tsfn);
@@ -0,0 +1,46 @@
+#include "pcm_utils.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_UTILS_NEON 1
+#endif
+
+void Int16ToFloat(const int16_t* in, float* out, size_t n) {
+    const float scale = 1.0f / 32768.0f;
+    size_t i = 0;
+#if PCM_UTILS_NEON
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vmulq_f32(lo, vscale));
+        vst1q_f32(out + i + 4, vmulq_f32(hi, vscale));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = in[i] * scale;
+    }
+}
+
+void FloatToInt16(const float* in, int16_t* out, size_t n) {
+    size_t i = 0;
+#if PCM_UTILS_NEON
+    const float32x4_t vmin = vdupq_n_f32(-1.0f);
+    const float32x4_t vmax = vdupq_n_f32(1.0f);
+    const float32x4_t vscale = vdupq_n_f32(32767.0f);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo = vminq_f32(vmaxq_f32(vld1q_f32(in + i), vmin), vmax);
+        float32x4_t hi = vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), vmin), vmax);
+        int32x4_t ilo = vcvtq_s32_f32(vmulq_f32(lo, vscale));
+        int32x4_t ihi = vcvtq_s32_f32(vmulq_f32(hi, vscale));
+        vst1q_s16(out + i, vcombine_s16(vmovn_s32(ilo), vmovn_s32(ihi)));
+    }
+#endif
+    for (; i < n; i++) {
+        float s = in[i];
+        if (s > 1.0f) s = 1.0f;
+        if (s < -1.0f) s = -1.0f;
+        out[i] = static_cast<int16_t>(s * 32767.0f);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// PCM 批量格式转换 (NEON，非 ARM 平台回退到标量)
+
+// int16 -> float，范围 [-1, 1)，与 sample / 32768.0f 逐点结果一致
+void Int16ToFloat(const int16_t* in, float* out, size_t n);
+
+// float -> int16，先截断到 [-1, 1] 再乘 32767 (向零取整)，与逐点 static_cast 结果一致
+void FloatToInt16(const float* in, int16_t* out, size_t n);
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/display.h"
 #include "sherpa-ncnn/csrc/model.h"
@@ -130,6 +131,15 @@ void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   p->recognizer->DecodeStream(s->stream.get());
 }
 
+void DecodeStreams(SherpaNcnnRecognizer *p, SherpaNcnnStream **ss,
+                   int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> streams(n);
+  for (int32_t i = 0; i != n; ++i) {
+    streams[i] = ss[i]->stream.get();
+  }
+  p->recognizer->DecodeStreams(streams.data(), n);
+}
+
 SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   std::string text = p->recognizer->GetResult(s->stream.get()).text;
   auto res = p->recognizer->GetResult(s->stream.get());
@@ -177,6 +187,13 @@ int32_t IsEndpoint(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return p->recognizer->IsEndpoint(s->stream.get());
 }
 
+void SetNumThreads(SherpaNcnnRecognizer *p, int32_t num_threads) {
+  if (num_threads < 1) {
+    return;
+  }
+  p->recognizer->SetNumThreads(num_threads);
+}
+
 SherpaNcnnDisplay *CreateDisplay(int32_t max_word_per_line) {
   SherpaNcnnDisplay *ans = new SherpaNcnnDisplay;
   ans->impl = std::make_unique<sherpa_ncnn::Display>(max_word_per_line);
@@ -240,6 +240,17 @@ SHERPA_NCNN_API int32_t IsReady(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 /// @param s A pointer returned by CreateStream()
 SHERPA_NCNN_API void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 
+/// Decode one chunk of each of the given streams in a single call.
+///
+/// Pre-condition for this function:
+///   IsReady(p, ss[i]) must return 1 for every i.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param ss An array of pointers returned by CreateStream()
+/// @param n  Number of streams in the array.
+SHERPA_NCNN_API void DecodeStreams(SherpaNcnnRecognizer *p,
+                                   SherpaNcnnStream **ss, int32_t n);
+
 /// Get the decoding results so far.
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -278,6 +289,15 @@ SHERPA_NCNN_API void InputFinished(SherpaNcnnStream *s);
 SHERPA_NCNN_API int32_t IsEndpoint(SherpaNcnnRecognizer *p,
                                    SherpaNcnnStream *s);
 
+/// Change the number of threads used by the recognizer's neural networks.
+/// It takes effect from the next call to Decode(). Do not call it while
+/// another thread is running Decode() on the same recognizer.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param num_threads Number of threads. Must be > 0.
+SHERPA_NCNN_API void SetNumThreads(SherpaNcnnRecognizer *p,
+                                   int32_t num_threads);
+
 // for displaying results on Linux/macOS.
 SHERPA_NCNN_API typedef struct SherpaNcnnDisplay SherpaNcnnDisplay;
 
@@ -128,16 +128,34 @@ void CircularBuffer::Push(const float *p, int32_t n) {
 }
 
 std::vector<float> CircularBuffer::Get(int32_t start_index, int32_t n) const {
+  const float *p1 = nullptr;
+  const float *p2 = nullptr;
+  int32_t n1 = 0;
+  int32_t n2 = 0;
+  if (!GetSpans(start_index, n, &p1, &n1, &p2, &n2)) {
+    return {};
+  }
+
+  std::vector<float> ans(n);
+  std::copy(p1, p1 + n1, ans.begin());
+  std::copy(p2, p2 + n2, ans.begin() + n1);
+
+  return ans;
+}
+
+bool CircularBuffer::GetSpans(int32_t start_index, int32_t n, const float **p1,
+                              int32_t *n1, const float **p2,
+                              int32_t *n2) const {
   if (start_index < head_ || start_index >= tail_) {
     NCNN_LOGE("Invalid start_index: %d. head_: %d, tail_: %d", start_index,
               head_, tail_);
-    return {};
+    return false;
   }
 
   int32_t size = Size();
   if (n < 0 || n > size) {
     NCNN_LOGE("Invalid n: %d. size: %d", n, size);
-    return {};
+    return false;
   }
 
   int32_t capacity = static_cast<int32_t>(buffer_.size());
@@ -145,25 +163,23 @@ std::vector<float> CircularBuffer::Get(int32_t start_index, int32_t n) const {
   if (start_index - head_ + n > size) {
     NCNN_LOGE("Invalid start_index: %d and n: %d. head_: %d, size: %d",
               start_index, n, head_, size);
-    return {};
+    return false;
   }
 
   int32_t start = start_index % capacity;
 
-  if (start + n < capacity) {
-    return {buffer_.begin() + start, buffer_.begin() + start + n};
-  }
-
-  std::vector<float> ans(n);
-
-  std::copy(buffer_.begin() + start, buffer_.end(), ans.begin());
+  *p1 = buffer_.data() + start;
+  *p2 = buffer_.data();
 
-  int32_t part1_size = capacity - start;
-  int32_t part2_size = n - part1_size;
-  std::copy(buffer_.begin(), buffer_.begin() + part2_size,
-            ans.begin() + part1_size);
+  if (start + n <= capacity) {
+    *n1 = n;
+    *n2 = 0;
+  } else {
+    *n1 = capacity - start;
+    *n2 = n - *n1;
+  }
 
-  return ans;
+  return true;
 }
 
 void CircularBuffer::Pop(int32_t n) {
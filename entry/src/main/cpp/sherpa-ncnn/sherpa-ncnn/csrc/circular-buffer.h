@@ -42,6 +42,15 @@ class CircularBuffer {
   // @return Return a vector of size n containing the requested elements
   std::vector<float> Get(int32_t start_index, int32_t n) const;
 
+  // Like Get() but without copying. The requested elements are
+  // [*p1, *p1 + *n1) followed by [*p2, *p2 + *n2); *n2 is 0 unless the
+  // range wraps around the end of the storage. The pointers are valid
+  // until the next call to Push() or Resize().
+  //
+  // @return Return false if the range is invalid.
+  bool GetSpans(int32_t start_index, int32_t n, const float **p1, int32_t *n1,
+                const float **p2, int32_t *n2) const;
+
   // Remove n elements from the buffer
   //
   // @param n Should be in the range [0, size_]
@@ -6,16 +6,79 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <map>
 #include <queue>
+#include <sstream>
 #include <string>
 #include <tuple>
 #include <utility>
 
+#include "platform.h"  // NOLINT
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
 namespace sherpa_ncnn {
+
+namespace {
+
+// A node of the pointer-free trie used while building. It is compiled into
+// ContextState at the end of Build().
+struct TrieNode {
+  int32_t token = -1;
+  float token_score = 0;
+  float node_score = 0;
+  float output_score = 0;
+  int32_t level = 0;
+  float ac_threshold = 0;
+  bool is_end = false;
+  int32_t phrase = -1;  // index into the phrases passed to Build()
+  std::map<int32_t, int32_t> next;
+};
+
+}  // namespace
+
+ContextGraphPtr ContextGraph::FromHotwords(std::istream &is,
+                                           const SymbolTable &sym,
+                                           float context_score) {
+  std::vector<std::vector<int32_t>> token_ids;
+  std::vector<float> scores;
+
+  std::string line;
+  std::string word;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::vector<int32_t> tmp;
+    float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
+                            // the global one.
+    while (iss >> word) {
+      if (sym.contains(word)) {
+        tmp.push_back(sym[word]);
+      } else if (word[0] == ':') {
+        tmp_score = std::stof(word.substr(1));
+      } else {
+        NCNN_LOGE(
+            "Cannot find ID for hotword %s at line: %s. (Hint: words on the "
+            "same line are separated by spaces)",
+            word.c_str(), line.c_str());
+        exit(-1);
+      }
+    }
+
+    if (tmp.empty()) {
+      continue;
+    }
+
+    token_ids.push_back(std::move(tmp));
+    scores.push_back(tmp_score);
+  }
+
+  return std::make_shared<ContextGraph>(token_ids, context_score, scores);
+}
+
 void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
                          const std::vector<float> &scores,
                          const std::vector<std::string> &phrases,
-                         const std::vector<float> &ac_thresholds) const {
+                         const std::vector<float> &ac_thresholds) {
   if (!scores.empty()) {
     assert(token_ids.size() == scores.size());
   }
@@ -25,75 +88,166 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
   if (!ac_thresholds.empty()) {
     assert(token_ids.size() == ac_thresholds.size());
   }
+
+  // nodes[0] is the root. Children are referred to by index since the
+  // vector grows while inserting.
+  std::vector<TrieNode> nodes(1);
   for (int32_t i = 0; i < token_ids.size(); ++i) {
-    auto node = root_.get();
+    int32_t node = 0;
     float score = scores.empty() ? 0.0f : scores[i];
     score = score == 0.0f ? context_score_ : score;
     float ac_threshold = ac_thresholds.empty() ? 0.0f : ac_thresholds[i];
     ac_threshold = ac_threshold == 0.0f ? ac_threshold_ : ac_threshold;
-    std::string phrase = phrases.empty() ? std::string() : phrases[i];
+    int32_t phrase = phrases.empty() ? -1 : i;
 
     for (int32_t j = 0; j < token_ids[i].size(); ++j) {
       int32_t token = token_ids[i][j];
-      if (0 == node->next.count(token)) {
-        bool is_end = j == token_ids[i].size() - 1;
-        node->next[token] = std::make_unique<ContextState>(
-            token, score, node->node_score + score,
-            is_end ? node->node_score + score : 0, j + 1,
-            is_end ? ac_threshold : 0.0f, is_end,
-            is_end ? phrase : std::string());
+      bool is_last = j == token_ids[i].size() - 1;
+      auto it = nodes[node].next.find(token);
+      if (it == nodes[node].next.end()) {
+        TrieNode child;
+        child.token = token;
+        child.token_score = score;
+        child.node_score = nodes[node].node_score + score;
+        child.output_score = is_last ? child.node_score : 0;
+        child.level = j + 1;
+        child.ac_threshold = is_last ? ac_threshold : 0.0f;
+        child.is_end = is_last;
+        child.phrase = is_last ? phrase : -1;
+
+        int32_t id = static_cast<int32_t>(nodes.size());
+        nodes[node].next[token] = id;
+        nodes.push_back(std::move(child));
+        node = id;
       } else {
-        float token_score = std::max(score, node->next[token]->token_score);
-        node->next[token]->token_score = token_score;
-        float node_score = node->node_score + token_score;
-        node->next[token]->node_score = node_score;
-        bool is_end =
-            (j == token_ids[i].size() - 1) || node->next[token]->is_end;
-        node->next[token]->output_score = is_end ? node_score : 0.0f;
-        node->next[token]->is_end = is_end;
-        if (j == token_ids[i].size() - 1) {
-          node->next[token]->phrase = phrase;
-          node->next[token]->ac_threshold = ac_threshold;
+        int32_t id = it->second;
+        TrieNode &child = nodes[id];
+        child.token_score = std::max(score, child.token_score);
+        child.node_score = nodes[node].node_score + child.token_score;
+        child.is_end = is_last || child.is_end;
+        child.output_score = child.is_end ? child.node_score : 0.0f;
+        if (is_last) {
+          child.phrase = phrase;
+          child.ac_threshold = ac_threshold;
         }
+        node = id;
       }
-      node = node->next[token].get();
     }
   }
+
+  // Number the states in breadth-first order. Children of a state are
+  // visited in increasing token order and get consecutive ids.
+  std::vector<int32_t> order;
+  order.reserve(nodes.size());
+  order.push_back(0);
+  for (size_t k = 0; k != order.size(); ++k) {
+    for (const auto &kv : nodes[order[k]].next) {
+      order.push_back(kv.second);
+    }
+  }
+
+  int32_t num_states = static_cast<int32_t>(nodes.size());
+  states_.resize(num_states);
+  tokens_.resize(num_states);
+  if (!phrases.empty()) {
+    phrases_.resize(num_states);
+  }
+
+  int32_t next_id = 1;
+  int32_t max_root_token = -1;
+  for (int32_t id = 0; id != num_states; ++id) {
+    const TrieNode &node = nodes[order[id]];
+    ContextState &state = states_[id];
+    state.id = id;
+    state.token = node.token;
+    state.token_score = node.token_score;
+    state.node_score = node.node_score;
+    state.output_score = node.output_score;
+    state.level = node.level;
+    state.ac_threshold = node.ac_threshold;
+    state.is_end = node.is_end;
+    state.first_child = next_id;
+    state.num_children = static_cast<int32_t>(node.next.size());
+    next_id += state.num_children;
+
+    tokens_[id] = node.token;
+    if (!phrases.empty() && node.phrase != -1) {
+      phrases_[id] = phrases[node.phrase];
+    }
+    if (node.level == 1) {
+      max_root_token = std::max(max_root_token, node.token);
+    }
+  }
+
+  root_next_.assign(max_root_token + 1, -1);
+  const ContextState &root = states_[0];
+  for (int32_t c = root.first_child; c != root.first_child + root.num_children;
+       ++c) {
+    root_next_[tokens_[c]] = c;
+  }
+
   FillFailOutput();
 }
 
+int32_t ContextGraph::Next(int32_t s, int32_t token) const {
+  if (s == 0) {
+    return (token >= 0 && token < static_cast<int32_t>(root_next_.size()))
+               ? root_next_[token]
+               : -1;
+  }
+
+  const ContextState &state = states_[s];
+  const int32_t *begin = tokens_.data() + state.first_child;
+  const int32_t *end = begin + state.num_children;
+
+  // Deep states rarely have more than a few children
+  if (state.num_children <= 8) {
+    for (const int32_t *p = begin; p != end; ++p) {
+      if (*p == token) {
+        return state.first_child + static_cast<int32_t>(p - begin);
+      }
+    }
+    return -1;
+  }
+
+  const int32_t *p = std::lower_bound(begin, end, token);
+  if (p != end && *p == token) {
+    return state.first_child + static_cast<int32_t>(p - begin);
+  }
+  return -1;
+}
+
 std::tuple<float, const ContextState *, const ContextState *>
 ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
                              bool strict_mode /*= true*/) const {
   const ContextState *node;
   float score;
-  if (1 == state->next.count(token)) {
-    node = state->next.at(token).get();
+  int32_t next = Next(state->id, token);
+  if (next != -1) {
+    node = &states_[next];
     score = node->token_score;
   } else {
-    node = state->fail;
-    while (0 == node->next.count(token)) {
-      node = node->fail;
-      if (-1 == node->token) break;  // root
-    }
-    if (1 == node->next.count(token)) {
-      node = node->next.at(token).get();
+    int32_t s = state->fail;
+    while ((next = Next(s, token)) == -1 && s != 0) {
+      s = states_[s].fail;
     }
+    node = &states_[next != -1 ? next : s];
     score = node->node_score - state->node_score;
   }
 
   assert(nullptr != node);
 
   const ContextState *matched_node =
-      node->is_end ? node : (node->output != nullptr ? node->output : nullptr);
+      node->is_end ? node
+                   : (node->output != -1 ? &states_[node->output] : nullptr);
 
   if (!strict_mode && node->output_score != 0) {
     assert(nullptr != matched_node);
     float output_score =
         node->is_end ? node->node_score
-                     : (node->output != nullptr ? node->output->node_score
-                                                : node->node_score);
-    return std::make_tuple(score + output_score - node->node_score, root_.get(),
+                     : (node->output != -1 ? states_[node->output].node_score
+                                           : node->node_score);
+    return std::make_tuple(score + output_score - node->node_score, Root(),
                            matched_node);
   }
   return std::make_tuple(score + node->output_score, node, matched_node);
@@ -102,7 +256,7 @@ ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
 std::pair<float, const ContextState *> ContextGraph::Finalize(
     const ContextState *state) const {
   float score = -state->node_score;
-  return std::make_pair(score, root_.get());
+  return std::make_pair(score, Root());
 }
 
 std::pair<bool, const ContextState *> ContextGraph::IsMatched(
@@ -113,50 +267,50 @@ std::pair<bool, const ContextState *> ContextGraph::IsMatched(
     status = true;
     node = state;
   } else {
-    if (state->output != nullptr) {
+    if (state->output != -1) {
       status = true;
-      node = state->output;
+      node = &states_[state->output];
     }
   }
   return std::make_pair(status, node);
 }
 
-void ContextGraph::FillFailOutput() const {
-  std::queue<const ContextState *> node_queue;
-  for (auto &kv : root_->next) {
-    kv.second->fail = root_.get();
-    node_queue.push(kv.second.get());
-  }
-  while (!node_queue.empty()) {
-    auto current_node = node_queue.front();
-    node_queue.pop();
-    for (auto &kv : current_node->next) {
-      auto fail = current_node->fail;
-      if (1 == fail->next.count(kv.first)) {
-        fail = fail->next.at(kv.first).get();
-      } else {
-        fail = fail->fail;
-        while (0 == fail->next.count(kv.first)) {
-          fail = fail->fail;
-          if (-1 == fail->token) break;
-        }
-        if (1 == fail->next.count(kv.first))
-          fail = fail->next.at(kv.first).get();
+const std::string &ContextGraph::Phrase(const ContextState *state) const {
+  static const std::string kEmpty;
+  return phrases_.empty() ? kEmpty : phrases_[state->id];
+}
+
+void ContextGraph::FillFailOutput() {
+  // Ids are in breadth-first order, so the fail state of a parent is
+  // always known before its children are visited
+  int32_t num_states = static_cast<int32_t>(states_.size());
+  for (int32_t s = 0; s != num_states; ++s) {
+    const ContextState &parent = states_[s];
+    for (int32_t c = parent.first_child;
+         c != parent.first_child + parent.num_children; ++c) {
+      ContextState &child = states_[c];
+      if (s == 0) {
+        child.fail = 0;
+        continue;
+      }
+
+      int32_t fail = parent.fail;
+      int32_t next;
+      while ((next = Next(fail, child.token)) == -1 && fail != 0) {
+        fail = states_[fail].fail;
       }
-      kv.second->fail = fail;
+      child.fail = next != -1 ? next : 0;
+
       // fill the output arc
-      auto output = fail;
-      while (!output->is_end) {
-        output = output->fail;
-        if (-1 == output->token) {
-          output = nullptr;
-          break;
-        }
+      int32_t output = child.fail;
+      while (output != 0 && !states_[output].is_end) {
+        output = states_[output].fail;
       }
-      kv.second->output = output;
-      kv.second->output_score += output == nullptr ? 0 : output->output_score;
-      node_queue.push(kv.second.get());
+      child.output = output != 0 ? output : -1;
+      child.output_score +=
+          child.output == -1 ? 0 : states_[child.output].output_score;
     }
   }
 }
+
 }  // namespace sherpa_ncnn
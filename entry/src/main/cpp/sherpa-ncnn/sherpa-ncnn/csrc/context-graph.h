@@ -5,43 +5,37 @@
 #ifndef SHERPA_NCNN_CSRC_CONTEXT_GRAPH_H_
 #define SHERPA_NCNN_CSRC_CONTEXT_GRAPH_H_
 
+#include <cstdint>
+#include <istream>
 #include <memory>
 #include <string>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace sherpa_ncnn {
 
 class ContextGraph;
+class SymbolTable;
 using ContextGraphPtr = std::shared_ptr<ContextGraph>;
 
+// A state of the compiled Aho-Corasick automaton. States are numbered in
+// breadth-first order with the root at 0, and the children of a state are
+// numbered consecutively in increasing token order, so the outgoing arcs of
+// a state are just the id range [first_child, first_child + num_children).
 struct ContextState {
-  int32_t token;
-  float token_score;
-  float node_score;
-  float output_score;
-  int32_t level;
-  float ac_threshold;
-  bool is_end;
-  std::string phrase;
-  std::unordered_map<int32_t, std::unique_ptr<ContextState>> next;
-  const ContextState *fail = nullptr;
-  const ContextState *output = nullptr;
-
-  ContextState() = default;
-  ContextState(int32_t token, float token_score, float node_score,
-               float output_score, int32_t level = 0, float ac_threshold = 0.0f,
-               bool is_end = false, const std::string &phrase = {})
-      : token(token),
-        token_score(token_score),
-        node_score(node_score),
-        output_score(output_score),
-        level(level),
-        ac_threshold(ac_threshold),
-        is_end(is_end),
-        phrase(phrase) {}
+  int32_t id = 0;
+  int32_t token = -1;
+  float token_score = 0;
+  float node_score = 0;
+  float output_score = 0;
+  int32_t level = 0;
+  float ac_threshold = 0;
+  bool is_end = false;
+  int32_t first_child = 0;
+  int32_t num_children = 0;
+  int32_t fail = 0;     // id of the fail state
+  int32_t output = -1;  // id of the nearest end state on the fail chain
 };
 
 class ContextGraph {
@@ -53,8 +47,6 @@ class ContextGraph {
                const std::vector<std::string> &phrases = {},
                const std::vector<float> &ac_thresholds = {})
       : context_score_(context_score), ac_threshold_(ac_threshold) {
-    root_ = std::make_unique<ContextState>(-1, 0, 0, 0);
-    root_->fail = root_.get();
     Build(token_ids, scores, phrases, ac_thresholds);
   }
 
@@ -64,6 +56,19 @@ class ContextGraph {
       : ContextGraph(token_ids, context_score, 0.0f, scores, phrases,
                      std::vector<float>()) {}
 
+  /** Build a graph from a hotwords file.
+   *
+   * Each line contains the space-separated tokens of one hotword,
+   * optionally followed by a boosting score for that hotword, e.g.,
+   *
+   *   ▁HE LL O ▁WORLD :1.5
+   *
+   * Hotwords without a score use context_score. It exits the program if a
+   * token is not in the symbol table.
+   */
+  static ContextGraphPtr FromHotwords(std::istream &is, const SymbolTable &sym,
+                                      float context_score);
+
   std::tuple<float, const ContextState *, const ContextState *> ForwardOneStep(
       const ContextState *state, int32_t token_id,
       bool strict_mode = true) const;
@@ -74,17 +79,43 @@ class ContextGraph {
   std::pair<float, const ContextState *> Finalize(
       const ContextState *state) const;
 
-  const ContextState *Root() const { return root_.get(); }
+  const ContextState *Root() const {
+    return states_.empty() ? nullptr : states_.data();
+  }
+
+  int32_t NumStates() const { return static_cast<int32_t>(states_.size()); }
+
+  // Return the phrase of an end state, or an empty string if no phrases
+  // were given
+  const std::string &Phrase(const ContextState *state) const;
 
  private:
-  float context_score_;
-  float ac_threshold_;
-  std::unique_ptr<ContextState> root_;
   void Build(const std::vector<std::vector<int32_t>> &token_ids,
              const std::vector<float> &scores,
              const std::vector<std::string> &phrases,
-             const std::vector<float> &ac_thresholds) const;
-  void FillFailOutput() const;
+             const std::vector<float> &ac_thresholds);
+  void FillFailOutput();
+
+  // Return the id of the child of state `s` with the given token, or -1
+  int32_t Next(int32_t s, int32_t token) const;
+
+ private:
+  float context_score_ = 0;
+  float ac_threshold_ = 0;
+
+  std::vector<ContextState> states_;
+
+  // tokens_[i] == states_[i].token. The children of a state are a
+  // contiguous, sorted slice of it, which keeps the arc search in a few
+  // cache lines.
+  std::vector<int32_t> tokens_;
+
+  // Children of the root indexed by token; -1 if there is no such child.
+  // Most steps that do not continue a hotword end here.
+  std::vector<int32_t> root_next_;
+
+  // Indexed by state id; empty if no phrases were given
+  std::vector<std::string> phrases_;
 };
 
 }  // namespace sherpa_ncnn
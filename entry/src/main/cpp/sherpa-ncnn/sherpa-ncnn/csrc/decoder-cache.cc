@@ -0,0 +1,83 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sherpa-ncnn/csrc/decoder-cache.h"
+
+#include <algorithm>
+
+#include "sherpa-ncnn/csrc/net-timing.h"
+
+namespace sherpa_ncnn {
+
+DecoderCache::DecoderCache(Model *model, const JoinerProjection *projection,
+                           int32_t capacity)
+    : model_(model),
+      projection_(projection),
+      context_size_(model->ContextSize()),
+      capacity_(capacity) {}
+
+DecoderCache::Entry DecoderCache::Get(const int32_t *context) {
+  bool use_cache = context_size_ <= 2;
+
+  uint64_t key = 0;
+  if (use_cache) {
+    for (int32_t i = 0; i != context_size_; ++i) {
+      key = (key << 32) | static_cast<uint32_t>(context[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = map_.find(key);
+    if (it != map_.end()) {
+      list_.splice(list_.begin(), list_, it->second);
+      return it->second->second;
+    }
+  }
+
+  Entry entry;
+  {
+    ncnn::Mat decoder_input(context_size_);
+    std::copy(context, context + context_size_,
+              static_cast<int32_t *>(decoder_input));
+    SHERPA_NCNN_TIME_NET("asr.decoder");
+    entry.decoder_out = model_->RunDecoder(decoder_input);
+  }
+  Project(&entry);
+
+  if (use_cache) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (map_.count(key) == 0) {
+      list_.emplace_front(key, entry);
+      map_[key] = list_.begin();
+      if (static_cast<int32_t>(list_.size()) > capacity_) {
+        map_.erase(list_.back().first);
+        list_.pop_back();
+      }
+    }
+  }
+
+  return entry;
+}
+
+void DecoderCache::Project(Entry *entry) const {
+  if (!projection_ || !entry->decoder_proj.empty()) {
+    return;
+  }
+
+  SHERPA_NCNN_TIME_NET("asr.joiner_proj");
+  entry->decoder_proj = projection_->ProjectDecoder(entry->decoder_out);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,85 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHERPA_NCNN_CSRC_DECODER_CACHE_H_
+#define SHERPA_NCNN_CSRC_DECODER_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+/** LRU cache of decoder network outputs.
+ *
+ * The transducer decoder is stateless: its output depends only on the
+ * last context_size tokens. Both search methods ask for the same few
+ * contexts over and over, e.g., the initial blanks or the contexts of
+ * all active paths on frames where no path emits, so outputs are cached
+ * by context together with their joiner projection.
+ *
+ * Caching is only enabled for context_size <= 2, which holds for all
+ * models we support; the two tokens are then packed into an exact 64-bit
+ * key. It is safe to call Get() from multiple threads.
+ */
+class DecoderCache {
+ public:
+  struct Entry {
+    ncnn::Mat decoder_out;
+
+    // Empty if there is no projection
+    ncnn::Mat decoder_proj;
+  };
+
+  /**
+   * @param model  Not owned.
+   * @param projection  If not null, Get() also returns the projection of the
+   *                    decoder output. Not owned.
+   * @param capacity  Maximum number of cached contexts.
+   */
+  DecoderCache(Model *model, const JoinerProjection *projection,
+               int32_t capacity = 256);
+
+  /**
+   * @param context Pointer to the last context_size tokens
+   */
+  Entry Get(const int32_t *context);
+
+  // Fill in decoder_proj for an entry that was not produced by Get(),
+  // e.g., a decoder_out kept across an endpoint.
+  void Project(Entry *entry) const;
+
+ private:
+  Model *model_;                         // not owned
+  const JoinerProjection *projection_;  // not owned
+  int32_t context_size_;
+  int32_t capacity_;
+
+  using List = std::list<std::pair<uint64_t, Entry>>;
+  List list_;  // most recently used first
+  std::unordered_map<uint64_t, List::iterator> map_;
+  std::mutex mutex_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_DECODER_CACHE_H_
@@ -56,6 +56,10 @@ struct DecoderResult {
   // Cache the decoder_out just before endpointing
   ncnn::Mat decoder_out;
 
+  // Joiner projection of decoder_out, if the greedy search decoder
+  // uses JoinerProjection. Kept together with decoder_out.
+  ncnn::Mat decoder_proj;
+
   // used only for modified_beam_search
   Hypotheses hyps;
 };
@@ -95,6 +99,23 @@ class Decoder {
     NCNN_LOGE("Please override it!");
     exit(-1);
   }
+
+  /** Decode several streams at once.
+   *
+   * @param encoder_out encoder_out[i] is the encoder output of the i-th
+   *                    stream, a 2-D tensor of shape (T_i, joiner_dim)
+   * @param results  results[i] is the result of the i-th stream. Each of
+   *                 them is modified in-place.
+   *
+   * The default implementation decodes the streams one by one. Subclasses
+   * may override it to run the joiner on all streams in one call.
+   */
+  virtual void DecodeBatch(const std::vector<ncnn::Mat> &encoder_out,
+                           const std::vector<DecoderResult *> &results) {
+    for (size_t i = 0; i != results.size(); ++i) {
+      Decode(encoder_out[i], results[i]);
+    }
+  }
 };
 
 }  // namespace sherpa_ncnn
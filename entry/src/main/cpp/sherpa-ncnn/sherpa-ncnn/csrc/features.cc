@@ -92,10 +92,7 @@ class FeatureExtractor::Impl {
         exit(-1);
       }
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      Resample(waveform, n);
       return;
     }
 
@@ -115,10 +112,7 @@ class FeatureExtractor::Impl {
           sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
           lowpass_filter_width);
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      Resample(waveform, n);
       return;
     }
 
@@ -156,26 +150,45 @@ class FeatureExtractor::Impl {
 
     fbank_->Pop(discard_num);
 
+    // Alias the contiguous frames of the feature ring instead of copying
+    // them. They stay valid until the next Pop(), i.e., the next call of
+    // this method, even if AcceptWaveform() adds frames meanwhile.
     int32_t feature_dim = fbank_->Dim();
-    ncnn::Mat features;
-    features.create(feature_dim, n);
+    const float *f = fbank_->GetFrames(frame_index, n);
+    ncnn::Mat features(feature_dim, n, const_cast<float *>(f));
 
-    for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i + frame_index);
-      std::copy(f, f + feature_dim, features.row(i));
-    }
+    // An external Mat has no reference count, but ncnn dereferences it to
+    // decide whether an in-place layer has to copy its input first. Share
+    // a counter that never drops to zero, so that such layers always copy
+    // and the ring is never written or freed through the Mat.
+    NCNN_XADD(&alias_refcount_, 1);
+    features.refcount = &alias_refcount_;
 
     last_frame_index_ = frame_index;
 
     return features;
   }
 
+ private:
+  // Resample into resampled_, which is reused across calls, and feed the
+  // result to fbank_
+  void Resample(const float *waveform, int32_t n) {
+    resampled_.resize(resampler_->NumOutputSamples(n, false));
+    int32_t m = resampler_->Resample(waveform, n, false, resampled_.data());
+    fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, resampled_.data(), m);
+  }
+
  private:
   std::unique_ptr<knf::OnlineFbank> fbank_;
   knf::FbankOptions opts_;
   mutable std::mutex mutex_;
   std::unique_ptr<LinearResample> resampler_;
+  std::vector<float> resampled_;
   int32_t last_frame_index_ = 0;
+
+  // Reference count shared by all Mats returned by GetFrames(). It starts
+  // at 1 for the extractor itself.
+  int alias_refcount_ = 1;
 };
 
 FeatureExtractor::FeatureExtractor(const FeatureExtractorConfig &config)
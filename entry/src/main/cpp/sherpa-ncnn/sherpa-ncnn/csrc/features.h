@@ -110,6 +110,10 @@ class FeatureExtractor {
    * @param n  Number of frames to get.
    * @return Return a 2-D tensor of shape (n, feature_dim).
    *         ans.w == feature_dim; ans.h == n
+   *
+   * The returned tensor aliases the internal frame buffer and must not be
+   * modified. It is valid until the next call to GetFrames() and must not
+   * outlive this object; clone() it to keep it longer.
    */
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const;
 
@@ -18,19 +18,34 @@
  */
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/net-timing.h"
+
 namespace sherpa_ncnn {
 
-ncnn::Mat GreedySearchDecoder::BuildDecoderInput(
-    const DecoderResult &result) const {
+GreedySearchDecoder::GreedySearchDecoder(Model *model)
+    : model_(model),
+      projection_(JoinerProjection::Create(&model->GetJoiner())),
+      cache_(model, projection_.get()) {}
+
+GreedySearchDecoder::DecoderState GreedySearchDecoder::RunDecoder(
+    const DecoderResult &result) {
   int32_t context_size = model_->ContextSize();
-  ncnn::Mat decoder_input(context_size);
-  for (int32_t i = 0; i != context_size; ++i) {
-    static_cast<int32_t *>(decoder_input)[i] =
-        *(result.tokens.end() - context_size + i);
+  return cache_.Get(&*(result.tokens.end() - context_size));
+}
+
+GreedySearchDecoder::DecoderState GreedySearchDecoder::GetDecoderState(
+    DecoderResult *result) {
+  if (result->decoder_out.empty()) {
+    return RunDecoder(*result);
   }
-  return decoder_input;
+
+  DecoderState state{result->decoder_out, result->decoder_proj};
+  cache_.Project(&state);
+  return state;
 }
 
 DecoderResult GreedySearchDecoder::GetEmptyResult() const {
@@ -52,17 +67,29 @@ void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
 }
 
 void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
-  // TODO(fangjun): Cache the result of decoder_out
-  ncnn::Mat decoder_out = result->decoder_out;
-  if (decoder_out.empty()) {
-    ncnn::Mat decoder_input = BuildDecoderInput(*result);
-    decoder_out = model_->RunDecoder(decoder_input);
+  DecoderState state = GetDecoderState(result);
+
+  // Project all frames of the chunk at once; each joiner call below then
+  // only runs the add, the activation and the output layer
+  ncnn::Mat encoder_proj;
+  if (projection_) {
+    SHERPA_NCNN_TIME_NET("asr.joiner_proj");
+    encoder_proj = projection_->ProjectEncoder(encoder_out);
   }
 
   int32_t frame_offset = result->frame_offset;
   for (int32_t t = 0; t != encoder_out.h; ++t) {
-    ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out;
+    {
+      SHERPA_NCNN_TIME_NET("asr.joiner");
+      if (projection_) {
+        ncnn::Mat encoder_proj_t(encoder_proj.w, encoder_proj.row(t));
+        joiner_out = projection_->Run(encoder_proj_t, state.decoder_proj);
+      } else {
+        ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+        joiner_out = model_->RunJoiner(encoder_out_t, state.decoder_out);
+      }
+    }
 
     const float *joiner_out_ptr = joiner_out.row(0);
 
@@ -73,8 +100,7 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
     // the blank ID is fixed to 0
     if (new_token != 0 && new_token != 2) {
       result->tokens.push_back(new_token);
-      ncnn::Mat decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
+      state = RunDecoder(*result);
       result->num_trailing_blanks = 0;
       result->timestamps.push_back(t + frame_offset);
     } else {
@@ -83,7 +109,106 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
   }
 
   result->frame_offset += encoder_out.h;
-  result->decoder_out = decoder_out;
+  result->decoder_out = state.decoder_out;
+  result->decoder_proj = state.decoder_proj;
+}
+
+void GreedySearchDecoder::DecodeBatch(
+    const std::vector<ncnn::Mat> &encoder_out,
+    const std::vector<DecoderResult *> &results) {
+  int32_t num_streams = static_cast<int32_t>(results.size());
+  if (num_streams == 1) {
+    Decode(encoder_out[0], results[0]);
+    return;
+  }
+
+  std::vector<DecoderState> states(num_streams);
+  std::vector<ncnn::Mat> encoder_in(num_streams);
+  int32_t max_t = 0;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    states[i] = GetDecoderState(results[i]);
+    if (projection_) {
+      SHERPA_NCNN_TIME_NET("asr.joiner_proj");
+      encoder_in[i] = projection_->ProjectEncoder(encoder_out[i]);
+    } else {
+      encoder_in[i] = encoder_out[i];
+    }
+    max_t = std::max(max_t, encoder_out[i].h);
+  }
+
+  // With a projection, the batches hold the projected rows and are fed
+  // to the add; otherwise they hold the raw encoder/decoder outputs
+  auto decoder_row = [this](const DecoderState &s) -> const ncnn::Mat & {
+    return projection_ ? s.decoder_proj : s.decoder_out;
+  };
+
+  int32_t encoder_dim = encoder_in[0].w;
+  int32_t decoder_dim = decoder_row(states[0]).w;
+
+  // Row k of the batch holds the k-th stream that still has frames left
+  ncnn::Mat encoder_batch(encoder_dim, num_streams);
+  ncnn::Mat decoder_batch(decoder_dim, num_streams);
+  std::vector<int32_t> rows;
+  rows.reserve(num_streams);
+
+  for (int32_t t = 0; t != max_t; ++t) {
+    rows.clear();
+    for (int32_t i = 0; i != num_streams; ++i) {
+      if (t < encoder_out[i].h) {
+        rows.push_back(i);
+      }
+    }
+
+    int32_t m = static_cast<int32_t>(rows.size());
+    for (int32_t k = 0; k != m; ++k) {
+      int32_t i = rows[k];
+      const float *p = encoder_in[i].row(t);
+      std::copy(p, p + encoder_dim, encoder_batch.row(k));
+
+      const float *q = decoder_row(states[i]);
+      std::copy(q, q + decoder_dim, decoder_batch.row(k));
+    }
+
+    // Views over the first m rows; the rows are contiguous in a 2-D Mat
+    ncnn::Mat encoder_t(encoder_dim, m, encoder_batch.data);
+    ncnn::Mat decoder_t(decoder_dim, m, decoder_batch.data);
+
+    ncnn::Mat joiner_out;
+    {
+      SHERPA_NCNN_TIME_NET("asr.joiner");
+      if (projection_) {
+        joiner_out = projection_->Run(encoder_t, decoder_t);
+      } else {
+        joiner_out = model_->RunJoiner(encoder_t, decoder_t);
+      }
+    }
+
+    for (int32_t k = 0; k != m; ++k) {
+      int32_t i = rows[k];
+      DecoderResult *result = results[i];
+      const float *joiner_out_ptr = joiner_out.row(k);
+
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        states[i] = RunDecoder(*result);
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + result->frame_offset);
+      } else {
+        ++result->num_trailing_blanks;
+      }
+    }
+  }
+
+  for (int32_t i = 0; i != num_streams; ++i) {
+    results[i]->frame_offset += encoder_out[i].h;
+    results[i]->decoder_out = states[i].decoder_out;
+    results[i]->decoder_proj = states[i].decoder_proj;
+  }
 }
 
 }  // namespace sherpa_ncnn
@@ -20,14 +20,19 @@
 #ifndef SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 #define SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/decoder-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/joiner-projection.h"
 #include "sherpa-ncnn/csrc/model.h"
 
 namespace sherpa_ncnn {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  explicit GreedySearchDecoder(Model *model);
 
   DecoderResult GetEmptyResult() const override;
 
@@ -35,11 +40,29 @@ class GreedySearchDecoder : public Decoder {
 
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
 
+  // Frame-synchronous greedy search over several streams. For each frame,
+  // the joiner runs once on a (num_streams, joiner_dim) batch; the decoder
+  // runs only for streams that emit a non-blank token.
+  void DecodeBatch(const std::vector<ncnn::Mat> &encoder_out,
+                   const std::vector<DecoderResult *> &results) override;
+
  private:
-  ncnn::Mat BuildDecoderInput(const DecoderResult &result) const;
+  using DecoderState = DecoderCache::Entry;
+
+  // Run the decoder on the last context_size tokens of result
+  DecoderState RunDecoder(const DecoderResult &result);
+
+  // Return decoder_out and decoder_proj of result, running the decoder if
+  // result has none yet
+  DecoderState GetDecoderState(DecoderResult *result);
 
  private:
   Model *model_;  // not owned
+
+  // Null if the joiner cannot be split; see JoinerProjection
+  std::unique_ptr<JoinerProjection> projection_;
+
+  DecoderCache cache_;
 };
 
 }  // namespace sherpa_ncnn
@@ -25,56 +25,191 @@
 
 namespace sherpa_ncnn {
 
-void Hypotheses::Add(Hypothesis hyp) {
-  auto key = hyp.Key();
-  auto it = hyps_dict_.find(key);
-  if (it == hyps_dict_.end()) {
-    hyps_dict_[key] = std::move(hyp);
+// FNV-1a offset basis and prime, used as the seed and multiplier of the
+// rolling hash
+static constexpr uint64_t kHashSeed = 14695981039346656037ull;
+static constexpr uint64_t kHashPrime = 1099511628211ull;
+
+int32_t TokenTrie::Append(int32_t parent, int32_t token, int32_t timestamp) {
+  Node node;
+  node.token = token;
+  node.timestamp = timestamp;
+  node.parent = parent;
+  if (parent == -1) {
+    node.length = 1;
+    node.hash = kHashSeed;
   } else {
-    it->second.log_prob = LogAdd<double>()(it->second.log_prob, hyp.log_prob);
+    node.length = nodes_[parent].length + 1;
+    node.hash = nodes_[parent].hash;
   }
+  node.hash = node.hash * kHashPrime + static_cast<uint32_t>(token) + 1;
+
+  nodes_.push_back(node);
+  return static_cast<int32_t>(nodes_.size()) - 1;
 }
 
-Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
-  if (length_norm == false) {
-    return std::max_element(hyps_dict_.begin(), hyps_dict_.end(),
-                            [](const auto &left, auto &right) -> bool {
-                              return left.second.log_prob <
-                                     right.second.log_prob;
-                            })
-        ->second;
-  } else {
-    // for length_norm is true
-    return std::max_element(
-               hyps_dict_.begin(), hyps_dict_.end(),
-               [](const auto &left, const auto &right) -> bool {
-                 return left.second.log_prob / left.second.ys.size() <
-                        right.second.log_prob / right.second.ys.size();
-               })
-        ->second;
+bool TokenTrie::Equal(int32_t a, int32_t b) const {
+  while (a != b) {
+    if (a == -1 || b == -1) {
+      return false;
+    }
+
+    const Node &x = nodes_[a];
+    const Node &y = nodes_[b];
+    if (x.hash != y.hash || x.length != y.length || x.token != y.token) {
+      return false;
+    }
+    a = x.parent;
+    b = y.parent;
+  }
+  return true;
+}
+
+void TokenTrie::Context(int32_t node, int32_t n, int32_t *out) const {
+  for (int32_t i = n - 1; i >= 0; --i) {
+    out[i] = nodes_[node].token;
+    node = nodes_[node].parent;
+  }
+}
+
+void TokenTrie::Backtrace(int32_t node, std::vector<int32_t> *ys,
+                          std::vector<int32_t> *timestamps) const {
+  ys->clear();
+  timestamps->clear();
+  if (node == -1) {
+    return;
+  }
+
+  ys->reserve(nodes_[node].length);
+  for (; node != -1; node = nodes_[node].parent) {
+    ys->push_back(nodes_[node].token);
+    if (nodes_[node].timestamp != -1) {
+      timestamps->push_back(nodes_[node].timestamp);
+    }
+  }
+  std::reverse(ys->begin(), ys->end());
+  std::reverse(timestamps->begin(), timestamps->end());
+}
+
+void TokenTrie::Compact(std::vector<int32_t> *live) {
+  // Mark all nodes on a live path. A parent always has a smaller index
+  // than its children, since it was appended first.
+  remap_.assign(nodes_.size(), -1);
+  for (int32_t node : *live) {
+    for (; node != -1 && remap_[node] == -1; node = nodes_[node].parent) {
+      remap_[node] = 0;
+    }
+  }
+
+  // Move marked nodes to the front, keeping their order so that parents
+  // are remapped before their children
+  int32_t n = 0;
+  for (int32_t i = 0; i != static_cast<int32_t>(nodes_.size()); ++i) {
+    if (remap_[i] == -1) {
+      continue;
+    }
+
+    Node node = nodes_[i];
+    if (node.parent != -1) {
+      node.parent = remap_[node.parent];
+    }
+    nodes_[n] = node;
+    remap_[i] = n;
+    ++n;
+  }
+  nodes_.resize(n);
+
+  for (auto &node : *live) {
+    if (node != -1) {
+      node = remap_[node];
+    }
   }
 }
 
-std::vector<Hypothesis> Hypotheses::GetTopK(int32_t k, bool length_norm) const {
+Hypotheses::Hypotheses(const std::vector<int32_t> &ys, double log_prob) {
+  ActivePath path;
+  for (auto token : ys) {
+    path.node = trie_.Append(path.node, token, -1);
+  }
+  path.log_prob = log_prob;
+  paths_.push_back(path);
+}
+
+void Hypotheses::Add(const ActivePath &path) {
+  // There are at most num_active_paths paths, so a linear scan is cheaper
+  // than a hash map. Hashes are compared first; Equal() only walks the
+  // trie for paths that are very likely to be the same.
+  const auto &node = trie_.Get(path.node);
+  for (auto &p : paths_) {
+    const auto &other = trie_.Get(p.node);
+    if (other.hash == node.hash && trie_.Equal(p.node, path.node)) {
+      p.log_prob = LogAdd<double>()(p.log_prob, path.log_prob);
+      return;
+    }
+  }
+  paths_.push_back(path);
+}
+
+double Hypotheses::Score(const ActivePath &path, bool length_norm) const {
+  if (!length_norm) {
+    return path.log_prob;
+  }
+  return path.log_prob / trie_.Get(path.node).length;
+}
+
+Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
+  auto it = std::max_element(paths_.begin(), paths_.end(),
+                             [this, length_norm](const auto &a, const auto &b) {
+                               return Score(a, length_norm) <
+                                      Score(b, length_norm);
+                             });
+
+  Hypothesis hyp;
+  trie_.Backtrace(it->node, &hyp.ys, &hyp.timestamps);
+  hyp.log_prob = it->log_prob;
+  hyp.context_state = it->context_state;
+  hyp.num_trailing_blanks = it->num_trailing_blanks;
+  return hyp;
+}
+
+void Hypotheses::GetTopK(int32_t k, bool length_norm,
+                         std::vector<ActivePath> *out) const {
   k = std::max(k, 1);
   k = std::min(k, Size());
 
-  std::vector<Hypothesis> all_hyps = Vec();
+  out->assign(paths_.begin(), paths_.end());
+  std::partial_sort(out->begin(), out->begin() + k, out->end(),
+                    [this, length_norm](const auto &a, const auto &b) {
+                      return Score(a, length_norm) > Score(b, length_norm);
+                    });
+  out->resize(k);
+}
 
-  if (length_norm == false) {
-    std::partial_sort(
-        all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
-        [](const auto &a, const auto &b) { return a.log_prob > b.log_prob; });
-  } else {
-    // for length_norm is true
-    std::partial_sort(all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
-                      [](const auto &a, const auto &b) {
-                        return a.log_prob / a.ys.size() >
-                               b.log_prob / b.ys.size();
-                      });
+std::string Hypotheses::ToString() const {
+  std::ostringstream os;
+  Hypothesis hyp;
+  for (const auto &p : paths_) {
+    trie_.Backtrace(p.node, &hyp.ys, &hyp.timestamps);
+    hyp.log_prob = p.log_prob;
+    os << hyp.ToString() << "\n";
+  }
+  return os.str();
+}
+
+void Hypotheses::CompactTrie() {
+  if (trie_.Size() < 2 * compacted_size_ + 256) {
+    return;
   }
 
-  return {all_hyps.begin(), all_hyps.begin() + k};
+  live_.clear();
+  for (const auto &p : paths_) {
+    live_.push_back(p.node);
+  }
+  trie_.Compact(&live_);
+  for (int32_t i = 0; i != Size(); ++i) {
+    paths_[i].node = live_[i];
+  }
+  compacted_size_ = trie_.Size();
 }
 
 }  // namespace sherpa_ncnn
@@ -19,10 +19,9 @@
 #ifndef SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 #define SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 
+#include <cstdint>
 #include <sstream>
 #include <string>
-#include <unordered_map>
-#include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
@@ -39,7 +38,7 @@ struct Hypothesis {
 
   // The total score of ys in log space.
   double log_prob = 0;
-  const ContextState *context_state;
+  const ContextState *context_state = nullptr;
   int32_t num_trailing_blanks = 0;
 
   Hypothesis() = default;
@@ -47,85 +46,134 @@ struct Hypothesis {
              const ContextState *context_state = nullptr)
       : ys(ys), log_prob(log_prob), context_state(context_state) {}
 
-  // If two Hypotheses have the same `Key`, then they contain
-  // the same token sequence.
-  std::string Key() const {
-    // TODO(fangjun): Use a hash function?
+  // For debugging
+  std::string ToString() const {
     std::ostringstream os;
-    std::string sep = "-";
+    os << "(";
+    std::string sep;
     for (auto i : ys) {
-      os << i << sep;
+      os << sep << i;
       sep = "-";
     }
+    os << ", " << log_prob << ")";
     return os.str();
   }
+};
 
-  // For debugging
-  std::string ToString() const {
-    std::ostringstream os;
-    os << "(" << Key() << ", " << log_prob << ")";
-    return os.str();
-  }
+/** Token sequences of the active paths of one stream.
+ *
+ * Paths are stored as a trie, so they share their common prefix and
+ * extending a path by one token appends a single node instead of copying
+ * the whole sequence. Each node carries a 64-bit rolling hash of the
+ * tokens from the root, which makes comparing two paths O(1) in the
+ * common case.
+ *
+ * Nodes are kept in one vector and referenced by index. Nodes of pruned
+ * paths are reclaimed by Compact().
+ */
+class TokenTrie {
+ public:
+  struct Node {
+    int32_t token;
+    int32_t timestamp;  // -1 for tokens not decoded from a frame
+    int32_t parent;     // -1 for the first token
+    int32_t length;     // number of tokens from the root to this node
+    uint64_t hash;      // rolling hash of these tokens
+  };
+
+  // Append token after node parent (-1 for an empty sequence) and return
+  // the index of the new node.
+  int32_t Append(int32_t parent, int32_t token, int32_t timestamp);
+
+  const Node &Get(int32_t node) const { return nodes_[node]; }
+
+  int32_t Size() const { return static_cast<int32_t>(nodes_.size()); }
+
+  // Return true if the token sequences ending at a and b are equal.
+  bool Equal(int32_t a, int32_t b) const;
+
+  // Write the last n tokens of the sequence ending at node to out.
+  // Requires n <= Get(node).length.
+  void Context(int32_t node, int32_t n, int32_t *out) const;
+
+  // Return the tokens and timestamps of the sequence ending at node.
+  // Tokens with timestamp -1 are not included in timestamps.
+  void Backtrace(int32_t node, std::vector<int32_t> *ys,
+                 std::vector<int32_t> *timestamps) const;
+
+  // Remove all nodes that are not on the path of any node in live.
+  // Node indexes in live are updated in-place.
+  void Compact(std::vector<int32_t> *live);
+
+ private:
+  std::vector<Node> nodes_;
+  std::vector<int32_t> remap_;  // scratch space for Compact()
+};
+
+// One active path of modified beam search. Its tokens live in the
+// TokenTrie of the Hypotheses that owns it.
+struct ActivePath {
+  int32_t node = -1;  // last token of the path
+
+  // The total score of the path in log space.
+  double log_prob = 0;
+  const ContextState *context_state = nullptr;
+  int32_t num_trailing_blanks = 0;
 };
 
 class Hypotheses {
  public:
   Hypotheses() = default;
 
-  explicit Hypotheses(std::vector<Hypothesis> hyps) {
-    for (auto &h : hyps) {
-      hyps_dict_[h.Key()] = std::move(h);
-    }
-  }
+  // Create a single path containing ys, e.g., the leading blanks
+  Hypotheses(const std::vector<int32_t> &ys, double log_prob);
 
-  explicit Hypotheses(std::unordered_map<std::string, Hypothesis> hyps_dict)
-      : hyps_dict_(std::move(hyps_dict)) {}
+  TokenTrie &Trie() { return trie_; }
+  const TokenTrie &Trie() const { return trie_; }
 
-  // Add hyp to this object. If it already exists, its log_prob
-  // is updated with the given hyp using log-sum-exp.
-  void Add(Hypothesis hyp);
+  // Add path to this object. If a path with the same tokens already exists,
+  // its log_prob is updated with the given one using log-sum-exp.
+  void Add(const ActivePath &path);
 
   // Get the hyp that has the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
   // len(hyp.ys) before comparison.
   Hypothesis GetMostProbable(bool length_norm) const;
 
-  // Get the k hyps that have the largest log_prob.
-  // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
-  std::vector<Hypothesis> GetTopK(int32_t k, bool length_norm) const;
+  // Get the k paths that have the largest log_prob, best first.
+  // If length_norm is true, the log_prob of a path is divided by its
+  // length before comparison. `out` is overwritten and can be reused
+  // across calls to avoid allocations.
+  void GetTopK(int32_t k, bool length_norm,
+               std::vector<ActivePath> *out) const;
 
-  int32_t Size() const { return hyps_dict_.size(); }
+  int32_t Size() const { return static_cast<int32_t>(paths_.size()); }
 
-  std::string ToString() const {
-    std::ostringstream os;
-    for (const auto &p : hyps_dict_) {
-      os << p.second.ToString() << "\n";
-    }
-    return os.str();
-  }
+  std::string ToString() const;
 
-  const auto begin() const { return hyps_dict_.begin(); }
-  const auto end() const { return hyps_dict_.end(); }
-  auto begin() { return hyps_dict_.begin(); }
-  auto end() { return hyps_dict_.end(); }
+  auto begin() const { return paths_.begin(); }
+  auto end() const { return paths_.end(); }
+  auto begin() { return paths_.begin(); }
+  auto end() { return paths_.end(); }
 
-  void Clear() { hyps_dict_.clear(); }
+  // Remove all paths. The trie is kept, since the caller usually still
+  // refers to its nodes, e.g., through the output of GetTopK().
+  void Clear() { paths_.clear(); }
+
+  // Reclaim trie nodes that are no longer used by any path. It only does
+  // work once the trie has doubled in size since the last compaction, so
+  // it is cheap to call after every chunk.
+  void CompactTrie();
 
  private:
-  // Return a list of hyps contained in this object.
-  std::vector<Hypothesis> Vec() const {
-    std::vector<Hypothesis> ans;
-    ans.reserve(hyps_dict_.size());
-    for (const auto &p : hyps_dict_) {
-      ans.push_back(p.second);
-    }
-    return ans;
-  }
+  double Score(const ActivePath &path, bool length_norm) const;
 
  private:
-  using Map = std ::unordered_map<std::string, Hypothesis>;
-  Map hyps_dict_;
+  TokenTrie trie_;
+  std::vector<ActivePath> paths_;
+
+  std::vector<int32_t> live_;  // scratch space for CompactTrie()
+  int32_t compacted_size_ = 0;
 };
 
 }  // namespace sherpa_ncnn
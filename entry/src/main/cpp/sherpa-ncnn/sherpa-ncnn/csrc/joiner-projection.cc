@@ -0,0 +1,142 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+
+#include <string>
+
+#include "layer/binaryop.h"
+
+namespace sherpa_ncnn {
+
+static int32_t FindBlob(const ncnn::Net &net, const char *name) {
+  const auto &blobs = net.blobs();
+  for (int32_t i = 0; i != static_cast<int32_t>(blobs.size()); ++i) {
+    if (blobs[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Layers that transform each row independently, so running them on a
+// (T, dim) matrix is the same as running them T times on (dim,) vectors
+static bool IsRowWise(const std::string &type) {
+  return type == "InnerProduct" || type == "Gemm";
+}
+
+JoinerProjection::JoinerProjection(ncnn::Net *joiner) : joiner_(joiner) {
+  in0_ = FindBlob(*joiner_, "in0");
+  in1_ = FindBlob(*joiner_, "in1");
+  out0_ = FindBlob(*joiner_, "out0");
+  if (in0_ == -1 || in1_ == -1 || out0_ == -1) {
+    return;
+  }
+
+  int32_t add0 = -1;
+  int32_t add1 = -1;
+  int32_t encoder_proj = FindAddInput(in0_, &add0);
+  int32_t decoder_proj = FindAddInput(in1_, &add1);
+  if (encoder_proj == -1 || decoder_proj == -1 || add0 != add1) {
+    return;
+  }
+
+  const ncnn::Layer *add = joiner_->layers()[add0];
+  if (add->bottoms[0] != encoder_proj || add->bottoms[1] != decoder_proj) {
+    return;
+  }
+
+  encoder_proj_ = encoder_proj;
+  decoder_proj_ = decoder_proj;
+}
+
+std::unique_ptr<JoinerProjection> JoinerProjection::Create(ncnn::Net *joiner) {
+  auto projection = std::make_unique<JoinerProjection>(joiner);
+  if (!projection->IsSupported()) {
+    return nullptr;
+  }
+  return projection;
+}
+
+int32_t JoinerProjection::FindAddInput(int32_t blob, int32_t *binary_op) const {
+  const auto &blobs = joiner_->blobs();
+  const auto &layers = joiner_->layers();
+
+  // A joiner has at most a few layers between an input and the add
+  for (int32_t step = 0; step != 8; ++step) {
+    int32_t consumer = blobs[blob].consumer;
+    if (consumer < 0) {
+      return -1;
+    }
+
+    const ncnn::Layer *layer = layers[consumer];
+    if (layer->type == "BinaryOp" && layer->bottoms.size() == 2) {
+      // Only an add can be split into the sum of two projections; any
+      // other op keeps the joiner in one piece
+      if (static_cast<const ncnn::BinaryOp *>(layer)->op_type !=
+          ncnn::BinaryOp::Operation_ADD) {
+        return -1;
+      }
+      *binary_op = consumer;
+      return blob;
+    }
+
+    if (!IsRowWise(layer->type) || layer->bottoms.size() != 1 ||
+        layer->tops.size() != 1) {
+      return -1;
+    }
+    blob = layer->tops[0];
+  }
+
+  return -1;
+}
+
+ncnn::Mat JoinerProjection::Project(int32_t input, int32_t output,
+                                    const ncnn::Mat &in) const {
+  if (input == output) {
+    return in;
+  }
+
+  ncnn::Extractor ex = joiner_->create_extractor();
+  ex.input(input, in);
+
+  ncnn::Mat out;
+  ex.extract(output, out);
+  return out;
+}
+
+ncnn::Mat JoinerProjection::ProjectEncoder(const ncnn::Mat &encoder_out) const {
+  return Project(in0_, encoder_proj_, encoder_out);
+}
+
+ncnn::Mat JoinerProjection::ProjectDecoder(const ncnn::Mat &decoder_out) const {
+  return Project(in1_, decoder_proj_, decoder_out);
+}
+
+ncnn::Mat JoinerProjection::Run(const ncnn::Mat &encoder_proj,
+                                const ncnn::Mat &decoder_proj) const {
+  // Feeding the add inputs directly skips both projection branches,
+  // since ncnn only runs the producer of a blob that has no data yet
+  ncnn::Extractor ex = joiner_->create_extractor();
+  ex.input(encoder_proj_, encoder_proj);
+  ex.input(decoder_proj_, decoder_proj);
+
+  ncnn::Mat joiner_out;
+  ex.extract(out0_, joiner_out);
+  return joiner_out;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,98 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
+#define SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** Splits a transducer joiner
+ *
+ *   out0 = output_linear(tanh(encoder_proj(in0) + decoder_proj(in1)))
+ *
+ * at the add, so that the encoder projection can be computed once for
+ * a whole chunk and the decoder projection once per emitted token. Each
+ * joiner call then only runs the add, the activation and the output
+ * linear layer.
+ *
+ * The split points are found by walking the joiner graph from in0 and in1
+ * through single-input/single-output layers until both reach the same
+ * two-input BinaryOp add. If the graph does not have that shape,
+ * IsSupported() returns false and callers should use Model::RunJoiner().
+ */
+class JoinerProjection {
+ public:
+  explicit JoinerProjection(ncnn::Net *joiner);
+
+  // Return nullptr if the joiner cannot be split
+  static std::unique_ptr<JoinerProjection> Create(ncnn::Net *joiner);
+
+  bool IsSupported() const { return encoder_proj_ != -1; }
+
+  /**
+   * @param encoder_out  A 2-D tensor of shape (T, encoder_dim)
+   * @return Return a 2-D tensor of shape (T, joiner_dim)
+   */
+  ncnn::Mat ProjectEncoder(const ncnn::Mat &encoder_out) const;
+
+  /**
+   * @param decoder_out  A 1-D tensor of shape (decoder_dim,) or a 2-D tensor
+   *                     of shape (N, decoder_dim)
+   * @return Return a tensor of shape (joiner_dim,) or (N, joiner_dim)
+   */
+  ncnn::Mat ProjectDecoder(const ncnn::Mat &decoder_out) const;
+
+  /** Run the rest of the joiner on projected inputs.
+   *
+   * Both inputs have the same shape, either (joiner_dim,) or
+   * (N, joiner_dim). The inputs may be views over external memory; they
+   * are not modified.
+   *
+   * @return Return the joiner output of shape (vocab_size,) or
+   *         (N, vocab_size)
+   */
+  ncnn::Mat Run(const ncnn::Mat &encoder_proj,
+                const ncnn::Mat &decoder_proj) const;
+
+ private:
+  // Follow blob `blob` through single-input/single-output layers until it
+  // is consumed by a BinaryOp. Return the index of the blob that feeds the
+  // BinaryOp and set *binary_op to that layer. Return -1 on failure or if
+  // the BinaryOp is not an add.
+  int32_t FindAddInput(int32_t blob, int32_t *binary_op) const;
+
+  ncnn::Mat Project(int32_t input, int32_t output, const ncnn::Mat &in) const;
+
+ private:
+  ncnn::Net *joiner_;  // not owned
+
+  int32_t in0_ = -1;
+  int32_t in1_ = -1;
+  int32_t out0_ = -1;
+
+  // Blob indexes of the two add inputs
+  int32_t encoder_proj_ = -1;
+  int32_t decoder_proj_ = -1;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
@@ -4,10 +4,13 @@
 
 #include "sherpa-ncnn/csrc/lexicon.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
@@ -32,6 +35,169 @@ static std::vector<int32_t> ConvertTokensToIds(
   return ids;
 }
 
+// Map Chinese punctuation to ASCII in a single pass. All of them are
+// 3-byte UTF-8 sequences.
+static char MapChinesePunctuation(uint32_t codepoint) {
+  switch (codepoint) {
+    case 0xff0c:  // ，
+      return ',';
+    case 0x3002:  // 。
+      return '.';
+    case 0xff01:  // ！
+      return '!';
+    case 0xff1f:  // ？
+      return '?';
+    case 0xff1a:  // ：
+      return ':';
+    case 0xff1b:  // ；
+      return ';';
+    case 0xff08:  // （
+      return '(';
+    case 0xff09:  // ）
+      return ')';
+    case 0x3010:  // 【
+      return '[';
+    case 0x3011:  // 】
+      return ']';
+    case 0x201c:  // “
+    case 0x201d:  // ”
+      return '"';
+    case 0x2018:  // ‘
+    case 0x2019:  // ’
+      return '\'';
+    case 0x300a:  // 《
+      return '<';
+    case 0x300b:  // 》
+      return '>';
+    default:
+      return 0;
+  }
+}
+
+static std::string NormalizeChinesePunctuation(const std::string &text) {
+  std::string ans;
+  ans.reserve(text.size());
+
+  int32_t n = static_cast<int32_t>(text.size());
+  for (int32_t i = 0; i < n;) {
+    auto c = static_cast<uint8_t>(text[i]);
+    if ((c & 0xf0) == 0xe0 && i + 2 < n) {
+      uint32_t codepoint = ((c & 0x0f) << 12) |
+                           ((static_cast<uint8_t>(text[i + 1]) & 0x3f) << 6) |
+                           (static_cast<uint8_t>(text[i + 2]) & 0x3f);
+      char p = MapChinesePunctuation(codepoint);
+      if (p) {
+        ans.push_back(p);
+        i += 3;
+        continue;
+      }
+    }
+
+    ans.push_back(text[i]);
+    ++i;
+  }
+
+  return ans;
+}
+
+// A trie over Unicode code points. All edges are kept in one
+// open-addressing hash table keyed by (node, code point), so that a step
+// is a probe into a flat array and lookups need no strings.
+class CodepointTrie {
+ public:
+  CodepointTrie() : values_(1, nullptr) { Rehash(1024); }
+
+  // Return the child of node for the given code point, or -1 if there is
+  // no such child
+  int32_t Child(int32_t node, uint32_t codepoint) const {
+    uint64_t key = Key(node, codepoint);
+    for (uint64_t i = Hash(key);; i = (i + 1) & mask_) {
+      if (keys_[i] == key) {
+        return children_[i];
+      }
+
+      if (keys_[i] == kEmpty) {
+        return -1;
+      }
+    }
+  }
+
+  void Insert(const uint32_t *codepoints, int32_t n,
+              const std::vector<int32_t> *value) {
+    int32_t node = 0;
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t child = Child(node, codepoints[i]);
+      if (child == -1) {
+        child = static_cast<int32_t>(values_.size());
+        values_.push_back(nullptr);
+        AddEdge(Key(node, codepoints[i]), child);
+      }
+      node = child;
+    }
+    values_[node] = value;
+  }
+
+  // The value of the word ending at node, or nullptr
+  const std::vector<int32_t> *Value(int32_t node) const {
+    return values_[node];
+  }
+
+ private:
+  static constexpr uint64_t kEmpty = ~static_cast<uint64_t>(0);
+
+  static uint64_t Key(int32_t node, uint32_t codepoint) {
+    return (static_cast<uint64_t>(node) << 32) | codepoint;
+  }
+
+  uint64_t Hash(uint64_t key) const {
+    return (key * 0x9e3779b97f4a7c15ULL) >> shift_;
+  }
+
+  void AddEdge(uint64_t key, int32_t child) {
+    if (2 * (num_edges_ + 1) > keys_.size()) {
+      Rehash(2 * keys_.size());
+    }
+
+    uint64_t i = Hash(key);
+    while (keys_[i] != kEmpty) {
+      i = (i + 1) & mask_;
+    }
+    keys_[i] = key;
+    children_[i] = child;
+    ++num_edges_;
+  }
+
+  void Rehash(uint64_t capacity) {
+    std::vector<uint64_t> keys(capacity, kEmpty);
+    std::vector<int32_t> children(capacity);
+    keys.swap(keys_);
+    children.swap(children_);
+
+    mask_ = capacity - 1;
+    shift_ = 64;
+    for (uint64_t c = capacity; c > 1; c >>= 1) {
+      --shift_;
+    }
+    num_edges_ = 0;
+
+    for (size_t i = 0; i != keys.size(); ++i) {
+      if (keys[i] != kEmpty) {
+        AddEdge(keys[i], children[i]);
+      }
+    }
+  }
+
+ private:
+  std::vector<uint64_t> keys_;
+  std::vector<int32_t> children_;
+  uint64_t mask_ = 0;
+  int32_t shift_ = 64;
+  int64_t num_edges_ = 0;
+
+  // values_[node] points to the token IDs of the word ending at node
+  std::vector<const std::vector<int32_t> *> values_;
+};
+
 class Lexicon::Impl {
  public:
   explicit Impl(const std::string &lexicon,
@@ -39,6 +205,15 @@ class Lexicon::Impl {
       : token2id_(token2id) {
     std::ifstream is(lexicon);
     Init(is);
+
+    std::vector<uint32_t> codepoints;
+    std::vector<int32_t> word_begin;
+    for (const auto &p : token2id_) {
+      SplitUtf8(p.first, &codepoints, &word_begin);
+      if (codepoints.size() == 1) {
+        char2id_[codepoints[0]] = p.second;
+      }
+    }
   }
 
   void TokenizeWord(const std::string &word,
@@ -54,13 +229,107 @@ class Lexicon::Impl {
 
   void AddWord(const std::string &word, const std::vector<int32_t> &token_ids) {
     auto w = ToLowerCase(word);
-    word2token_ids_[w] = token_ids;
+    auto it = word2token_ids_.find(w);
+    if (it != word2token_ids_.end()) {
+      it->second = token_ids;
+    } else {
+      AddToTrie(&*word2token_ids_.insert({std::move(w), token_ids}).first);
+    }
   }
 
   bool Contains(const std::string &word) const {
     return word2token_ids_.count(word) > 0;
   }
 
+  std::vector<std::vector<int32_t>> ConvertTextToTokenIdsChinese(
+      const std::string &_text) const {
+    std::string text = NormalizeChinesePunctuation(_text);
+
+    std::vector<uint32_t> codepoints;
+    std::vector<int32_t> word_begin;
+    SplitUtf8(text, &codepoints, &word_begin);
+
+    // Words of the lexicon are in lower case
+    std::wstring lower =
+        ToLowerCase(std::wstring(codepoints.begin(), codepoints.end()));
+
+    std::vector<std::vector<int32_t>> ans;
+    std::vector<int32_t> this_sentence;
+
+    int32_t num_words = static_cast<int32_t>(word_begin.size()) - 1;
+    int32_t max_len = 10;
+    int32_t space = token2id_.at(" ");
+
+    for (int32_t i = 0; i < num_words;) {
+      // The longest word of the lexicon made of words i to end, end > i
+      const std::vector<int32_t> *token_ids = nullptr;
+      int32_t end = i;
+      int32_t last = std::min(i + max_len, num_words - 1);
+      int32_t node = 0;
+      for (int32_t k = i; k <= last && node != -1; ++k) {
+        for (int32_t j = word_begin[k]; j != word_begin[k + 1] && node != -1;
+             ++j) {
+          node = trie_.Child(node, codepoints[j]);
+        }
+
+        if (k > i && node != -1 && trie_.Value(node)) {
+          token_ids = trie_.Value(node);
+          end = k;
+        }
+      }
+
+      int32_t begin = word_begin[i];
+      int32_t len = word_begin[i + 1] - begin;
+      i = end + 1;
+
+      if (!token_ids) {
+        token_ids = Find(lower.data() + begin, len);
+      }
+
+      if (token_ids) {
+        this_sentence.insert(this_sentence.end(), token_ids->begin(),
+                             token_ids->end());
+        continue;
+      }
+
+      int32_t id = -1;
+      if (len == 1) {
+        auto it = char2id_.find(codepoints[begin]);
+        if (it != char2id_.end()) {
+          id = it->second;
+        }
+      } else {
+        auto it = token2id_.find(ToString(codepoints.data() + begin, len));
+        if (it != token2id_.end()) {
+          id = it->second;
+        }
+      }
+
+      if (id == -1) {
+        SHERPA_NCNN_LOGE("empty ids for word %s",
+                         ToString(codepoints.data() + begin, len).c_str());
+        continue;
+      }
+
+      this_sentence.push_back(id);
+
+      uint32_t c = len == 1 ? codepoints[begin] : 0;
+      if (c == ',') {
+        this_sentence.push_back(space);
+      }
+
+      if (c == ',' || c == '.' || c == '?' || c == '!' || c == ';') {
+        ans.push_back(std::move(this_sentence));
+      }
+    }
+
+    if (!this_sentence.empty()) {
+      ans.emplace_back(std::move(this_sentence));
+    }
+
+    return ans;
+  }
+
  private:
   void Init(std::istream &is) {
     std::string word;
@@ -94,11 +363,44 @@ class Lexicon::Impl {
 
       word2token_ids_.insert({std::move(word), std::move(ids)});
     }
+
+    for (const auto &p : word2token_ids_) {
+      AddToTrie(&p);
+    }
+  }
+
+  // Pointers into word2token_ids_ stay valid when it grows, so the trie
+  // refers to the token IDs stored there
+  void AddToTrie(
+      const std::pair<const std::string, std::vector<int32_t>> *p) {
+    std::vector<uint32_t> codepoints;
+    std::vector<int32_t> word_begin;
+    SplitUtf8(p->first, &codepoints, &word_begin);
+    trie_.Insert(codepoints.data(), static_cast<int32_t>(codepoints.size()),
+                 &p->second);
+  }
+
+  const std::vector<int32_t> *Find(const wchar_t *codepoints,
+                                   int32_t n) const {
+    int32_t node = 0;
+    for (int32_t i = 0; i != n && node != -1; ++i) {
+      node = trie_.Child(node, static_cast<uint32_t>(codepoints[i]));
+    }
+    return node != -1 ? trie_.Value(node) : nullptr;
+  }
+
+  static std::string ToString(const uint32_t *codepoints, int32_t n) {
+    return sherpa_ncnn::ToString(std::wstring(codepoints, codepoints + n));
   }
 
  private:
   std::unordered_map<std::string, std::vector<int32_t>> word2token_ids_;
   std::unordered_map<std::string, int32_t> token2id_;
+
+  CodepointTrie trie_;
+
+  // Tokens that are a single character
+  std::unordered_map<uint32_t, int32_t> char2id_;
 };
 
 Lexicon::~Lexicon() = default;
@@ -121,4 +423,9 @@ bool Lexicon::Contains(const std::string &word) const {
   return impl_->Contains(word);
 }
 
+std::vector<std::vector<int32_t>> Lexicon::ConvertTextToTokenIdsChinese(
+    const std::string &text) const {
+  return impl_->ConvertTextToTokenIdsChinese(text);
+}
+
 }  // namespace sherpa_ncnn
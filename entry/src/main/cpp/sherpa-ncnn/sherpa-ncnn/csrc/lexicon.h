@@ -28,6 +28,19 @@ class Lexicon {
 
   bool Contains(const std::string& word) const;
 
+  /** Convert text for a Chinese model to token IDs.
+   *
+   * Chinese punctuation is mapped to ASCII. Then, at each position, the
+   * longest word of the lexicon spanning 2 to 11 words of SplitUtf8() is
+   * taken; otherwise a single word is looked up in the lexicon and then in
+   * the tokens. A sentence ends after , . ? ! and ;
+   *
+   * @param text A UTF-8 encoded string.
+   * @return Return the token IDs of each sentence.
+   */
+  std::vector<std::vector<int32_t>> ConvertTextToTokenIdsChinese(
+      const std::string& text) const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -6,16 +6,110 @@
 
 #include <random>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 namespace sherpa_ncnn {
 
-void RandomVectorFill(float *p, int32_t n, float a /*= 0*/, float b /*= 1*/) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<float> dist(a, b);
+// See https://prng.di.unimi.it/splitmix64.c
+static uint64_t SplitMix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
 
-  for (int32_t i = 0; i < n; ++i) {
-    p[i] = dist(gen);
+static inline uint32_t Rotl(uint32_t x, int32_t k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+RandomGenerator::RandomGenerator(int64_t seed /*= -1*/,
+                                 int64_t stream /*= 0*/) {
+  uint64_t x;
+  if (seed < 0) {
+    std::random_device rd;
+    x = (static_cast<uint64_t>(rd()) << 32) | rd();
+  } else {
+    x = static_cast<uint64_t>(seed);
   }
+  uint64_t y = static_cast<uint64_t>(stream);
+  x ^= SplitMix64(&y);
+
+  for (int32_t i = 0; i != 4; ++i) {
+    uint64_t a = SplitMix64(&x);
+    uint64_t b = SplitMix64(&x);
+    s_[0][i] = static_cast<uint32_t>(a);
+    s_[1][i] = static_cast<uint32_t>(a >> 32);
+    s_[2][i] = static_cast<uint32_t>(b);
+    s_[3][i] = static_cast<uint32_t>(b >> 32) | 1;  // never all zeros
+  }
+}
+
+void RandomGenerator::Fill(float *p, int32_t n, float a /*= 0*/,
+                           float b /*= 1*/) {
+  // The top 24 bits of each number give a float in [0, 1)
+  float scale = (b - a) * (1.0f / 16777216);
+
+  int32_t i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  uint32x4_t s0 = vld1q_u32(s_[0]);
+  uint32x4_t s1 = vld1q_u32(s_[1]);
+  uint32x4_t s2 = vld1q_u32(s_[2]);
+  uint32x4_t s3 = vld1q_u32(s_[3]);
+  float32x4_t va = vdupq_n_f32(a);
+  float32x4_t vscale = vdupq_n_f32(scale);
+  for (; i + 4 <= n; i += 4) {
+    uint32x4_t r = vaddq_u32(s0, s3);
+    uint32x4_t t = vshlq_n_u32(s1, 9);
+    s2 = veorq_u32(s2, s0);
+    s3 = veorq_u32(s3, s1);
+    s1 = veorq_u32(s1, s2);
+    s0 = veorq_u32(s0, s3);
+    s2 = veorq_u32(s2, t);
+    s3 = vorrq_u32(vshlq_n_u32(s3, 11), vshrq_n_u32(s3, 21));
+
+    float32x4_t f = vcvtq_f32_u32(vshrq_n_u32(r, 8));
+    vst1q_f32(p + i, vmlaq_f32(va, f, vscale));
+  }
+  vst1q_u32(s_[0], s0);
+  vst1q_u32(s_[1], s1);
+  vst1q_u32(s_[2], s2);
+  vst1q_u32(s_[3], s3);
+#endif
+
+  float r[4];
+  for (; i < n; i += 4) {
+    for (int32_t k = 0; k != 4; ++k) {
+      uint32_t s0 = s_[0][k];
+      uint32_t s1 = s_[1][k];
+      uint32_t s2 = s_[2][k];
+      uint32_t s3 = s_[3][k];
+
+      r[k] = a + static_cast<float>((s0 + s3) >> 8) * scale;
+
+      uint32_t t = s1 << 9;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = Rotl(s3, 11);
+
+      s_[0][k] = s0;
+      s_[1][k] = s1;
+      s_[2][k] = s2;
+      s_[3][k] = s3;
+    }
+
+    // The unused numbers of the last step are dropped
+    std::copy(r, r + std::min(4, n - i), p + i);
+  }
+}
+
+void RandomVectorFill(float *p, int32_t n, float a /*= 0*/, float b /*= 1*/) {
+  static thread_local RandomGenerator gen;
+  gen.Fill(p, n, a, b);
 }
 
 }  // namespace sherpa_ncnn
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <numeric>
 #include <vector>
 
@@ -116,8 +117,33 @@ std::vector<int32_t> TopkIndex(const T *vec, int32_t size, int32_t topk) {
   return index;
 }
 
+// A small and fast random number generator. It runs four xoshiro128+
+// generators side by side, so each step yields four numbers and maps
+// directly to NEON. For a given seed, the output is the same on all
+// platforms.
+class RandomGenerator {
+ public:
+  /**
+   * @param seed  If negative, a seed is taken from std::random_device.
+   * @param stream Generators with the same seed but different streams
+   *               produce unrelated sequences, e.g., one stream per
+   *               sentence.
+   */
+  explicit RandomGenerator(int64_t seed = -1, int64_t stream = 0);
+
+  // fill a vector of length n, pointed by p, with uniformly distributed
+  // numbers from the range [a, b)
+  void Fill(float *p, int32_t n, float a = 0, float b = 1);
+
+ private:
+  // s_[k][i] is the k-th state word of the i-th generator
+  alignas(16) uint32_t s_[4][4];
+};
+
 // fill a vector of length n, pointed by p, with uniformly distributed
-// numbers from the range (a, b)
+// numbers from the range (a, b).
+//
+// It uses a RandomGenerator per thread that is seeded only once.
 void RandomVectorFill(float *p, int32_t n, float a = 0, float b = 1);
 
 }  // namespace sherpa_ncnn
@@ -24,9 +24,17 @@
 #include <vector>
 
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/net-timing.h"
 
 namespace sherpa_ncnn {
 
+ModifiedBeamSearchDecoder::ModifiedBeamSearchDecoder(Model *model,
+                                                     int32_t num_active_paths)
+    : model_(model),
+      num_active_paths_(num_active_paths),
+      projection_(JoinerProjection::Create(&model->GetJoiner())),
+      cache_(model, projection_.get()) {}
+
 DecoderResult ModifiedBeamSearchDecoder::GetEmptyResult() const {
   DecoderResult r;
 
@@ -34,9 +42,7 @@ DecoderResult ModifiedBeamSearchDecoder::GetEmptyResult() const {
   int32_t blank_id = 0;  // always 0
 
   std::vector<int32_t> blanks(context_size, blank_id);
-  Hypotheses blank_hyp({{blanks, 0}});
-
-  r.hyps = std::move(blank_hyp);
+  r.hyps = Hypotheses(blanks, 0);
   r.tokens = std::move(blanks);
   return r;
 }
@@ -67,52 +73,36 @@ static void LogSoftmax(ncnn::Mat *in_out) {
   }
 }
 
-// The decoder model contains an embedding layer, which only supports
-// 1-D output.
-// This is a wrapper to support 2-D decoder output.
+// Indexes of the k largest values in p[0..n), largest first.
 //
-// @param model_ The NN model.
-// @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
+// Unlike TopkIndex(), it does not allocate an index array of size n; it
+// keeps a sorted list of the k best so far, and most values are rejected
+// by a single comparison with the current k-th best.
 //
-// TODO(fangjun): Change Embed in ncnn to output 2-d tensors
-static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
-  ncnn::Mat decoder_out;
-  int32_t h = decoder_input.h;
-
-  for (int32_t y = 0; y != h; ++y) {
-    ncnn::Mat decoder_input_t =
-        ncnn::Mat(decoder_input.w, decoder_input.row(y));
-
-    ncnn::Mat tmp = model_->RunDecoder(decoder_input_t);
-
-    if (y == 0) {
-      decoder_out = ncnn::Mat(tmp.w, h);
+// @param out It is overwritten. Pass the same vector across calls to avoid
+//            allocations.
+static void TopK(const float *p, int32_t n, int32_t k,
+                 std::vector<int32_t> *out) {
+  out->clear();
+  for (int32_t i = 0; i != n; ++i) {
+    int32_t size = static_cast<int32_t>(out->size());
+    if (size == k && p[i] <= p[out->back()]) {
+      continue;
     }
 
-    const float *ptr = tmp;
-    float *out_ptr = decoder_out.row(y);
-    std::copy(ptr, ptr + tmp.w, out_ptr);
-  }
-
-  return decoder_out;
-}
-
-ncnn::Mat ModifiedBeamSearchDecoder::BuildDecoderInput(
-    const std::vector<Hypothesis> &hyps) const {
-  int32_t num_hyps = static_cast<int32_t>(hyps.size());
-  int32_t context_size = model_->ContextSize();
-
-  ncnn::Mat decoder_input(context_size, num_hyps);
-  auto p = static_cast<int32_t *>(decoder_input);
+    int32_t pos = size;
+    while (pos > 0 && p[(*out)[pos - 1]] < p[i]) {
+      --pos;
+    }
 
-  for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
-    std::copy(ys.end() - context_size, ys.end(), p);
-    p += context_size;
+    if (size < k) {
+      out->push_back(i);
+    }
+    for (int32_t j = static_cast<int32_t>(out->size()) - 1; j > pos; --j) {
+      (*out)[j] = (*out)[j - 1];
+    }
+    (*out)[pos] = i;
   }
-
-  return decoder_input;
 }
 
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
@@ -123,29 +113,75 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
                                        DecoderResult *result) {
   int32_t context_size = model_->ContextSize();
-  Hypotheses cur = std::move(result->hyps);
+  Hypotheses &cur = result->hyps;
+  TokenTrie &trie = cur.Trie();
+
+  // With a projection, the joiner is fed the projected encoder frames and
+  // decoder outputs, so only the add and the layers after it run per frame
+  ncnn::Mat encoder_in = encoder_out;
+  if (projection_) {
+    SHERPA_NCNN_TIME_NET("asr.joiner_proj");
+    encoder_in = projection_->ProjectEncoder(encoder_out);
+  }
+
+  // Scratch space, reused for all frames of this chunk
+  std::vector<ActivePath> prev;
+  prev.reserve(num_active_paths_);
+  std::vector<int32_t> topk;
+  topk.reserve(num_active_paths_);
+  std::vector<int32_t> context(context_size);
+  ncnn::Mat decoder_batch;
+
+  int32_t frame_offset = result->frame_offset;
+
   /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
   for (int32_t t = 0; t != encoder_out.h; ++t) {
-    std::vector<Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
+    cur.GetTopK(num_active_paths_, true, &prev);
     cur.Clear();
 
-    ncnn::Mat decoder_input = BuildDecoderInput(prev);
-    ncnn::Mat decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
-        !result->decoder_out.empty()) {
-      // When an endpoint is detected, we keep the decoder_out
-      decoder_out = result->decoder_out;
-    } else {
-      decoder_out = RunDecoder2D(model_, decoder_input);
+    int32_t num_paths = static_cast<int32_t>(prev.size());
+
+    // Gather the decoder output of every path into one (num_paths, dim)
+    // matrix, so the joiner runs once for all paths
+    for (int32_t i = 0; i != num_paths; ++i) {
+      DecoderCache::Entry entry;
+      if (t == 0 && num_paths == 1 &&
+          trie.Get(prev[0].node).length == context_size &&
+          !result->decoder_out.empty()) {
+        // When an endpoint is detected, we keep the decoder_out
+        entry.decoder_out = result->decoder_out;
+        entry.decoder_proj = result->decoder_proj;
+        cache_.Project(&entry);
+      } else {
+        trie.Context(prev[i].node, context_size, context.data());
+        entry = cache_.Get(context.data());
+      }
+
+      const ncnn::Mat &row =
+          projection_ ? entry.decoder_proj : entry.decoder_out;
+      if (decoder_batch.empty()) {
+        decoder_batch.create(row.w, num_active_paths_);
+      }
+      const float *p = row;
+      std::copy(p, p + row.w, decoder_batch.row(i));
     }
 
-    // decoder_out.w == decoder_dim
-    // decoder_out.h == num_active_paths
-    ncnn::Mat encoder_out_t(encoder_out.w, 1, encoder_out.row(t));
+    // decoder_t.w == decoder_dim (or joiner_dim with a projection)
+    // decoder_t.h == num_paths
+    ncnn::Mat decoder_t(decoder_batch.w, num_paths, decoder_batch.data);
+    ncnn::Mat encoder_t(encoder_in.w, 1, encoder_in.row(t));
 
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out;
+    {
+      SHERPA_NCNN_TIME_NET("asr.joiner");
+      if (projection_) {
+        joiner_out = projection_->Run(encoder_t, decoder_t);
+      } else {
+        joiner_out = model_->RunJoiner(encoder_t, decoder_t);
+      }
+    }
     // joiner_out.w == vocab_size
-    // joiner_out.h == num_active_paths
+    // joiner_out.h == num_paths
     LogSoftmax(&joiner_out);
 
     float *p_joiner_out = joiner_out;
@@ -157,48 +193,45 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
       }
     }
 
-    auto topk = TopkIndex(static_cast<float *>(joiner_out),
-                          joiner_out.w * joiner_out.h, num_active_paths_);
+    TopK(static_cast<float *>(joiner_out), joiner_out.w * joiner_out.h,
+         num_active_paths_, &topk);
 
-    int32_t frame_offset = result->frame_offset;
     for (auto i : topk) {
       int32_t hyp_index = i / joiner_out.w;
       int32_t new_token = i % joiner_out.w;
 
       const float *p = joiner_out.row(hyp_index);
 
-      Hypothesis new_hyp = prev[hyp_index];
-      // const float prev_lm_log_prob = new_hyp.lm_log_prob;
+      ActivePath new_path = prev[hyp_index];
       float context_score = 0;
-      auto context_state = new_hyp.context_state;
       // blank id is fixed to 0
       if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
-        new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
+        new_path.node = trie.Append(new_path.node, new_token, t + frame_offset);
+        new_path.num_trailing_blanks = 0;
         if (s && s->GetContextGraph()) {
           auto context_res = s->GetContextGraph()->ForwardOneStep(
-              context_state, new_token, false /*strict_mode*/);
+              new_path.context_state, new_token, false /*strict_mode*/);
           context_score = std::get<0>(context_res);
-          new_hyp.context_state = std::get<1>(context_res);
+          new_path.context_state = std::get<1>(context_res);
         }
       } else {
-        ++new_hyp.num_trailing_blanks;
+        ++new_path.num_trailing_blanks;
       }
       // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
+      new_path.log_prob = p[new_token] + context_score;
 
-      cur.Add(std::move(new_hyp));
+      cur.Add(new_path);
     }
   }
 
-  result->hyps = std::move(cur);
+  cur.CompactTrie();
   result->frame_offset += encoder_out.h;
-  auto hyp = result->hyps.GetMostProbable(true);
+  auto hyp = cur.GetMostProbable(true);
 
   // set decoder_out in case of endpointing
-  ncnn::Mat decoder_input = BuildDecoderInput({hyp});
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  DecoderCache::Entry entry = cache_.Get(&*(hyp.ys.end() - context_size));
+  result->decoder_out = entry.decoder_out;
+  result->decoder_proj = entry.decoder_proj;
 
   result->tokens = std::move(hyp.ys);
   result->num_trailing_blanks = hyp.num_trailing_blanks;
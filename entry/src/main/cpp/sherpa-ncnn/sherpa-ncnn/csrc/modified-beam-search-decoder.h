@@ -20,10 +20,13 @@
 #ifndef SHERPA_NCNN_CSRC_MODIFIED_BEAM_SEARCH_DECODER_H_
 #define SHERPA_NCNN_CSRC_MODIFIED_BEAM_SEARCH_DECODER_H_
 
+#include <memory>
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/decoder-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/joiner-projection.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/stream.h"
 #include "sherpa-ncnn/csrc/context-graph.h"
@@ -32,8 +35,7 @@ namespace sherpa_ncnn {
 
 class ModifiedBeamSearchDecoder : public Decoder {
  public:
-  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths)
-      : model_(model), num_active_paths_(num_active_paths) {}
+  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths);
 
   DecoderResult GetEmptyResult() const override;
 
@@ -42,12 +44,16 @@ class ModifiedBeamSearchDecoder : public Decoder {
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
   void Decode(ncnn::Mat encoder_out, Stream *s, DecoderResult *result) override;
 
- private:
-  ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps) const;
-
  private:
   Model *model_;  // not owned
   int32_t num_active_paths_;
+
+  // Null if the joiner cannot be split; see JoinerProjection
+  std::unique_ptr<JoinerProjection> projection_;
+
+  // Decoder outputs by context. Paths that do not emit keep their context,
+  // so on most frames all decoder outputs come from the cache.
+  DecoderCache cache_;
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,101 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sherpa-ncnn/csrc/net-timing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace sherpa_ncnn {
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<NetTimingSlot *> slots;
+};
+
+Registry &GetRegistry() {
+  // Leaked on purpose: slots may still be used during static destruction
+  static Registry *registry = new Registry;
+  return *registry;
+}
+
+}  // namespace
+
+NetTimingSlot::NetTimingSlot(const char *name) : name_(name) {
+  Registry &r = GetRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.slots.push_back(this);
+}
+
+void NetTimingSlot::Add(int64_t us) {
+  calls_.fetch_add(1, std::memory_order_relaxed);
+  total_us_.fetch_add(us, std::memory_order_relaxed);
+
+  int64_t prev = max_us_.load(std::memory_order_relaxed);
+  while (us > prev &&
+         !max_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+  }
+}
+
+void NetTimingSlot::Reset() {
+  calls_.store(0, std::memory_order_relaxed);
+  total_us_.store(0, std::memory_order_relaxed);
+  max_us_.store(0, std::memory_order_relaxed);
+}
+
+NetTimingStats NetTimingSlot::Get() const {
+  NetTimingStats s;
+  s.name = name_;
+  s.calls = calls_.load(std::memory_order_relaxed);
+  s.total_us = total_us_.load(std::memory_order_relaxed);
+  s.max_us = max_us_.load(std::memory_order_relaxed);
+  return s;
+}
+
+std::vector<NetTimingStats> GetNetTimings() {
+  Registry &r = GetRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+
+  // Slots sharing a name (same net timed at several call sites) are merged
+  std::vector<NetTimingStats> ans;
+  ans.reserve(r.slots.size());
+  for (const auto *slot : r.slots) {
+    NetTimingStats s = slot->Get();
+    auto it = std::find_if(ans.begin(), ans.end(), [&s](const NetTimingStats &a) {
+      return std::strcmp(a.name, s.name) == 0;
+    });
+    if (it == ans.end()) {
+      ans.push_back(s);
+      continue;
+    }
+    it->calls += s.calls;
+    it->total_us += s.total_us;
+    it->max_us = std::max(it->max_us, s.max_us);
+  }
+  return ans;
+}
+
+void ResetNetTimings() {
+  Registry &r = GetRegistry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (auto *slot : r.slots) {
+    slot->Reset();
+  }
+}
+
+}  // namespace sherpa_ncnn
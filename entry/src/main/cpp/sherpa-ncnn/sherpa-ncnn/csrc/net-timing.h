@@ -0,0 +1,89 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SHERPA_NCNN_CSRC_NET_TIMING_H_
+#define SHERPA_NCNN_CSRC_NET_TIMING_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+struct NetTimingStats {
+  const char *name = nullptr;
+  int64_t calls = 0;
+  int64_t total_us = 0;
+  int64_t max_us = 0;
+};
+
+// Accumulated wall-clock time of one ncnn net, e.g., "asr.joiner".
+//
+// Slots are meant to be function-local statics; they register themselves in
+// a global list on construction and are never destroyed before exit.
+// Add() only does relaxed atomic updates, so it is cheap enough to be
+// called once per joiner invocation.
+class NetTimingSlot {
+ public:
+  explicit NetTimingSlot(const char *name);
+
+  NetTimingSlot(const NetTimingSlot &) = delete;
+  NetTimingSlot &operator=(const NetTimingSlot &) = delete;
+
+  void Add(int64_t us);
+  void Reset();
+
+  NetTimingStats Get() const;
+
+ private:
+  const char *name_;
+  std::atomic<int64_t> calls_{0};
+  std::atomic<int64_t> total_us_{0};
+  std::atomic<int64_t> max_us_{0};
+};
+
+// Measures the lifetime of the object and adds it to the given slot.
+class ScopedNetTimer {
+ public:
+  explicit ScopedNetTimer(NetTimingSlot *slot)
+      : slot_(slot), start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedNetTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    slot_->Add(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+  }
+
+ private:
+  NetTimingSlot *slot_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Snapshot of all registered slots, in registration order. Slots with the
+// same name are merged into one entry.
+std::vector<NetTimingStats> GetNetTimings();
+
+void ResetNetTimings();
+
+}  // namespace sherpa_ncnn
+
+// Time the enclosing scope under the given name (a string literal).
+#define SHERPA_NCNN_TIME_NET(name)                                   \
+  static sherpa_ncnn::NetTimingSlot sherpa_ncnn_net_timing_slot(name); \
+  sherpa_ncnn::ScopedNetTimer sherpa_ncnn_net_timer(                  \
+      &sherpa_ncnn_net_timing_slot)
+
+#endif  // SHERPA_NCNN_CSRC_NET_TIMING_H_
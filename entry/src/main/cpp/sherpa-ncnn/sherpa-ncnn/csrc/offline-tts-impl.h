@@ -29,6 +29,8 @@ class OfflineTtsImpl {
   // Number of supported speakers.
   // If it supports only a single speaker, then it return 0 or 1.
   virtual int32_t NumSpeakers() const = 0;
+
+  virtual void SetNumThreads(int32_t num_threads) = 0;
 };
 
 }  // namespace sherpa_ncnn
@@ -7,10 +7,10 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <deque>
+#include <future>  // NOLINT
 #include <memory>
-#include <regex>  // NOLINT
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -40,6 +40,10 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     return model_->GetMetaData().num_speakers;
   }
 
+  void SetNumThreads(int32_t num_threads) override {
+    model_->SetNumThreads(num_threads);
+  }
+
   GeneratedAudio Generate(const TtsArgs &_args,
                           GeneratedAudioCallback callback = nullptr,
                           void *callback_arg = nullptr) const override {
@@ -79,13 +83,69 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
 
     std::vector<float> samples;
     bool should_continue = true;
-    int32_t processed = 0;
     int32_t total = args.tokens.size();
-    for (const auto &tokens : args.tokens) {
-      ++processed;
 
-      ncnn::Mat o = Process(tokens, args.sid, args.noise_scale_w,
-                            args.noise_scale, args.speed);
+    // Everything before the decoder, i.e., encoder, duration predictor and
+    // flow, of the i-th sentence
+    auto run_acoustic_model = [this, &args](int32_t i) {
+      // One stream per sentence, so that a sentence does not depend on
+      // how much noise the previous ones used
+      RandomGenerator rng(args.seed, i + 1);
+
+      Latent latent;
+      latent.z = Process(args.tokens[i], args.sid, args.noise_scale_w,
+                         args.noise_scale, args.speed, &rng, &latent.g);
+      return latent;
+    };
+
+    // The acoustic model of the next num_ahead sentences runs on other
+    // threads while the current sentence is being decoded. They share the
+    // networks, and so num_threads, with the decoder
+    int32_t num_ahead = args.num_ahead;
+    if (num_ahead < 0) {
+      num_ahead = config_.max_num_sentences > 0
+                      ? config_.max_num_sentences - 1
+                      : kMaxNumAhead;
+    }
+    num_ahead = std::min(num_ahead, kMaxNumAhead);
+    std::deque<std::future<Latent>> ahead;
+    int32_t num_started = 0;
+
+    for (int32_t i = 0; i != total; ++i) {
+      int32_t processed = i + 1;
+
+      Latent latent;
+      if (i < num_started) {
+        latent = ahead.front().get();
+        ahead.pop_front();
+      } else {
+        latent = run_acoustic_model(i);
+        num_started = i + 1;
+      }
+
+      for (; num_started < total && num_started <= i + num_ahead;
+           ++num_started) {
+        ahead.push_back(
+            std::async(std::launch::async, run_acoustic_model, num_started));
+      }
+
+      ncnn::Mat &z = latent.z;
+      const ncnn::Mat &g = latent.g;
+
+      // Long sentences are decoded window by window so that the first
+      // audio is available after one window
+      if (callback && config_.decoder_chunk_size > 0 &&
+          z.w > config_.decoder_chunk_size + config_.decoder_chunk_padding) {
+        should_continue = DecodeInChunks(z, g, processed, total, callback,
+                                         callback_arg, &samples);
+        if (!should_continue) {
+          break;
+        }
+        continue;
+      }
+
+      ncnn::Mat o = model_->RunDecoder(z, g);
+      z.release();
 
       samples.insert(samples.end(), static_cast<const float *>(o),
                      static_cast<const float *>(o) + o.w);
@@ -103,6 +163,9 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
       }
     }
 
+    // Sentences still running ahead are waited for by ~future() when we
+    // stop early; their results are dropped
+
     GeneratedAudio ans;
     ans.sample_rate = meta_data.sample_rate;
     ans.samples = std::move(samples);
@@ -111,8 +174,21 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   }
 
  private:
+  // Each look-ahead sentence is a thread of its own, and its latent is kept
+  // until it is decoded, so we never start more than this many
+  static constexpr int32_t kMaxNumAhead = 2;
+
+  // Input of the decoder
+  struct Latent {
+    ncnn::Mat z;
+    ncnn::Mat g;  // speaker embedding
+  };
+
+  // Run everything but the decoder. Return z, the input of the decoder,
+  // and set *g to the speaker embedding.
   ncnn::Mat Process(const std::vector<int32_t> &_tokens, int32_t sid,
-                    float noise_scale_w, float noise_scale, float speed) const {
+                    float noise_scale_w, float noise_scale, float speed,
+                    RandomGenerator *rng, ncnn::Mat *g) const {
     // add bos, eos, and pad
     const auto &meta = model_->GetMetaData();
     int32_t bos = meta.bos;
@@ -134,132 +210,110 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     sequence.release();
 
     ncnn::Mat noise(encoder_out[0].w, 2);
-    RandomVectorFill(static_cast<float *>(noise), noise.w * noise.h, 0,
-                     noise_scale_w);
+    rng->Fill(static_cast<float *>(noise), noise.w * noise.h, 0,
+              noise_scale_w);
 
-    ncnn::Mat g = model_->RunEmbedding(sid);
+    *g = model_->RunEmbedding(sid);
 
-    ncnn::Mat logw = model_->RunDurationPredictor(encoder_out[0], noise, g);
+    ncnn::Mat logw = model_->RunDurationPredictor(encoder_out[0], noise, *g);
 
     noise.release();
     encoder_out[0].release();
 
     ncnn::Mat z_p = model_->PathAttention(logw, encoder_out[1], encoder_out[2],
-                                          noise_scale, speed);
+                                          noise_scale, speed, rng);
     encoder_out.clear();
     logw.release();
 
-    ncnn::Mat z = model_->RunFlow(z_p, g);
-    z_p.release();
-
-    ncnn::Mat o = model_->RunDecoder(z, g);
+    ncnn::Mat z = model_->RunFlow(z_p, *g);
 
-    return o;
+    return z;
   }
 
-  std::vector<std::vector<int32_t>> Convert(const std::string &text) const {
-    const auto &voice = model_->GetMetaData().voice;
-    if (voice == "cmn") {
-      return ConvertChinese(text);
-    } else {
-      return ConvertNonChinese(text);
+  // Columns [start, end) of z, i.e., frames start to end - 1
+  static ncnn::Mat SliceFrames(const ncnn::Mat &z, int32_t start,
+                               int32_t end) {
+    ncnn::Mat ans(end - start, z.h);
+    for (int32_t c = 0; c != z.h; ++c) {
+      const float *src = z.row(c);
+      std::copy(src + start, src + end, ans.row(c));
     }
+    return ans;
   }
 
-  // end is inclusive
-  static std::string GetWord(const std::vector<std::string> &words,
-                             int32_t start, int32_t end) {
-    std::string ans;
+  /* Run the decoder on windows of config_.decoder_chunk_size frames of z.
+   *
+   * Each window is decoded together with decoder_chunk_padding frames of
+   * context on both sides, which are dropped from the output. Consecutive
+   * windows share decoder_chunk_overlap frames: the end of a window is held
+   * back and cross-faded with the start of the next one, so there is no
+   * click at the seam.
+   *
+   * @return Return false if the callback asked to stop.
+   */
+  bool DecodeInChunks(const ncnn::Mat &z, const ncnn::Mat &g, int32_t processed,
+                      int32_t total, const GeneratedAudioCallback &callback,
+                      void *callback_arg, std::vector<float> *samples) const {
+    int32_t num_frames = z.w;
+    int32_t chunk_size = config_.decoder_chunk_size;
+    int32_t padding = config_.decoder_chunk_padding;
+    int32_t overlap = config_.decoder_chunk_overlap;
+
+    std::vector<float> out;
+    std::vector<float> tail;  // held back for the next window
+    for (int32_t start = 0; start < num_frames; start += chunk_size) {
+      int32_t end = std::min(start + chunk_size, num_frames);
+      bool is_last = end == num_frames;
+
+      int32_t context_start = std::max(0, start - padding);
+      int32_t context_end = std::min(num_frames, end + padding);
+      ncnn::Mat o =
+          model_->RunDecoder(SliceFrames(z, context_start, context_end), g);
+
+      // Number of samples per frame
+      int32_t hop = o.w / (context_end - context_start);
+
+      // Keep frames [start, keep_end) of this window
+      int32_t keep_end = std::min(end + overlap, num_frames);
+      const float *p = static_cast<const float *>(o) +
+                       (start - context_start) * hop;
+      out.assign(p, p + (keep_end - start) * hop);
+
+      // The held-back tail covers the first frames of this window
+      int32_t n = static_cast<int32_t>(tail.size());
+      for (int32_t i = 0; i != n; ++i) {
+        float w = (i + 0.5f) / n;
+        out[i] = tail[i] * (1 - w) + out[i] * w;
+      }
+
+      int32_t num_emitted =
+          is_last ? static_cast<int32_t>(out.size()) : (end - start) * hop;
+      tail.assign(out.begin() + num_emitted, out.end());
 
-    if (start >= words.size() || end >= words.size()) {
-      return ans;
-    }
+      samples->insert(samples->end(), out.begin(), out.begin() + num_emitted);
 
-    for (int32_t i = start; i <= end; ++i) {
-      ans += words[i];
+      if (!callback(out.data(), num_emitted,
+                    is_last ? processed : processed - 1, total,
+                    callback_arg)) {
+        return false;
+      }
     }
 
-    return ans;
+    return true;
   }
 
-  static std::string NormalizeChinesePunctuation(const std::string &input) {
-    std::string text = input;
-
-    static const std::unordered_map<std::string, std::string> punct_map = {
-        {"，", ","}, {"。", "."}, {"！", "!"}, {"？", "?"},
-        {"：", ":"}, {"；", ";"}, {"（", "("}, {"）", ")"},
-        {"【", "["}, {"】", "]"}, {"“", "\""}, {"”", "\""},
-        {"‘", "'"},  {"’", "'"},  {"《", "<"}, {"》", ">"}};
-
-    for (const auto &kv : punct_map) {
-      text = std::regex_replace(text, std::regex(kv.first), kv.second);
+  std::vector<std::vector<int32_t>> Convert(const std::string &text) const {
+    const auto &voice = model_->GetMetaData().voice;
+    if (voice == "cmn") {
+      return ConvertChinese(text);
+    } else {
+      return ConvertNonChinese(text);
     }
-
-    return text;
   }
 
   std::vector<std::vector<int32_t>> ConvertChinese(
-      const std::string &_text) const {
-    auto text = NormalizeChinesePunctuation(_text);
-
-    std::vector<std::string> words = SplitUtf8(text);
-
-    const auto &token2id = model_->GetMetaData().token2id;
-    std::vector<std::vector<int32_t>> ans;
-    std::vector<int32_t> this_sentence;
-    std::vector<int32_t> token_ids;
-
-    int32_t num_words = static_cast<int32_t>(words.size());
-    int32_t max_len = 10;
-    int32_t space = token2id.at(" ");
-
-    for (int32_t i = 0; i < num_words;) {
-      int32_t start = i;
-      int32_t end = std::min(i + max_len, num_words - 1);
-
-      std::string w;
-      while (end > start) {
-        auto this_word = GetWord(words, start, end);
-
-        if (lexicon_->Contains(this_word)) {
-          i = end + 1;
-          w = std::move(this_word);
-
-          break;
-        }
-
-        end -= 1;
-      }
-
-      if (w.empty()) {
-        w = words[i];
-        i += 1;
-      }
-
-      lexicon_->TokenizeWord(w, &token_ids);
-
-      if (!token_ids.empty()) {
-        this_sentence.insert(this_sentence.end(), token_ids.begin(),
-                             token_ids.end());
-      } else if (token2id.count(w)) {
-        this_sentence.push_back(token2id.at(w));
-        if (w == ",") {
-          this_sentence.push_back(space);
-        }
-
-        if (w == "," || w == "." || w == "?" || w == "!" || w == ";") {
-          ans.push_back(std::move(this_sentence));
-        }
-      } else {
-        SHERPA_NCNN_LOGE("empty ids for word %s", w.c_str());
-      }
-    }  // for (int32_t i = 0; i < num_words;)
-
-    if (!this_sentence.empty()) {
-      ans.emplace_back(std::move(this_sentence));
-    }
-
-    return ans;
+      const std::string &text) const {
+    return lexicon_->ConvertTextToTokenIdsChinese(text);
   }
 
   std::vector<std::vector<int32_t>> ConvertNonChinese(
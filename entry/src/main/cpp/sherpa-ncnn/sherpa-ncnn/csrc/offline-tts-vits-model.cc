@@ -14,13 +14,14 @@
 
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/net-timing.h"
 
 namespace sherpa_ncnn {
 
 // this function is is modified from nihui's implementation
 static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                    ncnn::Mat &logs_p, float noise_scale,
-                                   float speed) {
+                                   float speed, RandomGenerator *rng) {
   float length_scale = 1 / speed;
 
   const int x_lengths = logw.w;
@@ -43,12 +44,18 @@ static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
     const float *logs_p_ptr = logs_p.row(i);
     float *ptr = z_p.row(i);
 
+    // Draw the noise of the whole row at once, then map frame k of token j
+    // from [0, 1) to [m, m + nl)
+    rng->Fill(ptr, y_lengths);
+
     for (int j = 0; j < x_lengths; j++) {
       const float m = m_p_ptr[j];
       const float nl = expf(logs_p_ptr[j]) * noise_scale;
       const int duration = w_ceil[j];
 
-      RandomVectorFill(ptr, duration, m, m + nl);
+      for (int k = 0; k < duration; k++) {
+        ptr[k] = m + nl * ptr[k];
+      }
 
       ptr += duration;
     }
@@ -314,6 +321,7 @@ class OfflineTtsVitsModel::Impl {
   const OfflineTtsVitsModelMetaData &GetMetaData() const { return meta_; }
 
   std::vector<ncnn::Mat> RunEncoder(const ncnn::Mat &sequence) const {
+    SHERPA_NCNN_TIME_NET("tts.encoder");
     ncnn::Extractor ex = enc_p_.create_extractor();
 
     ex.input("in0", sequence);
@@ -331,6 +339,7 @@ class OfflineTtsVitsModel::Impl {
 
   ncnn::Mat RunDurationPredictor(const ncnn::Mat &x, const ncnn::Mat &noise,
                                  const ncnn::Mat &g) const {
+    SHERPA_NCNN_TIME_NET("tts.dp");
     ncnn::Extractor ex = dp_.create_extractor();
 
     ex.input("in0", x);
@@ -347,6 +356,7 @@ class OfflineTtsVitsModel::Impl {
   }
 
   ncnn::Mat RunFlow(const ncnn::Mat &z_p, const ncnn::Mat &g) const {
+    SHERPA_NCNN_TIME_NET("tts.flow");
     ncnn::Extractor ex = flow_.create_extractor();
 
     ex.input("in0", z_p);
@@ -361,6 +371,7 @@ class OfflineTtsVitsModel::Impl {
   }
 
   ncnn::Mat RunDecoder(const ncnn::Mat &z, const ncnn::Mat &g) const {
+    SHERPA_NCNN_TIME_NET("tts.decoder");
     ncnn::Extractor ex = decoder_.create_extractor();
 
     ex.input("in0", z);
@@ -382,6 +393,7 @@ class OfflineTtsVitsModel::Impl {
     sid = sid < 0 ? 0 : sid;
     sid = sid > meta_.num_speakers - 1 ? meta_.num_speakers - 1 : sid;
 
+    SHERPA_NCNN_TIME_NET("tts.embedding");
     ncnn::Extractor ex = embedding_.create_extractor();
 
     ncnn::Mat in(1);
@@ -397,6 +409,14 @@ class OfflineTtsVitsModel::Impl {
     return g;
   }
 
+  void SetNumThreads(int32_t num_threads) {
+    enc_p_.opt.num_threads = num_threads;
+    dp_.opt.num_threads = num_threads;
+    flow_.opt.num_threads = num_threads;
+    decoder_.opt.num_threads = num_threads;
+    embedding_.opt.num_threads = num_threads;
+  }
+
  private:
   void Init() {
     meta_ = ReadFromConfigJson(config_.vits.model_dir + "/config.json");
@@ -515,8 +535,9 @@ ncnn::Mat OfflineTtsVitsModel::RunDurationPredictor(const ncnn::Mat &x,
 ncnn::Mat OfflineTtsVitsModel::PathAttention(const ncnn::Mat &logw,
                                              const ncnn::Mat &m_p,
                                              ncnn::Mat &logs_p,
-                                             float noise_scale, float speed) {
-  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed);
+                                             float noise_scale, float speed,
+                                             RandomGenerator *rng) {
+  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed, rng);
 }
 
 ncnn::Mat OfflineTtsVitsModel::RunFlow(const ncnn::Mat &z_p,
@@ -533,4 +554,8 @@ ncnn::Mat OfflineTtsVitsModel::RunEmbedding(int32_t sid) const {
   return impl_->RunEmbedding(sid);
 }
 
+void OfflineTtsVitsModel::SetNumThreads(int32_t num_threads) {
+  impl_->SetNumThreads(num_threads);
+}
+
 }  // namespace sherpa_ncnn
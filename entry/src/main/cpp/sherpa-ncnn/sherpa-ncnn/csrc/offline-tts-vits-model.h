@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/math.h"
 #include "sherpa-ncnn/csrc/offline-tts-model-config.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model-meta-data.h"
 
@@ -52,12 +53,13 @@ class OfflineTtsVitsModel {
    * @param logs_p It is returned by RunEncoder()
    * @param noise_scale
    * @param speed Note speed = 1 / length_scale, so speed should > 0
+   * @param rng It provides the noise of z_p
    *
    * @returns Return z_p
    */
   static ncnn::Mat PathAttention(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                  ncnn::Mat &logs_p, float noise_scale,
-                                 float speed);
+                                 float speed, RandomGenerator *rng);
 
   /**
    * @param z_p It is returned by PathAttention()
@@ -73,6 +75,9 @@ class OfflineTtsVitsModel {
    */
   ncnn::Mat RunDecoder(const ncnn::Mat &z, const ncnn::Mat &g) const;
 
+  // Change the number of threads of all the contained networks
+  void SetNumThreads(int32_t num_threads);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
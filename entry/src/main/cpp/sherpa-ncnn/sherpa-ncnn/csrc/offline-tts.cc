@@ -99,9 +99,10 @@ void OfflineTtsConfig::Register(ParseOptions *po) {
 
   po->Register(
       "tts-max-num-sentences", &max_num_sentences,
-      "Maximum number of sentences that we process at a time. "
-      "This is to avoid OOM for very long input text. "
-      "If you set it to -1, then we process all sentences in a single batch.");
+      "Maximum number of sentences that we process at a time. The encoder "
+      "and flow of the next sentences run on other threads while the "
+      "current one is decoded. This is to avoid OOM for very long input "
+      "text. If you set it to -1, then as many as allowed are started.");
 
   po->Register(
       "tts-max-tokens-per-sentence", &max_tokens_per_sentence,
@@ -110,6 +111,18 @@ void OfflineTtsConfig::Register(ParseOptions *po) {
   po->Register("tts-silence-scale", &silence_scale,
                "Duration of the pause is scaled by this number. So a smaller "
                "value leads to a shorter pause.");
+
+  po->Register("tts-decoder-chunk-size", &decoder_chunk_size,
+               "If positive, run the vocoder on windows of this many frames "
+               "and return audio for each window as soon as it is ready. "
+               "0 decodes each sentence at once.");
+
+  po->Register("tts-decoder-chunk-padding", &decoder_chunk_padding,
+               "Frames of context added on both sides of a decoder window");
+
+  po->Register("tts-decoder-chunk-overlap", &decoder_chunk_overlap,
+               "Frames over which consecutive decoder windows are "
+               "cross-faded. Must not exceed --tts-decoder-chunk-padding");
 }
 
 bool OfflineTtsConfig::Validate() const {
@@ -140,6 +153,17 @@ bool OfflineTtsConfig::Validate() const {
     return false;
   }
 
+  if (decoder_chunk_size > 0 &&
+      (decoder_chunk_overlap < 0 ||
+       decoder_chunk_overlap > decoder_chunk_padding ||
+       decoder_chunk_overlap >= decoder_chunk_size)) {
+    SHERPA_NCNN_LOGE(
+        "--tts-decoder-chunk-overlap (%d) should be >= 0, <= "
+        "--tts-decoder-chunk-padding (%d) and < --tts-decoder-chunk-size (%d)",
+        decoder_chunk_overlap, decoder_chunk_padding, decoder_chunk_size);
+    return false;
+  }
+
   return model.Validate();
 }
 
@@ -151,7 +175,10 @@ std::string OfflineTtsConfig::ToString() const {
   os << "rule_fsts=\"" << rule_fsts << "\", ";
   os << "rule_fars=\"" << rule_fars << "\", ";
   os << "max_num_sentences=" << max_num_sentences << ", ";
-  os << "silence_scale=" << silence_scale << ")";
+  os << "silence_scale=" << silence_scale << ", ";
+  os << "decoder_chunk_size=" << decoder_chunk_size << ", ";
+  os << "decoder_chunk_padding=" << decoder_chunk_padding << ", ";
+  os << "decoder_chunk_overlap=" << decoder_chunk_overlap << ")";
 
   return os.str();
 }
@@ -193,4 +220,12 @@ int32_t OfflineTts::SampleRate() const { return impl_->SampleRate(); }
 
 int32_t OfflineTts::NumSpeakers() const { return impl_->NumSpeakers(); }
 
+void OfflineTts::SetNumThreads(int32_t num_threads) {
+  if (num_threads < 1) {
+    SHERPA_NCNN_LOGE("num_threads should be > 0. Given %d", num_threads);
+    return;
+  }
+  impl_->SetNumThreads(num_threads);
+}
+
 }  // namespace sherpa_ncnn
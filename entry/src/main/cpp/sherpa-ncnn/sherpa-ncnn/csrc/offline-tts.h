@@ -28,8 +28,12 @@ struct OfflineTtsConfig {
   std::string rule_fars;
 
   // Maximum number of sentences that we process at a time.
-  // This is to avoid OOM for very long input text.
-  // If you set it to -1, then we process all sentences in a single batch.
+  // While one sentence is in the decoder, the encoder, duration predictor
+  // and flow of the next max_num_sentences - 1 sentences run on other
+  // threads. 1 processes sentences one after another. A limit avoids OOM
+  // for very long input text.
+  // If you set it to -1, then as many sentences as allowed are started.
+  // It is the default of TtsArgs::num_ahead, see there.
   int32_t max_num_sentences = 1;
 
   // If positive, we limit the max number of tokens per sentence
@@ -40,6 +44,21 @@ struct OfflineTtsConfig {
   // the duration of the new interval is old_duration * silence_scale.
   float silence_scale = 1.0;
 
+  // If positive, the VITS decoder runs on windows of this many frames of
+  // the latent z instead of on the whole sentence, and the callback is
+  // invoked for every window. Audio then starts after the first window is
+  // decoded rather than after the whole sentence.
+  int32_t decoder_chunk_size = 0;
+
+  // Frames of z added on both sides of a window so that the decoder sees
+  // the context its receptive field needs. Only the samples of the window
+  // itself are kept.
+  int32_t decoder_chunk_padding = 8;
+
+  // Frames over which two consecutive windows are cross-faded. Must not be
+  // larger than decoder_chunk_padding.
+  int32_t decoder_chunk_overlap = 2;
+
   OfflineTtsConfig() = default;
   OfflineTtsConfig(const OfflineTtsModelConfig &model,
                    const std::string &rule_fsts, const std::string &rule_fars,
@@ -97,6 +116,21 @@ struct TtsArgs {
 
   float noise_scale = 0.667f;
   float noise_scale_w = 0.8f;
+
+  // Seed of the noise added during generation. If it is non-negative,
+  // the same arguments always produce the same audio, which is useful
+  // for benchmarks and tests. If it is negative, a random seed is used.
+  int64_t seed = -1;
+
+  // Number of the following sentences whose encoder, duration predictor
+  // and flow run on other threads while the current sentence is decoded.
+  // If it is negative, OfflineTtsConfig::max_num_sentences - 1 is used.
+  // It is capped at a small constant, see OfflineTtsVitsImpl.
+  // The look-ahead threads are started by the thread calling Generate(), so
+  // they inherit its CPU affinity, and each of them uses model.num_threads
+  // threads like the decoder does. Callers with a fixed number of cores
+  // should divide num_threads accordingly.
+  int32_t num_ahead = -1;
 };
 
 class OfflineTtsImpl;
@@ -112,8 +146,11 @@ class OfflineTts {
   ~OfflineTts();
   explicit OfflineTts(const OfflineTtsConfig &config);
 
-  // @param callback If not NULL, it is called whenever config.max_num_sentences
-  //                 sentences have been processed. Note that the passed
+  // @param callback If not NULL, it is called whenever a sentence has been
+  //                 processed. If
+  //                 config.decoder_chunk_size is positive, it is called for
+  //                 every decoded window instead, and `processed` only
+  //                 advances with the last window of a sentence. Note that the passed
   //                 pointer `samples` for the callback might be invalidated
   //                 after the callback is returned, so the caller should not
   //                 keep a reference to it. The caller can copy the data if
@@ -131,6 +168,11 @@ class OfflineTts {
   // If it supports only a single speaker, then it return 0 or 1.
   int32_t NumSpeakers() const;
 
+  // Change the number of threads used by the model. It takes effect from
+  // the next call to Generate(). It must not be called while another thread
+  // is running Generate().
+  void SetNumThreads(int32_t num_threads);
+
  private:
   std::unique_ptr<OfflineTtsImpl> impl_;
 };
@@ -29,6 +29,7 @@
 #include "sherpa-ncnn/csrc/decoder.h"
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 #include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
+#include "sherpa-ncnn/csrc/net-timing.h"
 
 #if __ANDROID_API__ >= 9
 #include <strstream>
@@ -138,7 +139,7 @@ class Recognizer::Impl {
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
+    if (!context_graph_) {
       auto stream = std::make_unique<Stream>(config_.feat_config);
       stream->SetResult(decoder_->GetEmptyResult());
       stream->SetStates(model_->GetEncoderInitStates());
@@ -146,16 +147,14 @@ class Recognizer::Impl {
     } else {
       auto r = decoder_->GetEmptyResult();
 
-      auto context_graph =
-          std::make_shared<ContextGraph>(hotwords_, config_.hotwords_score);
-
+      // The graph is read-only after construction, so all streams share it
       auto stream =
-          std::make_unique<Stream>(config_.feat_config, context_graph);
+          std::make_unique<Stream>(config_.feat_config, context_graph_);
 
       if (stream->GetContextGraph()) {
         // r.hyps has only one element.
         for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
+          it->context_state = stream->GetContextGraph()->Root();
         }
       }
 
@@ -179,7 +178,10 @@ class Recognizer::Impl {
     std::vector<ncnn::Mat> states = s->GetStates();
 
     ncnn::Mat encoder_out;
-    std::tie(encoder_out, states) = model_->RunEncoder(features, states);
+    {
+      SHERPA_NCNN_TIME_NET("asr.encoder");
+      std::tie(encoder_out, states) = model_->RunEncoder(features, states);
+    }
 
     if (s->GetContextGraph()) {
       decoder_->Decode(encoder_out, s, &s->GetResult());
@@ -189,6 +191,45 @@ class Recognizer::Impl {
     s->SetStates(states);
   }
 
+  void DecodeStreams(Stream **ss, int32_t n) const {
+    // Contextual biasing keeps a per-stream graph; decode those one by one
+    bool has_context_graph = false;
+    for (int32_t i = 0; i != n; ++i) {
+      if (ss[i]->GetContextGraph()) {
+        has_context_graph = true;
+      }
+    }
+    if (n == 1 || has_context_graph) {
+      for (int32_t i = 0; i != n; ++i) {
+        DecodeStream(ss[i]);
+      }
+      return;
+    }
+
+    int32_t segment = model_->Segment();
+    int32_t offset = model_->Offset();
+
+    // The exported encoders have batch size 1, so each stream still runs
+    // its own encoder forward; the joiner and decoder steps are batched.
+    std::vector<ncnn::Mat> encoder_out(n);
+    std::vector<DecoderResult *> results(n);
+    for (int32_t i = 0; i != n; ++i) {
+      Stream *s = ss[i];
+      ncnn::Mat features = s->GetFrames(s->GetNumProcessedFrames(), segment);
+      s->GetNumProcessedFrames() += offset;
+      std::vector<ncnn::Mat> states = s->GetStates();
+
+      {
+        SHERPA_NCNN_TIME_NET("asr.encoder");
+        std::tie(encoder_out[i], states) = model_->RunEncoder(features, states);
+      }
+      s->SetStates(states);
+      results[i] = &s->GetResult();
+    }
+
+    decoder_->DecodeBatch(encoder_out, results);
+  }
+
   bool IsEndpoint(Stream *s) const {
     if (!config_.enable_endpoint) return false;
     int32_t num_processed_frames = s->GetNumProcessedFrames();
@@ -208,13 +249,15 @@ class Recognizer::Impl {
 
     if (s->GetContextGraph()) {
       for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-        it->second.context_state = s->GetContextGraph()->Root();
+        it->context_state = s->GetContextGraph()->Root();
       }
     }
     // Caution: We need to keep the decoder output state
     ncnn::Mat decoder_out = s->GetResult().decoder_out;
+    ncnn::Mat decoder_proj = s->GetResult().decoder_proj;
     s->SetResult(r);
     s->GetResult().decoder_out = decoder_out;
+    s->GetResult().decoder_proj = decoder_proj;
 
     // don't reset encoder state
     // s->SetStates(model_->GetEncoderInitStates());
@@ -239,6 +282,13 @@ class Recognizer::Impl {
     return Convert(decoder_result, sym_, frame_shift_ms, subsampling_factor);
   }
 
+  void SetNumThreads(int32_t num_threads) {
+    // Each Run*() creates a new extractor, which copies net.opt
+    model_->GetEncoder().opt.num_threads = num_threads;
+    model_->GetDecoder().opt.num_threads = num_threads;
+    model_->GetJoiner().opt.num_threads = num_threads;
+  }
+
   const Model *GetModel() const { return model_.get(); }
 
  private:
@@ -274,39 +324,14 @@ class Recognizer::Impl {
   }
 
   void InitHotwords(std::istream &is) {
-    std::vector<int32_t> tmp;
-    std::string line;
-    std::string word;
     // The format of each line in hotwords_file looks like:
     // ▁HE LL O ▁WORLD :1.5
     // the first several items are tokens of the hotword, the item starts with
     // ":" is the customize boosting score for this hotword, if there is no
     // customize score it will use the score from configuration (i.e.
     // config_.hotwords_score).
-    while (std::getline(is, line)) {
-      std::istringstream iss(line);
-      float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
-                              // the global one.
-      while (iss >> word) {
-        if (sym_.contains(word)) {
-          int32_t number = sym_[word];
-          tmp.push_back(number);
-        } else {
-          if (word[0] == ':') {
-            tmp_score = std::stof(word.substr(1));
-          } else {
-            NCNN_LOGE(
-                "Cannot find ID for hotword %s at line: %s. (Hint: words on "
-                "the "
-                "same line are separated by spaces)",
-                word.c_str(), line.c_str());
-            exit(-1);
-          }
-        }
-      }
-      hotwords_.push_back(std::move(tmp));
-      boost_scores_.push_back(tmp_score);
-    }
+    context_graph_ =
+        ContextGraph::FromHotwords(is, sym_, config_.hotwords_score);
   }
 
  private:
@@ -315,8 +340,7 @@ class Recognizer::Impl {
   std::unique_ptr<Decoder> decoder_;
   Endpoint endpoint_;
   SymbolTable sym_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+  ContextGraphPtr context_graph_;
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -337,6 +361,10 @@ bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
 
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  impl_->DecodeStreams(ss, n);
+}
+
 bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
 
 void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
@@ -345,6 +373,10 @@ RecognitionResult Recognizer::GetResult(Stream *s) const {
   return impl_->GetResult(s);
 }
 
+void Recognizer::SetNumThreads(int32_t num_threads) {
+  impl_->SetNumThreads(num_threads);
+}
+
 const Model *Recognizer::GetModel() const { return impl_->GetModel(); }
 
 }  // namespace sherpa_ncnn
@@ -100,6 +100,17 @@ class Recognizer {
 
   void DecodeStream(Stream *s) const;
 
+  /**
+   * Decode one chunk of each of the given streams in a single call.
+   *
+   * Every stream must be ready, i.e., IsReady(ss[i]) returns true. The
+   * joiner and decoder run on all streams at once for greedy search; other
+   * decoding methods and streams with hotwords fall back to decoding the
+   * streams one by one. The result is the same as calling DecodeStream()
+   * on each stream.
+   */
+  void DecodeStreams(Stream **ss, int32_t n) const;
+
   // Return true if we detect an endpoint for this stream.
   // Note: If this function returns true, you usually want to
   // invoke Reset(s).
@@ -111,6 +122,11 @@ class Recognizer {
 
   RecognitionResult GetResult(Stream *s) const;
 
+  // Change the number of threads used by the encoder, decoder and joiner.
+  // It takes effect from the next call to DecodeStream(). It must not be
+  // called while another thread is decoding.
+  void SetNumThreads(int32_t num_threads);
+
   // Return the contained model
   //
   // The user should not free it.
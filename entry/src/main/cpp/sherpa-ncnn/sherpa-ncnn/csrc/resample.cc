@@ -28,9 +28,15 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <type_traits>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_NCNN_HAVE_NEON 1
+#endif
+
 #ifndef M_2PI
 #define M_2PI 6.283185307179586476925286766559005
 #endif
@@ -73,13 +79,70 @@ I Lcm(I m, I n) {
   return gcd * (m / gcd) * (n / gcd);
 }
 
+#if SHERPA_NCNN_HAVE_NEON
+static inline float HorizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_f32(v);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+#endif
+
+// n is a multiple of 4
 static float DotProduct(const float *a, const float *b, int32_t n) {
+#if SHERPA_NCNN_HAVE_NEON
+  float32x4_t sum0 = vdupq_n_f32(0);
+  float32x4_t sum1 = vdupq_n_f32(0);
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  if (i < n) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+  return HorizontalSum(vaddq_f32(sum0, sum1));
+#else
   float sum = 0;
   for (int32_t i = 0; i != n; ++i) {
     sum += a[i] * b[i];
   }
   return sum;
+#endif
+}
+
+#if SHERPA_NCNN_HAVE_NEON
+// Compute 4 consecutive outputs of 2:1 decimation. Output k is the dot
+// product of w with x[2k:]. vld2q splits 8 inputs into even and odd ones,
+// which are the inputs of tap j and j + 1 for all 4 outputs.
+//
+// n is a multiple of 2
+static inline float32x4_t Decimate2x4(const float *x, const float *w,
+                                      int32_t n) {
+  float32x4_t sum = vdupq_n_f32(0);
+  for (int32_t j = 0; j < n; j += 2) {
+    float32x4x2_t v = vld2q_f32(x + j);
+    sum = vmlaq_n_f32(sum, v.val[0], w[j]);
+    sum = vmlaq_n_f32(sum, v.val[1], w[j + 1]);
+  }
+  return sum;
+}
+
+// The same for 3:1 decimation. n is a multiple of 3
+static inline float32x4_t Decimate3x4(const float *x, const float *w,
+                                      int32_t n) {
+  float32x4_t sum = vdupq_n_f32(0);
+  for (int32_t j = 0; j < n; j += 3) {
+    float32x4x3_t v = vld3q_f32(x + j);
+    sum = vmlaq_n_f32(sum, v.val[0], w[j]);
+    sum = vmlaq_n_f32(sum, v.val[1], w[j + 1]);
+    sum = vmlaq_n_f32(sum, v.val[2], w[j + 2]);
+  }
+  return sum;
 }
+#endif
 
 LinearResample::LinearResample(int32_t samp_rate_in_hz,
                                int32_t samp_rate_out_hz, float filter_cutoff_hz,
@@ -104,7 +167,8 @@ LinearResample::LinearResample(int32_t samp_rate_in_hz,
 
 void LinearResample::SetIndexesAndWeights() {
   first_index_.resize(output_samples_in_unit_);
-  weights_.resize(output_samples_in_unit_);
+  num_weights_.resize(output_samples_in_unit_);
+  std::vector<std::vector<float>> weights(output_samples_in_unit_);
 
   double window_width = num_zeros_ / (2.0 * filter_cutoff_);
 
@@ -122,15 +186,30 @@ void LinearResample::SetIndexesAndWeights() {
             max_input_index = floor(max_t * samp_rate_in_),
             num_indices = max_input_index - min_input_index + 1;
     first_index_[i] = min_input_index;
-    weights_[i].resize(num_indices);
+    num_weights_[i] = num_indices;
+    weights[i].resize(num_indices);
     for (int32_t j = 0; j < num_indices; j++) {
       int32_t input_index = min_input_index + j;
       double input_t = input_index / static_cast<double>(samp_rate_in_),
              delta_t = input_t - output_t;
       // sign of delta_t doesn't matter.
-      weights_[i][j] = FilterFunc(delta_t) / samp_rate_in_;
+      weights[i][j] = FilterFunc(delta_t) / samp_rate_in_;
     }
   }
+
+  // Pad all rows to the same multiple of 4. 3:1 decimation reads the
+  // taps 3 at a time, so it needs a multiple of 12.
+  int32_t align =
+      (output_samples_in_unit_ == 1 && input_samples_in_unit_ == 3) ? 12 : 4;
+  int32_t max_num_weights =
+      *std::max_element(num_weights_.begin(), num_weights_.end());
+  num_taps_ = (max_num_weights + align - 1) / align * align;
+
+  weights_.assign(output_samples_in_unit_ * num_taps_, 0);
+  for (int32_t i = 0; i < output_samples_in_unit_; i++) {
+    std::copy(weights[i].begin(), weights[i].end(),
+              weights_.begin() + i * num_taps_);
+  }
 }
 
 /** Here, t is a time in seconds representing an offset from
@@ -161,52 +240,67 @@ void LinearResample::Reset() {
 
 void LinearResample::Resample(const float *input, int32_t input_dim, bool flush,
                               std::vector<float> *output) {
+  output->resize(NumOutputSamples(input_dim, flush));
+  Resample(input, input_dim, flush, output->data());
+}
+
+int32_t LinearResample::NumOutputSamples(int32_t input_dim, bool flush) const {
+  int64_t tot_input_samp = input_sample_offset_ + input_dim;
+  return static_cast<int32_t>(GetNumOutputSamples(tot_input_samp, flush) -
+                              output_sample_offset_);
+}
+
+int32_t LinearResample::Resample(const float *input, int32_t input_dim,
+                                 bool flush, float *output) {
   int64_t tot_input_samp = input_sample_offset_ + input_dim,
           tot_output_samp = GetNumOutputSamples(tot_input_samp, flush);
 
   assert(tot_output_samp >= output_sample_offset_);
+  int32_t num_output =
+      static_cast<int32_t>(tot_output_samp - output_sample_offset_);
+
+  if (output_samples_in_unit_ == 1) {
+    switch (input_samples_in_unit_) {
+      case 2:
+        Decimate<2>(input, input_dim, flush, tot_output_samp, output);
+        break;
+      case 3:
+        Decimate<3>(input, input_dim, flush, tot_output_samp, output);
+        break;
+      default:
+        Decimate<0>(input, input_dim, flush, tot_output_samp, output);
+        break;
+    }
+  } else {
+    // samp_out is the index into the total output signal, not just the part
+    // of it we are producing here. Instead of dividing samp_out by the unit
+    // size for each sample, we step through the phases of the filter bank
+    // and advance unit_start by one unit of input each time they wrap
+    // around.
+    int64_t unit_index = output_sample_offset_ / output_samples_in_unit_;
+    int32_t phase = static_cast<int32_t>(output_sample_offset_ -
+                                         unit_index * output_samples_in_unit_);
+    int64_t unit_start =
+        unit_index * input_samples_in_unit_ - input_sample_offset_;
+
+    for (int32_t i = 0; i != num_output; ++i) {
+      // first_input_index is the first index into "input" that we have a
+      // weight for.
+      int32_t first_input_index =
+          static_cast<int32_t>(unit_start + first_index_[phase]);
+      if (first_input_index >= 0 && first_input_index + num_taps_ <= input_dim) {
+        output[i] = DotProduct(input + first_input_index,
+                               weights_.data() + phase * num_taps_, num_taps_);
+      } else {
+        output[i] =
+            ResampleEdge(input, input_dim, flush, phase, first_input_index);
+      }
 
-  output->resize(tot_output_samp - output_sample_offset_);
-
-  // samp_out is the index into the total output signal, not just the part
-  // of it we are producing here.
-  for (int64_t samp_out = output_sample_offset_; samp_out < tot_output_samp;
-       samp_out++) {
-    int64_t first_samp_in;
-    int32_t samp_out_wrapped;
-    GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const std::vector<float> &weights = weights_[samp_out_wrapped];
-    // first_input_index is the first index into "input" that we have a weight
-    // for.
-    int32_t first_input_index =
-        static_cast<int32_t>(first_samp_in - input_sample_offset_);
-    float this_output;
-    if (first_input_index >= 0 &&
-        first_input_index + static_cast<int32_t>(weights.size()) <= input_dim) {
-      this_output =
-          DotProduct(input + first_input_index, weights.data(), weights.size());
-    } else {  // Handle edge cases.
-      this_output = 0.0;
-      for (int32_t i = 0; i < static_cast<int32_t>(weights.size()); i++) {
-        float weight = weights[i];
-        int32_t input_index = first_input_index + i;
-        if (input_index < 0 &&
-            static_cast<int32_t>(input_remainder_.size()) + input_index >= 0) {
-          this_output +=
-              weight * input_remainder_[input_remainder_.size() + input_index];
-        } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input[input_index];
-        } else if (input_index >= input_dim) {
-          // We're past the end of the input and are adding zero; should only
-          // happen if the user specified flush == true, or else we would not
-          // be trying to output this sample.
-          assert(flush);
-        }
+      if (++phase == output_samples_in_unit_) {
+        phase = 0;
+        unit_start += input_samples_in_unit_;
       }
     }
-    int32_t output_index =
-        static_cast<int32_t>(samp_out - output_sample_offset_);
-    (*output)[output_index] = this_output;
   }
 
   if (flush) {
@@ -216,6 +310,74 @@ void LinearResample::Resample(const float *input, int32_t input_dim, bool flush,
     input_sample_offset_ = tot_input_samp;
     output_sample_offset_ = tot_output_samp;
   }
+
+  return num_output;
+}
+
+template <int32_t kStride>
+void LinearResample::Decimate(const float *input, int32_t input_dim,
+                              bool flush, int64_t tot_output_samp,
+                              float *output) const {
+  const int32_t stride = kStride != 0 ? kStride : input_samples_in_unit_;
+  const float *weights = weights_.data();
+  int32_t num_output =
+      static_cast<int32_t>(tot_output_samp - output_sample_offset_);
+
+  int64_t first = first_index_[0] + output_sample_offset_ * stride -
+                  input_sample_offset_;
+  int32_t i = 0;
+
+#if SHERPA_NCNN_HAVE_NEON
+  if (kStride == 2 || kStride == 3) {
+    for (; i < num_output && first < 0; ++i, first += stride) {
+      output[i] = ResampleEdge(input, input_dim, flush, 0,
+                               static_cast<int32_t>(first));
+    }
+
+    // 4 outputs at a time while all of their inputs are in "input"
+    for (; i + 4 <= num_output && first + 3 * stride + num_taps_ <= input_dim;
+         i += 4, first += 4 * stride) {
+      float32x4_t y = kStride == 2
+                          ? Decimate2x4(input + first, weights, num_taps_)
+                          : Decimate3x4(input + first, weights, num_taps_);
+      vst1q_f32(output + i, y);
+    }
+  }
+#endif
+
+  for (; i < num_output; ++i, first += stride) {
+    int32_t first_input_index = static_cast<int32_t>(first);
+    if (first_input_index >= 0 && first_input_index + num_taps_ <= input_dim) {
+      output[i] = DotProduct(input + first_input_index, weights, num_taps_);
+    } else {
+      output[i] = ResampleEdge(input, input_dim, flush, 0, first_input_index);
+    }
+  }
+}
+
+float LinearResample::ResampleEdge(const float *input, int32_t input_dim,
+                                   bool flush, int32_t phase,
+                                   int32_t first_input_index) const {
+  const float *weights = weights_.data() + phase * num_taps_;
+  int32_t num_weights = num_weights_[phase];
+  int32_t remainder_dim = static_cast<int32_t>(input_remainder_.size());
+
+  float this_output = 0.0;
+  for (int32_t i = 0; i < num_weights; i++) {
+    float weight = weights[i];
+    int32_t input_index = first_input_index + i;
+    if (input_index < 0 && remainder_dim + input_index >= 0) {
+      this_output += weight * input_remainder_[remainder_dim + input_index];
+    } else if (input_index >= 0 && input_index < input_dim) {
+      this_output += weight * input[input_index];
+    } else if (input_index >= input_dim) {
+      // We're past the end of the input and are adding zero; should only
+      // happen if the user specified flush == true, or else we would not
+      // be trying to output this sample.
+      assert(flush);
+    }
+  }
+  return this_output;
 }
 
 int64_t LinearResample::GetNumOutputSamples(int64_t input_num_samp,
@@ -265,22 +427,7 @@ int64_t LinearResample::GetNumOutputSamples(int64_t input_num_samp,
   return num_output_samp;
 }
 
-// inline
-void LinearResample::GetIndexes(int64_t samp_out, int64_t *first_samp_in,
-                                int32_t *samp_out_wrapped) const {
-  // A unit is the smallest nonzero amount of time that is an exact
-  // multiple of the input and output sample periods.  The unit index
-  // is the answer to "which numbered unit we are in".
-  int64_t unit_index = samp_out / output_samples_in_unit_;
-  // samp_out_wrapped is equal to samp_out % output_samples_in_unit_
-  *samp_out_wrapped =
-      static_cast<int32_t>(samp_out - unit_index * output_samples_in_unit_);
-  *first_samp_in =
-      first_index_[*samp_out_wrapped] + unit_index * input_samples_in_unit_;
-}
-
 void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
-  std::vector<float> old_remainder(input_remainder_);
   // max_remainder_needed is the width of the filter from side to side,
   // measured in input samples.  you might think it should be half that,
   // but you have to consider that you might be wanting to output samples
@@ -288,21 +435,22 @@ void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
   // input... anyway, storing more remainder than needed is not harmful.
   int32_t max_remainder_needed =
       ceil(samp_rate_in_ * num_zeros_ / filter_cutoff_);
-  input_remainder_.resize(max_remainder_needed);
-  for (int32_t index = -static_cast<int32_t>(input_remainder_.size());
-       index < 0; index++) {
-    // we interpret "index" as an offset from the end of "input" and
-    // from the end of input_remainder_.
-    int32_t input_index = index + input_dim;
-    if (input_index >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          input[input_index];
-    } else if (input_index + static_cast<int32_t>(old_remainder.size()) >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          old_remainder[input_index +
-                        static_cast<int32_t>(old_remainder.size())];
-      // else leave it at zero.
-    }
+
+  // After Reset() there is no remainder; the signal before the first
+  // input is taken as zeros.
+  if (static_cast<int32_t>(input_remainder_.size()) != max_remainder_needed) {
+    input_remainder_.assign(max_remainder_needed, 0);
+  }
+
+  // Keep the last max_remainder_needed samples of remainder + input,
+  // shifting in place instead of copying the old remainder
+  if (input_dim >= max_remainder_needed) {
+    std::copy(input + input_dim - max_remainder_needed, input + input_dim,
+              input_remainder_.begin());
+  } else {
+    std::copy(input_remainder_.begin() + input_dim, input_remainder_.end(),
+              input_remainder_.begin());
+    std::copy(input, input + input_dim, input_remainder_.end() - input_dim);
   }
 }
 
@@ -73,6 +73,18 @@ class LinearResample {
   void Resample(const float *input, int32_t input_dim, bool flush,
                 std::vector<float> *output);
 
+  /// Like the above, but writes the result into a caller-provided buffer,
+  /// which must have room for NumOutputSamples(input_dim, flush) samples.
+  /// Reusing one buffer across calls avoids an allocation per call.
+  ///
+  /// @return Return the number of samples written to output.
+  int32_t Resample(const float *input, int32_t input_dim, bool flush,
+                   float *output);
+
+  /// Return the number of samples that the next call of
+  /// Resample(input, input_dim, flush, ...) will output.
+  int32_t NumOutputSamples(int32_t input_dim, bool flush) const;
+
   //// Return the input and output sampling rates (for checks, for example)
   int32_t GetInputSamplingRate() const { return samp_rate_in_; }
   int32_t GetOutputSamplingRate() const { return samp_rate_out_; }
@@ -92,15 +104,20 @@ class LinearResample {
   /// [ 0, input_num_samp/samp_rate_in_ - window_width ).
   int64_t GetNumOutputSamples(int64_t input_num_samp, bool flush) const;
 
-  /// Given an output-sample index, this function outputs to *first_samp_in the
-  /// first input-sample index that we have a weight on (may be negative),
-  /// and to *samp_out_wrapped the index into weights_ where we can get the
-  /// corresponding weights on the input.
-  inline void GetIndexes(int64_t samp_out, int64_t *first_samp_in,
-                         int32_t *samp_out_wrapped) const;
-
   void SetRemainder(const float *input, int32_t input_dim);
 
+  /// Compute the output sample samp_out when some of its input samples are
+  /// in input_remainder_ or past the end of the input.
+  float ResampleEdge(const float *input, int32_t input_dim, bool flush,
+                     int32_t phase, int32_t first_input_index) const;
+
+  /// Integer decimation, i.e., output_samples_in_unit_ == 1. There is only
+  /// one filter and the input advances by a fixed stride per output
+  /// sample. kStride is the stride if it is known at compile time, or 0.
+  template <int32_t kStride>
+  void Decimate(const float *input, int32_t input_dim, bool flush,
+                int64_t tot_output_samp, float *output) const;
+
  private:
   // The following variables are provided by the user.
   int32_t samp_rate_in_;
@@ -124,8 +141,15 @@ class LinearResample {
   /// extrapolate the correct input-sample index for arbitrary output samples.
   std::vector<int32_t> first_index_;
 
-  /// Weights on the input samples, for this output-sample index.
-  std::vector<std::vector<float>> weights_;
+  /// The polyphase filter bank. Row i, starting at weights_[i * num_taps_],
+  /// holds the weights on the input samples for output-sample index i.
+  /// Rows are zero-padded to num_taps_, a multiple of 4, so that every
+  /// row can be evaluated with the same SIMD loop.
+  std::vector<float> weights_;
+  int32_t num_taps_ = 0;
+
+  /// The number of nonzero (unpadded) weights in each row.
+  std::vector<int32_t> num_weights_;
 
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
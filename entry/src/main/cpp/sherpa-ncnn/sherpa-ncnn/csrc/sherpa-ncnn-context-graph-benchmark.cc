@@ -0,0 +1,100 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/context-graph.h"
+
+// Hotwords drawn from a BPE-sized vocabulary, as for a product catalog,
+// queried with token sequences that partially follow the hotwords
+static void BenchmarkForwardOneStep(int32_t num_queries) {
+  std::mt19937 mt(0);
+  const int32_t vocab_size = 500;
+  std::uniform_int_distribution<int32_t> token_dist(1, vocab_size - 1);
+  std::uniform_int_distribution<int32_t> len_dist(2, 6);
+  std::uniform_real_distribution<float> coin(0, 1);
+
+  for (int32_t num = 1000; num <= 20000; num *= 4) {
+    std::vector<std::vector<int32_t>> contexts;
+    for (int32_t i = 0; i < num; ++i) {
+      std::vector<int32_t> tmp;
+      int32_t word_len = len_dist(mt);
+      for (int32_t j = 0; j < word_len; ++j) {
+        tmp.push_back(token_dist(mt));
+      }
+      contexts.push_back(std::move(tmp));
+    }
+    auto context_graph = sherpa_ncnn::ContextGraph(contexts, 1.5);
+
+    std::vector<int32_t> queries;
+    queries.reserve(num_queries);
+    while (queries.size() < num_queries) {
+      if (coin(mt) < 0.3) {
+        const auto &c = contexts[mt() % contexts.size()];
+        queries.insert(queries.end(), c.begin(), c.end());
+      } else {
+        queries.push_back(token_dist(mt));
+      }
+    }
+
+    float total_score = 0;
+    auto state = context_graph.Root();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto q : queries) {
+      auto res = context_graph.ForwardOneStep(state, q, false);
+      total_score += std::get<0>(res);
+      state = std::get<1>(res);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+    fprintf(stderr,
+            "%d hotwords, %d states: %.1f ns per ForwardOneStep (score %.1f)\n",
+            num, context_graph.NumStates(),
+            duration.count() * 1000.0 / queries.size(), total_score);
+  }
+}
+
+int main(int32_t argc, char *argv[]) {
+  const char *usage = R"usage(
+Report the cost of ContextGraph::ForwardOneStep, the per-token hotword
+lookup done by modified beam search, for 1000, 4000 and 16000 hotwords.
+
+Usage:
+
+  ./bin/sherpa-ncnn-context-graph-benchmark [num_queries]
+
+num_queries defaults to 2000000 tokens per graph size.
+)usage";
+
+  if (argc > 2) {
+    fprintf(stderr, "%s\n", usage);
+    return -1;
+  }
+
+  int32_t num_queries = argc > 1 ? atoi(argv[1]) : 2000000;
+  if (num_queries <= 0) {
+    fprintf(stderr, "%s\n", usage);
+    return -1;
+  }
+
+  BenchmarkForwardOneStep(num_queries);
+  return 0;
+}
@@ -44,6 +44,7 @@ or details.
   sherpa_ncnn::ParseOptions po(kUsageMessage);
   std::string output_filename = "./generated.wav";
   int32_t sid = 0;
+  int64_t seed = -1;
 
   po.Register("output-filename", &output_filename,
               "Path to save the generated audio");
@@ -53,6 +54,11 @@ or details.
               "trained using the VCTK dataset. Not used for single-speaker "
               "models, e.g., models trained using the LJSpeech dataset");
 
+  po.Register("seed", &seed,
+              "Seed of the random noise. If non-negative, the same text "
+              "always produces the same audio, which makes runs comparable. "
+              "If negative, a random seed is used");
+
   sherpa_ncnn::OfflineTtsConfig config;
 
   config.Register(&po);
@@ -88,6 +94,7 @@ or details.
   args.text = po.GetArg(1);
   args.sid = sid;
   args.speed = 1.0;
+  args.seed = seed;
   auto audio = tts.Generate(args, AudioCallback);
   const auto end = std::chrono::steady_clock::now();
 
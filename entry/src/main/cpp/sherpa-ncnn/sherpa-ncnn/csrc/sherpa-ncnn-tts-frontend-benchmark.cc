@@ -0,0 +1,198 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/lexicon.h"
+#include "sherpa-ncnn/csrc/offline-tts-vits-model-meta-data.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+static double Now() {
+  using Clock = std::chrono::steady_clock;
+  return std::chrono::duration<double>(Clock::now().time_since_epoch())
+      .count();
+}
+
+// Number of code points of a UTF-8 string, i.e., its bytes that are not
+// continuation bytes
+static int32_t NumChars(const std::string &text) {
+  return static_cast<int32_t>(
+      std::count_if(text.begin(), text.end(),
+                    [](char c) { return (c & 0xc0) != 0x80; }));
+}
+
+// The front end of OfflineTtsVitsImpl before it used
+// Lexicon::ConvertTextToTokenIdsChinese(): one std::regex per punctuation
+// mark and one string per candidate word
+static std::vector<std::vector<int32_t>> ReferenceConvert(
+    const sherpa_ncnn::Lexicon &lexicon,
+    const std::unordered_map<std::string, int32_t> &token2id,
+    const std::string &input) {
+  std::string text = input;
+
+  static const std::unordered_map<std::string, std::string> punct_map = {
+      {"，", ","}, {"。", "."}, {"！", "!"}, {"？", "?"},
+      {"：", ":"}, {"；", ";"}, {"（", "("}, {"）", ")"},
+      {"【", "["}, {"】", "]"}, {"“", "\""}, {"”", "\""},
+      {"‘", "'"},  {"’", "'"},  {"《", "<"}, {"》", ">"}};
+
+  for (const auto &kv : punct_map) {
+    text = std::regex_replace(text, std::regex(kv.first), kv.second);
+  }
+
+  std::vector<std::string> words = sherpa_ncnn::SplitUtf8(text);
+
+  std::vector<std::vector<int32_t>> ans;
+  std::vector<int32_t> this_sentence;
+  std::vector<int32_t> token_ids;
+
+  int32_t num_words = static_cast<int32_t>(words.size());
+  int32_t max_len = 10;
+  int32_t space = token2id.at(" ");
+
+  for (int32_t i = 0; i < num_words;) {
+    int32_t start = i;
+    int32_t end = std::min(i + max_len, num_words - 1);
+
+    std::string w;
+    while (end > start) {
+      std::string this_word;
+      for (int32_t k = start; k <= end; ++k) {
+        this_word += words[k];
+      }
+
+      if (lexicon.Contains(this_word)) {
+        i = end + 1;
+        w = std::move(this_word);
+        break;
+      }
+
+      end -= 1;
+    }
+
+    if (w.empty()) {
+      w = words[i];
+      i += 1;
+    }
+
+    lexicon.TokenizeWord(w, &token_ids);
+
+    if (!token_ids.empty()) {
+      this_sentence.insert(this_sentence.end(), token_ids.begin(),
+                           token_ids.end());
+    } else if (token2id.count(w)) {
+      this_sentence.push_back(token2id.at(w));
+      if (w == ",") {
+        this_sentence.push_back(space);
+      }
+
+      if (w == "," || w == "." || w == "?" || w == "!" || w == ";") {
+        ans.push_back(std::move(this_sentence));
+      }
+    }
+  }
+
+  if (!this_sentence.empty()) {
+    ans.emplace_back(std::move(this_sentence));
+  }
+
+  return ans;
+}
+
+int main(int32_t argc, char *argv[]) {
+  const char *usage = R"usage(
+Report the speed of the Chinese text front end of VITS models, i.e., the
+conversion of text to token IDs, and check it against the previous
+implementation.
+
+Usage:
+
+  ./bin/sherpa-ncnn-tts-frontend-benchmark /path/to/model-dir [foo.txt]
+
+model-dir must contain config.json and lexicon.txt of a Chinese model. If
+no text file is given, a built-in paragraph is used.
+)usage";
+
+  if (argc < 2) {
+    fprintf(stderr, "%s\n", usage);
+    return -1;
+  }
+
+  std::string model_dir = argv[1];
+  std::string text =
+      "在2025年，小米发布了新的手机和汽车。雷军说：“我们要做最好的产品！”"
+      "今天天气怎么样？我想去公园散步，然后回家做饭；你要一起来吗？"
+      "《红楼梦》是中国古典小说的巅峰之作，OK，我们明天见。";
+  if (argc > 2) {
+    std::ifstream is(argv[2]);
+    std::ostringstream os;
+    os << is.rdbuf();
+    text = os.str();
+  }
+
+  auto meta_data =
+      sherpa_ncnn::ReadFromConfigJson(model_dir + "/config.json");
+
+  double start = Now();
+  sherpa_ncnn::Lexicon lexicon(model_dir + "/lexicon.txt", meta_data.token2id);
+  double load_time = Now() - start;
+
+  int32_t num_chars = NumChars(text);
+
+  // Repeat until each implementation has run for at least 1 second
+  auto run = [&](auto convert, std::vector<std::vector<int32_t>> *ids) {
+    int32_t num_runs = 0;
+    double start = Now();
+    double elapsed = 0;
+    do {
+      *ids = convert();
+      ++num_runs;
+      elapsed = Now() - start;
+    } while (elapsed < 1);
+    return num_runs * num_chars / elapsed;
+  };
+
+  std::vector<std::vector<int32_t>> ids;
+  double speed = run(
+      [&]() { return lexicon.ConvertTextToTokenIdsChinese(text); }, &ids);
+
+  std::vector<std::vector<int32_t>> expected;
+  double reference_speed = run(
+      [&]() { return ReferenceConvert(lexicon, meta_data.token2id, text); },
+      &expected);
+
+  fprintf(stderr, "Lexicon loaded in %.3f s\n", load_time);
+  fprintf(stderr, "%d chars, %d sentences\n", num_chars,
+          static_cast<int32_t>(ids.size()));
+  fprintf(stderr, "front end: %.0f chars/s\n", speed);
+  fprintf(stderr, "reference: %.0f chars/s\n", reference_speed);
+
+  if (ids != expected) {
+    fprintf(stderr, "Mismatch with the reference!\n");
+    return -1;
+  }
+
+  return 0;
+}
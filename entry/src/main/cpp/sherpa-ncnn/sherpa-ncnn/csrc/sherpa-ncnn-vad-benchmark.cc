@@ -0,0 +1,154 @@
+/**
+ * See LICENSE for clarification regarding multiple authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/silero-vad-model.h"
+#include "sherpa-ncnn/csrc/voice-activity-detector.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+static double Now() {
+  using Clock = std::chrono::steady_clock;
+  return std::chrono::duration<double>(Clock::now().time_since_epoch())
+      .count();
+}
+
+// Alternate 2 seconds of a tone with 1 second of silence so that the
+// detector produces segments
+static std::vector<float> GenerateSamples(int32_t sample_rate,
+                                          float num_seconds) {
+  std::vector<float> samples(static_cast<int32_t>(sample_rate * num_seconds));
+  for (int32_t i = 0; i != static_cast<int32_t>(samples.size()); ++i) {
+    float t = static_cast<float>(i) / sample_rate;
+    if (std::fmod(t, 3.0f) < 2.0f) {
+      samples[i] = 0.3f * std::sin(2 * M_PI * 220 * t) *
+                   (0.6f + 0.4f * std::sin(2 * M_PI * 3 * t));
+    }
+  }
+  return samples;
+}
+
+int main(int32_t argc, char *argv[]) {
+  const char *usage = R"usage(
+Report the real-time factor (RTF) of silero vad.
+
+Usage:
+
+  ./bin/sherpa-ncnn-vad-benchmark [/path/to/foo.wav] [num_seconds]
+
+If no wave file is given, num_seconds (default 60) of synthetic audio is
+used. The model is read from ./sherpa-ncnn-silero-vad; see
+./bin/sherpa-ncnn-vad for how to download it.
+
+**Note**: We only support 16000Hz wav files.
+)usage";
+
+  sherpa_ncnn::SileroVadModelConfig config;
+  config.sample_rate = 16000;
+  config.model_dir = "./sherpa-ncnn-silero-vad";
+  config.window_size = 512;
+
+  if (!config.Validate()) {
+    fprintf(stderr, "%s\n", usage);
+    return -1;
+  }
+
+  std::vector<float> samples;
+  if (argc > 1 && sherpa_ncnn::FileExists(argv[1])) {
+    bool is_ok = false;
+    samples = sherpa_ncnn::ReadWave(argv[1], config.sample_rate, &is_ok);
+    if (!is_ok) {
+      fprintf(stderr, "Failed to read %s\n", argv[1]);
+      return -1;
+    }
+  } else {
+    float num_seconds = argc > 2 ? atof(argv[2]) : 60;
+    samples = GenerateSamples(config.sample_rate, num_seconds);
+  }
+
+  int32_t window_size = config.window_size;
+  int32_t num_windows = static_cast<int32_t>(samples.size()) / window_size;
+  float duration = static_cast<float>(samples.size()) / config.sample_rate;
+
+  sherpa_ncnn::SileroVadModel model(config);
+
+  // 1. One call per window with the state kept inside the model
+  double start = Now();
+  int32_t num_speech_windows = 0;
+  for (int32_t i = 0; i != num_windows; ++i) {
+    num_speech_windows +=
+        model.IsSpeech(samples.data() + i * window_size, window_size);
+  }
+  double per_window_time = Now() - start;
+
+  // 2. All pending windows in one call with an explicit state, as a
+  // stream that fell behind would do
+  const int32_t kWindowsPerCall = 16;
+  sherpa_ncnn::SileroVadState state = model.CreateState();
+  std::vector<char> is_speech(kWindowsPerCall);
+  start = Now();
+  int32_t num_speech_windows2 = 0;
+  for (int32_t i = 0; i < num_windows; i += kWindowsPerCall) {
+    int32_t k = std::min(kWindowsPerCall, num_windows - i);
+    model.IsSpeech(&state, samples.data() + i * window_size, k,
+                   reinterpret_cast<bool *>(is_speech.data()));
+    for (int32_t j = 0; j != k; ++j) {
+      num_speech_windows2 += is_speech[j];
+    }
+  }
+  double multi_window_time = Now() - start;
+
+  // 3. VoiceActivityDetector fed with 10 ms chunks
+  sherpa_ncnn::VoiceActivityDetector vad(config);
+  start = Now();
+  int32_t num_segments = 0;
+  for (int32_t i = 0; i < static_cast<int32_t>(samples.size()); i += 160) {
+    int32_t n = std::min<int32_t>(160, samples.size() - i);
+    vad.AcceptWaveform(samples.data() + i, n);
+    while (!vad.Empty()) {
+      ++num_segments;
+      vad.Pop();
+    }
+  }
+  vad.Flush();
+  while (!vad.Empty()) {
+    ++num_segments;
+    vad.Pop();
+  }
+  double detector_time = Now() - start;
+
+  fprintf(stderr, "Audio duration: %.3f s, %d windows\n", duration,
+          num_windows);
+  fprintf(stderr, "per-window calls:    RTF %.4f, %d speech windows\n",
+          per_window_time / duration, num_speech_windows);
+  fprintf(stderr, "multi-window calls:  RTF %.4f, %d speech windows\n",
+          multi_window_time / duration, num_speech_windows2);
+  fprintf(stderr, "VoiceActivityDetector: RTF %.4f, %d segments\n",
+          detector_time / duration, num_segments);
+
+  if (num_speech_windows != num_speech_windows2) {
+    fprintf(stderr, "Mismatch between per-window and multi-window calls!\n");
+    return -1;
+  }
+
+  return 0;
+}
@@ -18,6 +18,8 @@
 
 #include "sherpa-ncnn/csrc/silero-vad-model.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -73,14 +75,7 @@ class SileroVadModel::Impl {
   }
 #endif
 
-  void Reset() {
-    ResetV4();
-
-    triggered_ = false;
-    current_sample_ = 0;
-    temp_start_ = 0;
-    temp_end_ = 0;
-  }
+  void Reset() { Reset(&state_); }
 
   bool IsSpeech(const float *samples, int32_t n) {
     if (n != WindowSize()) {
@@ -88,70 +83,42 @@ class SileroVadModel::Impl {
       exit(-1);
     }
 
-    float prob = Run(samples, n);
-
-    float threshold = config_.threshold;
-
-    current_sample_ += config_.window_size;
-
-    if (prob > threshold && temp_end_ != 0) {
-      temp_end_ = 0;
-    }
-
-    if (prob > threshold && temp_start_ == 0) {
-      // start speaking, but we require that it must satisfy
-      // min_speech_duration
-      temp_start_ = current_sample_;
-      return false;
-    }
-
-    if (prob > threshold && temp_start_ != 0 && !triggered_) {
-      if (current_sample_ - temp_start_ < min_speech_samples_) {
-        return false;
-      }
-
-      triggered_ = true;
-
-      return true;
-    }
-
-    if ((prob < threshold) && !triggered_) {
-      // silence
-      temp_start_ = 0;
-      temp_end_ = 0;
-      return false;
-    }
-
-    if ((prob > threshold - 0.15) && triggered_) {
-      // speaking
-      return true;
-    }
+    return IsSpeech(&state_, samples, 1, nullptr);
+  }
 
-    if ((prob > threshold) && !triggered_) {
-      // start speaking
-      triggered_ = true;
+  SileroVadState CreateState() const {
+    SileroVadState state;
+    Reset(&state);
+    return state;
+  }
 
-      return true;
+  void Reset(SileroVadState *state) const {
+    for (int32_t i = 0; i != 2; ++i) {
+      state->h[i].create(64, 1, 2);
+      state->c[i].create(64, 1, 2);
+      state->h[i].fill(0);
+      state->c[i].fill(0);
     }
+    state->current = 0;
 
-    if ((prob < threshold) && triggered_) {
-      // stop to speak
-      if (temp_end_ == 0) {
-        temp_end_ = current_sample_;
-      }
+    state->triggered = false;
+    state->current_sample = 0;
+    state->temp_start = 0;
+    state->temp_end = 0;
+  }
 
-      if (current_sample_ - temp_end_ < min_silence_samples_) {
-        // continue speaking
-        return true;
+  bool IsSpeech(SileroVadState *state, const float *samples,
+                int32_t num_windows, bool *is_speech) {
+    bool ans = false;
+    for (int32_t i = 0; i != num_windows; ++i) {
+      float prob = Run(state, samples + i * WindowShift(), WindowSize());
+      bool b = Update(state, prob);
+      if (is_speech) {
+        is_speech[i] = b;
       }
-      // stopped speaking
-      temp_start_ = 0;
-      temp_end_ = 0;
-      triggered_ = false;
-      return false;
+      ans = ans || b;
     }
-
-    return false;
+    return ans;
   }
 
   int32_t WindowShift() const { return config_.window_size; }
@@ -197,36 +164,122 @@ class SileroVadModel::Impl {
       if (b.name == "out2") output_indexes_[2] = i;
     }
 
-    h_ = ncnn::Mat(64, 1, 2);
-    c_ = ncnn::Mat(64, 1, 2);
+    Reset(&state_);
+  }
+
+  // Apply the speech/silence hysteresis to the probability of the next
+  // window
+  bool Update(SileroVadState *state, float prob) const {
+    float threshold = config_.threshold;
+
+    state->current_sample += config_.window_size;
+
+    if (prob > threshold && state->temp_end != 0) {
+      state->temp_end = 0;
+    }
+
+    if (prob > threshold && state->temp_start == 0) {
+      // start speaking, but we require that it must satisfy
+      // min_speech_duration
+      state->temp_start = state->current_sample;
+      return false;
+    }
+
+    if (prob > threshold && state->temp_start != 0 && !state->triggered) {
+      if (state->current_sample - state->temp_start < min_speech_samples_) {
+        return false;
+      }
+
+      state->triggered = true;
+
+      return true;
+    }
+
+    if ((prob < threshold) && !state->triggered) {
+      // silence
+      state->temp_start = 0;
+      state->temp_end = 0;
+      return false;
+    }
+
+    if ((prob > threshold - 0.15) && state->triggered) {
+      // speaking
+      return true;
+    }
+
+    if ((prob > threshold) && !state->triggered) {
+      // start speaking
+      state->triggered = true;
+
+      return true;
+    }
+
+    if ((prob < threshold) && state->triggered) {
+      // stop to speak
+      if (state->temp_end == 0) {
+        state->temp_end = state->current_sample;
+      }
+
+      if (state->current_sample - state->temp_end < min_silence_samples_) {
+        // continue speaking
+        return true;
+      }
+      // stopped speaking
+      state->temp_start = 0;
+      state->temp_end = 0;
+      state->triggered = false;
+      return false;
+    }
 
-    h_.fill(0);
-    c_.fill(0);
+    return false;
   }
 
-  void ResetV4() {
-    h_.fill(0);
-    c_.fill(0);
+  // Copy src into *dst, reusing the memory of *dst when the shapes match
+  static void CopyState(const ncnn::Mat &src, ncnn::Mat *dst) {
+    if (dst->w != src.w || dst->h != src.h || dst->c != src.c ||
+        dst->elemsize != src.elemsize) {
+      dst->create_like(src);
+    }
+    memcpy(dst->data, src.data, src.total() * src.elemsize);
   }
 
-  float Run(const float *samples, int32_t n) {
+  float Run(SileroVadState *state, const float *samples, int32_t n) {
     // TODO(fangjun): Support V5
-    return RunV4(samples, n);
+    return RunV4(state, samples, n);
   }
 
-  float RunV4(const float *samples, int32_t n) {
-    ncnn::Mat x(n, 1, 1, const_cast<float *>(samples));
+  float RunV4(SileroVadState *state, const float *samples, int32_t n) {
+    // Reuse one input buffer. An external-data Mat has no refcount and
+    // would break in-place layers, so the samples are copied into it
+    if (x_.w != n) {
+      x_.create(n, 1, 1);
+    }
+    std::copy(samples, samples + n, static_cast<float *>(x_.data));
+    const ncnn::Mat &x = x_;
 
+    // Intermediate blobs come from pools that live as long as the model,
+    // so steady-state windows do not go through malloc
     ncnn::Extractor ex = model_.create_extractor();
+    ex.set_blob_allocator(&blob_pool_);
+    ex.set_workspace_allocator(&workspace_pool_);
 
     ex.input(input_indexes_[0], x);
-    ex.input(input_indexes_[1], h_);
-    ex.input(input_indexes_[2], c_);
+    int32_t current = state->current;
+    ex.input(input_indexes_[1], state->h[current]);
+    ex.input(input_indexes_[2], state->c[current]);
 
     ncnn::Mat out;
+    ncnn::Mat h;
+    ncnn::Mat c;
     ex.extract(output_indexes_[0], out);
-    ex.extract(output_indexes_[1], h_);
-    ex.extract(output_indexes_[2], c_);
+    ex.extract(output_indexes_[1], h);
+    ex.extract(output_indexes_[2], c);
+
+    // The state may outlive the pools, so it must not keep pooled memory.
+    // Copy the new states into the spare buffers of the state
+    CopyState(h, &state->h[1 - current]);
+    CopyState(c, &state->c[1 - current]);
+    state->current = 1 - current;
 
     float prob = out[0];
     return prob;
@@ -234,21 +287,19 @@ class SileroVadModel::Impl {
 
  private:
   ncnn::Net model_;
+  ncnn::PoolAllocator blob_pool_;
+  ncnn::PoolAllocator workspace_pool_;
+  ncnn::Mat x_;
   std::vector<int32_t> input_indexes_;
   std::vector<int32_t> output_indexes_;
 
-  ncnn::Mat h_;
-  ncnn::Mat c_;
-
   SileroVadModelConfig config_;
 
   int32_t min_silence_samples_;
   int32_t min_speech_samples_;
 
-  bool triggered_ = false;
-  int32_t current_sample_ = 0;
-  int32_t temp_start_ = 0;
-  int32_t temp_end_ = 0;
+  // Used by IsSpeech(samples, n), which keeps the state in the model
+  SileroVadState state_;
 };
 
 SileroVadModel::SileroVadModel(const SileroVadModelConfig &config)
@@ -268,6 +319,19 @@ bool SileroVadModel::IsSpeech(const float *samples, int32_t n) {
   return impl_->IsSpeech(samples, n);
 }
 
+SileroVadState SileroVadModel::CreateState() const {
+  return impl_->CreateState();
+}
+
+void SileroVadModel::Reset(SileroVadState *state) const {
+  impl_->Reset(state);
+}
+
+bool SileroVadModel::IsSpeech(SileroVadState *state, const float *samples,
+                              int32_t num_windows, bool *is_speech) {
+  return impl_->IsSpeech(state, samples, num_windows, is_speech);
+}
+
 int32_t SileroVadModel::WindowSize() const { return impl_->WindowSize(); }
 
 int32_t SileroVadModel::WindowShift() const { return impl_->WindowShift(); }
@@ -24,12 +24,31 @@
 #include "android/asset_manager_jni.h"
 #endif
 
+#include <cstdint>
 #include <memory>
 
+#include "mat.h"  // NOLINT
 #include "sherpa-ncnn/csrc/silero-vad-model-config.h"
 
 namespace sherpa_ncnn {
 
+// Per-stream state of the VAD: the LSTM states and the speech/silence
+// hysteresis. Keeping it outside of the model lets one loaded model
+// serve many streams.
+struct SileroVadState {
+  // The LSTM states are double-buffered: a window reads h[current] and
+  // c[current] and its outputs are copied into the other pair, so running
+  // a window does not allocate
+  ncnn::Mat h[2];
+  ncnn::Mat c[2];
+  int32_t current = 0;
+
+  bool triggered = false;
+  int64_t current_sample = 0;
+  int64_t temp_start = 0;
+  int64_t temp_end = 0;
+};
+
 class SileroVadModel {
  public:
   explicit SileroVadModel(const SileroVadModelConfig &config);
@@ -52,6 +71,25 @@ class SileroVadModel {
    */
   bool IsSpeech(const float *samples, int32_t n);
 
+  // Return a state for a new stream
+  SileroVadState CreateState() const;
+
+  void Reset(SileroVadState *state) const;
+
+  /** Classify num_windows consecutive windows of one stream.
+   *
+   * Window i has WindowSize() samples starting at samples + i *
+   * WindowShift(). The windows are run back to back with the recurrent
+   * state carried in *state. Each window is copied once into a buffer
+   * owned by the model before it is run.
+   *
+   * @param is_speech  If not null, an array of size num_windows that
+   *                   receives the decision for each window.
+   * @return Return true if any of the windows is speech.
+   */
+  bool IsSpeech(SileroVadState *state, const float *samples,
+                int32_t num_windows, bool *is_speech);
+
   // For silero vad V4, it is WindowShift().
   // For silero vad V5, it is WindowShift()+64 for 16kHz and
   //                          WindowShift()+32 for 8kHz
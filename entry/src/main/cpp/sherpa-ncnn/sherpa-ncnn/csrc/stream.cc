@@ -56,9 +56,9 @@ class Stream::Impl {
     if (!context_graph_) return;
     auto &cur = result_.hyps;
     for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
-      auto context_res = context_graph_->Finalize(iter->second.context_state);
-      iter->second.log_prob += context_res.first;
-      iter->second.context_state = context_res.second;
+      auto context_res = context_graph_->Finalize(iter->context_state);
+      iter->log_prob += context_res.first;
+      iter->context_state = context_res.second;
     }
     auto hyp = result_.hyps.GetMostProbable(true);
     result_.tokens = std::move(hyp.ys);
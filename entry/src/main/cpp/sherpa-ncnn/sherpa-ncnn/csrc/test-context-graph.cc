@@ -5,12 +5,17 @@
 #include <cassert>
 #include <chrono>  // NOLINT
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <map>
 #include <random>
+#include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
 
 static void TestHelper(const std::map<std::string, float> &queries, float score,
                        bool strict_mode) {
@@ -70,6 +75,41 @@ static void TestCustomizeNonStrict() {
   TestHelper(queries, 5, false);
 }
 
+static void TestFromHotwords() {
+  // Tokens are the letters A-Z with ids 0-25, as in TestHelper
+  const char *tokens_file = "./test-context-graph-tokens.txt";
+  {
+    std::ofstream os(tokens_file);
+    for (int32_t i = 0; i != 26; ++i) {
+      os << static_cast<char>('A' + i) << " " << i << "\n";
+    }
+  }
+  sherpa_ncnn::SymbolTable sym(tokens_file);
+  std::remove(tokens_file);
+
+  std::istringstream is("H E :2\nS H E\n\nH I S :3\n");
+  auto from_file = sherpa_ncnn::ContextGraph::FromHotwords(is, sym, 1);
+
+  std::vector<std::vector<int32_t>> contexts = {
+      {'H' - 'A', 'E' - 'A'},
+      {'S' - 'A', 'H' - 'A', 'E' - 'A'},
+      {'H' - 'A', 'I' - 'A', 'S' - 'A'}};
+  auto expected = sherpa_ncnn::ContextGraph(contexts, 1, {2, 0, 3});
+  assert(from_file->NumStates() == expected.NumStates());
+
+  std::string query = "SHISHEHE";
+  auto state = from_file->Root();
+  auto expected_state = expected.Root();
+  for (char c : query) {
+    auto res = from_file->ForwardOneStep(state, c - 'A');
+    auto expected_res = expected.ForwardOneStep(expected_state, c - 'A');
+    assert(std::get<0>(res) == std::get<0>(expected_res));
+    assert(std::get<1>(res)->id == std::get<1>(expected_res)->id);
+    state = std::get<1>(res);
+    expected_state = std::get<1>(expected_res);
+  }
+}
+
 static void Benchmark() {
   std::random_device rd;
   std::mt19937 mt(rd());
@@ -100,6 +140,7 @@ int32_t main() {
   TestBasicNonStrict();
   TestCustomize();
   TestCustomizeNonStrict();
+  TestFromHotwords();
   Benchmark();
   return 0;
 }
@@ -0,0 +1,145 @@
+// sherpa-ncnn/csrc/test-joiner-projection.cc
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+
+// A joiner with the same structure as the exported transducer joiners:
+// encoder_dim = 6, decoder_dim = 5, joiner_dim = 4, vocab_size = 10
+static const char *kJoinerParam = R"(7767517
+7 7
+Input in0 0 1 in0
+Input in1 0 1 in1
+InnerProduct encoder_proj 1 1 in0 e 0=4 1=1 2=24
+InnerProduct decoder_proj 1 1 in1 d 0=4 1=1 2=20
+BinaryOp add 2 1 e d s 0=0
+TanH tanh 1 1 s t
+InnerProduct output_linear 1 1 t out0 0=10 1=1 2=40
+)";
+
+static std::vector<float> RandomWeights(std::mt19937 *mt) {
+  std::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<float> w;
+  // Each InnerProduct: a zero flag (raw fp32), the weight, then the bias
+  for (auto [weight_size, bias_size] : {std::pair<int, int>{24, 4},
+                                        std::pair<int, int>{20, 4},
+                                        std::pair<int, int>{40, 10}}) {
+    w.push_back(0);
+    for (int i = 0; i != weight_size + bias_size; ++i) {
+      w.push_back(dist(*mt));
+    }
+  }
+  return w;
+}
+
+static ncnn::Mat RandomMat(int32_t w, int32_t h, std::mt19937 *mt) {
+  std::uniform_real_distribution<float> dist(-1, 1);
+  ncnn::Mat m = h == 1 ? ncnn::Mat(w) : ncnn::Mat(w, h);
+  for (int32_t i = 0; i != w * h; ++i) {
+    static_cast<float *>(m)[i] = dist(*mt);
+  }
+  return m;
+}
+
+static ncnn::Mat RunFull(ncnn::Net *net, const ncnn::Mat &encoder_out,
+                         const ncnn::Mat &decoder_out) {
+  ncnn::Extractor ex = net->create_extractor();
+  ex.input("in0", encoder_out);
+  ex.input("in1", decoder_out);
+  ncnn::Mat out;
+  ex.extract("out0", out);
+  return out;
+}
+
+static void AssertClose(const ncnn::Mat &a, const ncnn::Mat &b) {
+  assert(a.w == b.w && a.h == b.h);
+  for (int32_t i = 0; i != a.w * a.h; ++i) {
+    float x = static_cast<const float *>(a)[i];
+    float y = static_cast<const float *>(b)[i];
+    assert(std::abs(x - y) < 1e-5f);
+    (void)x;
+    (void)y;
+  }
+}
+
+static void TestSplit(ncnn::Net *net) {
+  sherpa_ncnn::JoinerProjection projection(net);
+  assert(projection.IsSupported());
+
+  std::mt19937 mt(1);
+  const int32_t num_frames = 7;
+  ncnn::Mat encoder_out = RandomMat(6, num_frames, &mt);
+  ncnn::Mat decoder_out = RandomMat(5, 1, &mt);
+
+  ncnn::Mat encoder_proj = projection.ProjectEncoder(encoder_out);
+  ncnn::Mat decoder_proj = projection.ProjectDecoder(decoder_out);
+  assert(encoder_proj.w == 4 && encoder_proj.h == num_frames);
+  assert(decoder_proj.w == 4);
+
+  for (int32_t t = 0; t != num_frames; ++t) {
+    ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+    ncnn::Mat expected = RunFull(net, encoder_out_t, decoder_out);
+
+    ncnn::Mat encoder_proj_t(encoder_proj.w, encoder_proj.row(t));
+    ncnn::Mat joiner_out = projection.Run(encoder_proj_t, decoder_proj);
+    AssertClose(expected, joiner_out);
+  }
+
+  // Batched: row k of the inputs is one stream
+  ncnn::Mat decoder_batch = RandomMat(5, num_frames, &mt);
+  ncnn::Mat expected = RunFull(net, encoder_out, decoder_batch);
+  ncnn::Mat joiner_out =
+      projection.Run(encoder_proj, projection.ProjectDecoder(decoder_batch));
+  AssertClose(expected, joiner_out);
+}
+
+static void TestUnsupported() {
+  // The decoder output is added without going through the add of the
+  // encoder branch, so there is no common BinaryOp
+  const char *param = R"(7767517
+3 3
+Input in0 0 1 in0
+Input in1 0 1 in1
+Concat cat 2 1 in0 in1 out0 0=0
+)";
+  ncnn::Net net;
+  net.load_param_mem(param);
+  sherpa_ncnn::JoinerProjection projection(&net);
+  assert(!projection.IsSupported());
+
+  // Same structure as kJoinerParam, but the projections are multiplied
+  const char *mul_param = R"(7767517
+7 7
+Input in0 0 1 in0
+Input in1 0 1 in1
+InnerProduct encoder_proj 1 1 in0 e 0=4 1=1 2=24
+InnerProduct decoder_proj 1 1 in1 d 0=4 1=1 2=20
+BinaryOp mul 2 1 e d s 0=2
+TanH tanh 1 1 s t
+InnerProduct output_linear 1 1 t out0 0=10 1=1 2=40
+)";
+  ncnn::Net mul_net;
+  mul_net.load_param_mem(mul_param);
+  sherpa_ncnn::JoinerProjection mul_projection(&mul_net);
+  assert(!mul_projection.IsSupported());
+}
+
+int32_t main() {
+  std::mt19937 mt(0);
+  std::vector<float> weights = RandomWeights(&mt);
+
+  ncnn::Net net;
+  net.load_param_mem(kJoinerParam);
+  net.load_model(reinterpret_cast<const unsigned char *>(weights.data()));
+
+  TestSplit(&net);
+  TestUnsupported();
+
+  fprintf(stderr, "Passed!\n");
+  return 0;
+}
@@ -392,6 +392,72 @@ std::vector<std::string> SplitUtf8(const std::string &text) {
   return MergeCharactersIntoWords(ans);
 }
 
+void SplitUtf8(const std::string &text, std::vector<uint32_t> *codepoints,
+               std::vector<int32_t> *word_begin) {
+  codepoints->clear();
+  word_begin->clear();
+
+  const uint8_t *begin = reinterpret_cast<const uint8_t *>(text.c_str());
+  const uint8_t *end = begin + text.size();
+
+  // Start of the word that characters are being merged into, as in
+  // MergeCharactersIntoWords(); -1 if there is none
+  int32_t prev = -1;
+
+  auto start = begin;
+  while (start < end) {
+    uint8_t c = *start;
+    uint8_t i = 0x80;
+    int32_t num_bytes = 0;
+
+    for (; c & i; i >>= 1) {
+      ++num_bytes;
+    }
+
+    uint32_t codepoint;
+    bool is_space = false;
+    bool is_word = false;
+    if (num_bytes == 0) {
+      num_bytes = 1;
+      codepoint = c;
+      is_space = std::isspace(c);
+      is_word = IsPunct(c) || is_space;
+    } else if (2 <= num_bytes && num_bytes <= 4 && end - start >= num_bytes) {
+      codepoint = c & (0x7f >> num_bytes);
+      for (int32_t k = 1; k != num_bytes; ++k) {
+        codepoint = (codepoint << 6) | (start[k] & 0x3f);
+      }
+      is_word =
+          num_bytes >= 3 ||
+          !IsSpecial(std::string(reinterpret_cast<const char *>(start), 2));
+    } else {
+      SHERPA_NCNN_LOGE("Invalid byte at position: %d",
+                       static_cast<int32_t>(start - begin));
+      // skip this byte
+      ++start;
+      continue;
+    }
+    start += num_bytes;
+
+    if (!is_word) {
+      if (prev == -1) {
+        prev = static_cast<int32_t>(codepoints->size());
+        word_begin->push_back(prev);
+      }
+      codepoints->push_back(codepoint);
+      continue;
+    }
+
+    prev = -1;
+    if (!is_space) {
+      word_begin->push_back(static_cast<int32_t>(codepoints->size()));
+      codepoints->push_back(codepoint);
+    }
+  }
+
+  word_begin->push_back(static_cast<int32_t>(codepoints->size()));
+}
+
 std::string ToLowerCase(const std::string &s) {
   return ToString(ToLowerCase(ToWideString(s)));
 }
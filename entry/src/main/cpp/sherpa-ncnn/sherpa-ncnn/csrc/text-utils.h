@@ -122,6 +122,19 @@ bool ConvertStringToReal(const std::string &str, T *out);
 
 std::vector<std::string> SplitUtf8(const std::string &text);
 
+/** Split a UTF-8 string into words in the same way as SplitUtf8(), but
+ * return Unicode code points instead of one string per word.
+ *
+ * @param text  A UTF-8 encoded string.
+ * @param codepoints  On return, it contains the code points of all words.
+ * @param word_begin  On return, the i-th word is
+ *                    (*codepoints)[(*word_begin)[i]] to
+ *                    (*codepoints)[(*word_begin)[i + 1] - 1]. Its size is
+ *                    the number of words plus 1.
+ */
+void SplitUtf8(const std::string &text, std::vector<uint32_t> *codepoints,
+               std::vector<int32_t> *word_begin);
+
 std::string ToLowerCase(const std::string &s);
 void ToLowerCase(std::string *in_out);
 
@@ -32,18 +32,20 @@ class VoiceActivityDetector::Impl {
                 float buffer_size_in_seconds = 60)
       : model_(std::make_unique<SileroVadModel>(config)),
         config_(config),
-        buffer_(buffer_size_in_seconds * config.sample_rate) {}
+        buffer_(buffer_size_in_seconds * config.sample_rate),
+        state_(model_->CreateState()) {}
 
 #if __ANDROID_API__ >= 9
   Impl(AAssetManager *mgr, const SileroVadModelConfig &config,
        float buffer_size_in_seconds = 60)
       : model_(std::make_unique<SileroVadModel>(mgr, config)),
         config_(config),
-        buffer_(buffer_size_in_seconds * config.sample_rate) {}
+        buffer_(buffer_size_in_seconds * config.sample_rate),
+        state_(model_->CreateState()) {}
 #endif
 
   void AcceptWaveform(const float *samples, int32_t n) {
-    if (buffer_.Size() > max_utterance_length_) {
+    if (next_window_ - buffer_.Head() > max_utterance_length_) {
       model_->SetMinSilenceDuration(new_min_silence_duration_s_);
       model_->SetThreshold(new_threshold_);
     } else {
@@ -54,42 +56,57 @@ class VoiceActivityDetector::Impl {
     int32_t window_size = model_->WindowSize();
     int32_t window_shift = model_->WindowShift();
 
-    // note n is usually window_size and there is no need to use
-    // an extra buffer here
-    last_.insert(last_.end(), samples, samples + n);
+    buffer_.Push(samples, n);
 
-    if (last_.size() < window_size) {
-      return;
-    }
-
-    // Note: For v4, window_shift == window_size
-    int32_t k =
-        (static_cast<int32_t>(last_.size()) - window_size) / window_shift + 1;
-    const float *p = last_.data();
+    // Evaluate every complete window after next_window_ directly from the
+    // buffer. Windows that lie in one contiguous span are passed to the
+    // model in a single call; only a window that wraps around the end of
+    // the buffer is copied.
     bool is_speech = false;
+    int32_t num_windows = 0;
+    while (buffer_.Tail() - next_window_ >= window_size) {
+      const float *p1 = nullptr;
+      const float *p2 = nullptr;
+      int32_t n1 = 0;
+      int32_t n2 = 0;
+      buffer_.GetSpans(next_window_, buffer_.Tail() - next_window_, &p1, &n1,
+                       &p2, &n2);
+
+      const float *p = p1;
+      int32_t k = 0;
+      if (n1 >= window_size) {
+        // Note: For v4, window_shift == window_size
+        k = (n1 - window_size) / window_shift + 1;
+      } else {
+        window_.assign(p1, p1 + n1);
+        window_.insert(window_.end(), p2, p2 + (window_size - n1));
+        p = window_.data();
+        k = 1;
+      }
+
+      bool this_call_is_speech = model_->IsSpeech(&state_, p, k, nullptr);
+      is_speech = is_speech || this_call_is_speech;
 
-    for (int32_t i = 0; i < k; ++i, p += window_shift) {
-      buffer_.Push(p, window_shift);
-      // NOTE(fangjun): Please don't use a very large n.
-      bool this_window_is_speech = model_->IsSpeech(p, window_size);
-      is_speech = is_speech || this_window_is_speech;
+      next_window_ += k * window_shift;
+      num_windows += k;
     }
 
-    last_ = std::vector<float>(
-        p, static_cast<const float *>(last_.data()) + last_.size());
+    if (num_windows == 0) {
+      return;
+    }
 
     if (is_speech) {
       if (start_ == -1) {
         // beginning of speech
-        start_ = std::max(buffer_.Tail() - 2 * model_->WindowSize() -
+        start_ = std::max(next_window_ - 2 * model_->WindowSize() -
                               model_->MinSpeechDurationSamples(),
                           buffer_.Head());
       }
     } else {
       // non-speech
-      if (start_ != -1 && buffer_.Size()) {
+      if (start_ != -1 && next_window_ > buffer_.Head()) {
         // end of speech, save the speech segment
-        int32_t end = buffer_.Tail() - model_->MinSilenceDurationSamples();
+        int32_t end = next_window_ - model_->MinSilenceDurationSamples();
 
         std::vector<float> s = buffer_.Get(start_, end - start_);
         SpeechSegment segment;
@@ -103,7 +120,7 @@ class VoiceActivityDetector::Impl {
       }
 
       if (start_ == -1) {
-        int32_t end = buffer_.Tail() - 2 * model_->WindowSize() -
+        int32_t end = next_window_ - 2 * model_->WindowSize() -
                       model_->MinSpeechDurationSamples();
         int32_t n = std::max(0, end - buffer_.Head());
         if (n > 0) {
@@ -126,18 +143,19 @@ class VoiceActivityDetector::Impl {
   void Reset() {
     std::queue<SpeechSegment>().swap(segments_);
 
-    model_->Reset();
+    model_->Reset(&state_);
     buffer_.Reset();
 
     start_ = -1;
+    next_window_ = 0;
   }
 
   void Flush() {
-    if (start_ == -1 || buffer_.Size() == 0) {
+    if (start_ == -1 || next_window_ == buffer_.Head()) {
       return;
     }
 
-    int32_t end = buffer_.Tail() - model_->MinSilenceDurationSamples();
+    int32_t end = next_window_ - model_->MinSilenceDurationSamples();
     if (end <= start_) {
       return;
     }
@@ -165,13 +183,21 @@ class VoiceActivityDetector::Impl {
   std::unique_ptr<SileroVadModel> model_;
   SileroVadModelConfig config_;
   CircularBuffer buffer_;
-  std::vector<float> last_;
+  SileroVadState state_;
+
+  // A window that wraps around the end of buffer_ is copied here
+  std::vector<float> window_;
 
   int max_utterance_length_ = 16000 * 20;  // in samples
   float new_min_silence_duration_s_ = 0.1;
   float new_threshold_ = 1.10;
 
   int32_t start_ = -1;
+
+  // Linear index into buffer_ of the first sample that has not been
+  // evaluated by the model yet. Samples in [next_window_, buffer_.Tail())
+  // wait for a complete window.
+  int32_t next_window_ = 0;
 };
 
 VoiceActivityDetector::VoiceActivityDetector(
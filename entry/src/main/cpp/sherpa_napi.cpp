@@ -1,12 +1,21 @@
 #include "sherpa_napi.h"
+#include "native_events.h"
+#include "spsc_ring_buffer.h"
+#include "pcm_utils.h"
+#include "cpu_budget.h"
+#include "latency_tracer.h"
 #include "sherpa-ncnn/sherpa-ncnn/c-api/c-api.h"
+#include "sherpa-ncnn/csrc/silero-vad-model.h"
 #include <hilog/log.h>
+#include <algorithm>
 #include <string>
 #include <vector>
-#include <deque>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <unordered_map>
 #include <cstring>
 #include <unistd.h>
 #include <chrono>
@@ -18,71 +27,385 @@
 #define LOG_TAG "SHERPA_TURBO" // 改个名字代表极速版
 #define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
 
+// LLM 线程的投机 prefill 入口 (napi_init.cpp)
+extern void LlmSpeculate(const std::string& sessionId, const std::string& partial);
+// 正式提问入口 (napi_init.cpp)，LLM 未加载时返回 false
+extern bool LlmSubmit(const std::string& sessionId, const std::string& prompt, napi_threadsafe_function onToken);
+
+// 每个客户端一路识别：独立的音频缓冲和 sherpa Stream，共享同一个 Recognizer
+struct AsrClient {
+    std::string id;
+    // JS 线程写、后台线程读的 int16 环形缓冲 (2^18 点，16kHz 下约 16 秒)
+    SpscRingBuffer<int16_t> audio{1 << 18};
+    SherpaNcnnStream* stream = nullptr;       // 只在后台线程创建、使用和销毁
+    std::atomic<size_t> inflight{0};          // 已取出但还没解码完的点数
+    std::atomic<bool> reset_pending{false};   // 重置交给后台线程执行
+    std::atomic<size_t> reset_position{0};    // 重置时生产者的写位置
+    std::atomic<bool> finish_pending{false};  // 客户端说完 ([VOICE_END])，音频取完后定稿
+    std::atomic<size_t> finish_position{0};   // 说完时生产者的写位置
+    bool finalize = false;                    // 后台线程：本轮解码后定稿
+    std::string result;                       // g_data_mutex 保护
+
+    // VAD 门控状态，只在后台线程使用
+    sherpa_ncnn::SileroVadState vad_state;    // LSTM 状态和起止判定，模型全局共享
+    bool vad_ready = false;
+    std::vector<float> vad_pending;           // 不足一个窗口的尾巴，以及说完后扣下的窗口
+    std::vector<uint8_t> vad_decided;         // vad_pending 开头已判定过的窗口 (说完后扣下的)
+    std::unique_ptr<bool[]> vad_speech;       // 每个窗口的判定结果，复用避免每次回调都分配
+    size_t vad_speech_capacity = 0;
+    std::vector<float> pre_roll;              // 静音期间最近的音频，起说时先补给识别器
+    bool in_speech = false;
+};
+
 static SherpaNcnnRecognizer *g_recognizer = nullptr;
-static SherpaNcnnStream *g_stream = nullptr;
-static std::mutex g_data_mutex;
-static std::deque<float> g_audio_buffer;
-static std::string g_result_buffer = "";
+static std::mutex g_data_mutex; // 保护客户端表、识别结果和引擎初始化，音频走无锁环形缓冲
+static std::unordered_map<std::string, std::shared_ptr<AsrClient>> g_clients;
+static std::vector<std::shared_ptr<AsrClient>> g_retired; // 已释放、等后台线程销毁 stream
+static std::atomic<uint64_t> g_work_seq{0};      // 有新音频/重置/释放时递增
+static std::atomic<bool> g_worker_idle{false};
+static std::mutex g_wake_mutex;
+static std::condition_variable g_wake_cv;          // 有新任务时唤醒后台线程
 static std::atomic<bool> g_running = false;
 static std::thread* g_worker_thread = nullptr;
 
+// 🔇 VAD 门控：静音期间不送编码器，省下的 CPU 留给 LLM
+// Silero 要连续 min_speech_duration 的语音才判为起说，预滚动要覆盖这段，再多留两个窗口
+static bool g_vad_enabled = false;
+static sherpa_ncnn::SileroVadModelConfig g_vad_config;
+static std::unique_ptr<sherpa_ncnn::SileroVadModel> g_vad_model; // 所有会话共用，只在后台线程使用
+static const size_t kPreRollSamples = 6400;     // 0.4s
+// 说完后补一段静音，让最后一个编码块凑满，尾字能解出来
+static const size_t kTailPaddingSamples = 4800; // 0.3s
+
+static void WakeWorker() {
+    g_work_seq++;
+    // 后台线程在睡眠时才需要加锁唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_worker_idle) {
+        std::lock_guard<std::mutex> lock(g_wake_mutex);
+        g_wake_cv.notify_one();
+    }
+}
+
+// 取 (或新建) 客户端，调用方持有 g_data_mutex
+static std::shared_ptr<AsrClient> GetClientLocked(const std::string& id, bool create) {
+    auto it = g_clients.find(id);
+    if (it != g_clients.end()) return it->second;
+    if (!create) return nullptr;
+    auto client = std::make_shared<AsrClient>();
+    client->id = id;
+    g_clients[id] = client;
+    LOGI("🆕 ASR 会话: %{public}s", id.c_str());
+    return client;
+}
+
+// 补一段静音，让最后一个编码块凑满，尾字能解出来
+static void FeedTailPadding(AsrClient* c) {
+    std::vector<float> padding(kTailPaddingSamples, 0.0f);
+    AcceptWaveform(c->stream, 16000, padding.data(), padding.size());
+}
+
+// 语音起止切换：起说时先补上预滚动，说完时补尾部静音并在解码后定稿
+static void SetSpeechState(AsrClient* c, bool speech) {
+    c->in_speech = speech;
+    if (speech) {
+        if (!c->pre_roll.empty()) {
+            AcceptWaveform(c->stream, 16000, c->pre_roll.data(), c->pre_roll.size());
+            c->pre_roll.clear();
+        }
+    } else {
+        FeedTailPadding(c);
+        c->finalize = true;
+    }
+    EmitVad(speech, c->id);
+    LOGI("%{public}s [%{public}s] VAD: %{public}s", speech ? "🗣️" : "🤫", c->id.c_str(), speech ? "起说" : "说完");
+}
+
+// VAD 门控：攒够的 Silero 窗口一次判定完，只把语音段 (含预滚动和拖尾) 送进 stream
+// 判为说完的窗口之后不再往 stream 里送：剩下的窗口连同判定结果留在 vad_pending，
+// 等这一句定稿、stream 重置后再处理，免得紧接着的新一句并进上一句的定稿
+// 返回是否有音频进了 stream
+static bool GateByVad(AsrClient* c, const float* samples, size_t n) {
+    if (!g_vad_model) g_vad_model = std::make_unique<sherpa_ncnn::SileroVadModel>(g_vad_config);
+    if (!c->vad_ready) {
+        c->vad_state = g_vad_model->CreateState();
+        c->vad_ready = true;
+    }
+    const size_t window = (size_t)g_vad_model->WindowSize();
+
+    // 没有上次剩下的尾巴时直接在输入上判定，不拷贝
+    const float* data = samples;
+    size_t size = n;
+    if (!c->vad_pending.empty()) {
+        c->vad_pending.insert(c->vad_pending.end(), samples, samples + n);
+        data = c->vad_pending.data();
+        size = c->vad_pending.size();
+    }
+
+    // 上次扣下的窗口已经过了 LSTM，沿用当时的判定，只判定新的窗口
+    const size_t num_windows = size / window;
+    const size_t num_decided = c->vad_decided.size();
+    if (c->vad_speech_capacity < num_windows) {
+        c->vad_speech_capacity = std::max(num_windows, c->vad_speech_capacity * 2);
+        c->vad_speech.reset(new bool[c->vad_speech_capacity]);
+    }
+    bool* is_speech = c->vad_speech.get();
+    std::copy(c->vad_decided.begin(), c->vad_decided.end(), is_speech);
+    if (num_windows > num_decided) {
+        g_vad_model->IsSpeech(&c->vad_state, data + num_decided * window,
+                              (int32_t)(num_windows - num_decided), is_speech + num_decided);
+    }
+
+    bool fed = false;
+    size_t i = 0;
+    while (i < num_windows) {
+        const float* p = data + i * window;
+        bool ended = false;
+        if (is_speech[i] != c->in_speech) {
+            SetSpeechState(c, is_speech[i]);
+            ended = !is_speech[i];
+            fed = true; // 预滚动或尾部静音已送入
+        }
+
+        if (c->in_speech) {
+            AcceptWaveform(c->stream, 16000, p, window);
+            fed = true;
+        } else {
+            c->pre_roll.insert(c->pre_roll.end(), p, p + window);
+            if (c->pre_roll.size() > kPreRollSamples) {
+                c->pre_roll.erase(c->pre_roll.begin(), c->pre_roll.end() - kPreRollSamples);
+            }
+        }
+        ++i;
+        if (ended) break;
+    }
+
+    c->vad_decided.assign(is_speech + i, is_speech + num_windows);
+    const size_t offset = i * window;
+    if (c->vad_pending.empty()) {
+        c->vad_pending.assign(samples + offset, samples + n);
+    } else {
+        c->vad_pending.erase(c->vad_pending.begin(), c->vad_pending.begin() + offset);
+    }
+    return fed;
+}
+
+// 取一个客户端的一块音频送进它的 stream
+// 返回是否有音频进了 stream，*consumed 表示是否从缓冲里取了音频 (VAD 可能全部丢弃)
+static bool FeedClient(AsrClient* c, std::vector<float>& samples, bool* consumed) {
+    *consumed = false;
+
+    // 处理重置请求：丢弃重置前收到的音频，再重置 stream
+    if (c->reset_pending.exchange(false)) {
+        c->audio.DiscardTo(c->reset_position.load());
+        if (c->stream) Reset(g_recognizer, c->stream);
+        if (c->vad_ready) g_vad_model->Reset(&c->vad_state);
+        c->vad_pending.clear();
+        c->vad_decided.clear();
+        c->pre_roll.clear();
+        c->in_speech = false;
+        c->finalize = false;
+    }
+
+    // 客户端说完：之前的音频都已取走 (VAD 扣下的窗口也已处理)，补尾部静音，解码后定稿
+    if (c->finish_pending && c->vad_decided.empty() &&
+        (ptrdiff_t)(c->audio.ReadPosition() - c->finish_position.load()) >= 0) {
+        c->finish_pending = false;
+        // VAD 判为静音时 stream 里没有待解码的语音 (说完时已经定稿)
+        bool has_speech = c->stream && !(g_vad_enabled && !c->in_speech);
+        // 说话中不足一个窗口的尾巴也是这句话的一部分，先送进去
+        if (has_speech && !c->vad_pending.empty()) {
+            AcceptWaveform(c->stream, 16000, c->vad_pending.data(), c->vad_pending.size());
+        }
+        c->vad_pending.clear();
+        // 这一句到此为止：VAD 回到静音，下一句重新判定起说，免得沿用上一句的说话状态
+        if (c->vad_ready) g_vad_model->Reset(&c->vad_state);
+        c->pre_roll.clear();
+        c->in_speech = false;
+        if (has_speech) {
+            FeedTailPadding(c);
+            c->finalize = true;
+            *consumed = true;
+            return true;
+        }
+    }
+
+    // 上一句定稿后，接着处理说完时扣下的窗口
+    if (g_vad_enabled && !c->vad_decided.empty() && !c->finalize) {
+        *consumed = true;
+        return GateByVad(c, nullptr, 0);
+    }
+
+    int queue_size = (int)c->audio.Size();
+    if (queue_size == 0) return false;
+
+    if (!c->stream) c->stream = CreateStream(g_recognizer);
+
+    // 每次取 0.4s (6400点)
+    // 如果积压严重 (>1秒)，就多取一点(0.8s)来追赶进度
+    size_t target_fetch = (queue_size > 16000) ? 12800 : 6400;
+    const int16_t* p1;
+    const int16_t* p2;
+    size_t n1, n2;
+    size_t fetch_size = c->audio.Peek(target_fetch, &p1, &n1, &p2, &n2);
+    c->inflight = fetch_size;
+
+    // int16 -> float 在消费端批量转换 (NEON)
+    samples.resize(fetch_size);
+    Int16ToFloat(p1, samples.data(), n1);
+    Int16ToFloat(p2, samples.data() + n1, n2);
+    c->audio.Consume(fetch_size);
+    *consumed = true;
+
+    if (g_vad_enabled) {
+        if (GateByVad(c, samples.data(), samples.size())) return true;
+        c->inflight = 0;
+        return false;
+    }
+
+    AcceptWaveform(c->stream, 16000, samples.data(), samples.size());
+    return true;
+}
+
+// 解码完成后取结果，有变化时推送
+static void PublishResult(AsrClient* c) {
+    SherpaNcnnResult* result = GetResult(g_recognizer, c->stream);
+    std::string text = result->text;
+    DestroyResult(result);
+
+    // 处理期间被重置的话，这批结果已经过期
+    if (!text.empty() && !c->reset_pending) {
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(g_data_mutex);
+            changed = (text != c->result);
+            c->result = text;
+        }
+        // 识别结果有变化时推送给 JS，同时让 LLM 提前 prefill
+        if (changed) {
+            EmitPartialTranscript(text, c->id);
+            LlmSpeculate(c->id, text);
+        }
+    }
+
+    c->inflight = 0;
+}
+
+// 端点定稿：识别器的尾部静音规则 (rule1/rule2)、VAD 说完或客户端 [VOICE_END] 任一触发
+// 推送最终文本、原地重置 stream，并直接把提问交给 LLM 线程
+static void FinalizeIfEndpoint(AsrClient* c) {
+    if (!c->stream || c->reset_pending) return;
+    if (!c->finalize && !IsEndpoint(g_recognizer, c->stream)) return;
+    c->finalize = false;
+
+    SherpaNcnnResult* result = GetResult(g_recognizer, c->stream);
+    std::string text = result->text;
+    DestroyResult(result);
+    Reset(g_recognizer, c->stream);
+    {
+        std::lock_guard<std::mutex> lock(g_data_mutex);
+        c->result = "";
+    }
+
+    // 只有静音 (rule1) 时直接重置，不打扰 LLM
+    if (text.find_first_not_of(' ') == std::string::npos) return;
+
+    LOGI("🏁 [%{public}s] 定稿: %{public}s", c->id.c_str(), text.c_str());
+    EmitFinal("asr", text, c->id);
+    if (!LlmSubmit(c->id, text, nullptr)) {
+        LOGI("⚠️ [%{public}s] LLM 未就绪，定稿未提交", c->id.c_str());
+    }
+}
+
 // 🔥 后台线程：全速计算 🔥
+// 多个客户端轮转调度：每轮每个有音频的客户端送一块，再把就绪的 stream 批量解码，谁也不会饿死
 void BackgroundWorker() {
     LOGI("🧵 后台线程启动 (Turbo Mode)");
     
-    while (g_running) {
-        std::vector<float> samples;
-        int queue_size = 0;
+    std::vector<float> samples;
+    samples.reserve(12800);
+
+    CpuBudget& budget = CpuBudget::Instance();
+    budget.RegisterCurrentThread(CPU_ENGINE_ASR);
+    uint32_t budget_gen = 0;
 
+    std::vector<std::shared_ptr<AsrClient>> round;
+    std::vector<std::shared_ptr<AsrClient>> retired;
+    std::vector<AsrClient*> fed;
+    std::vector<SherpaNcnnStream*> ready;
+    while (g_running) {
+        uint64_t seen = g_work_seq.load();
         {
             std::lock_guard<std::mutex> lock(g_data_mutex);
-            queue_size = g_audio_buffer.size();
-            
-            // 每次取 0.4s (6400点)
-            // 如果积压严重 (>1秒)，就多取一点(0.8s)来追赶进度
-            int target_fetch = (queue_size > 16000) ? 12800 : 6400;
-            int fetch_size = std::min(queue_size, target_fetch); 
-            
-            if (fetch_size > 0) {
-                for(int i=0; i<fetch_size; i++) {
-                    samples.push_back(g_audio_buffer.front());
-                    g_audio_buffer.pop_front();
-                }
-            }
+            round.clear();
+            for (auto& kv : g_clients) round.push_back(kv.second);
+            retired.swap(g_retired);
         }
 
-        if (samples.empty()) {
-            usleep(5000); // 没数据睡 5ms
-            continue;
+        // 已释放的客户端：stream 只能在这个线程里销毁
+        for (auto& c : retired) {
+            if (c->stream) DestroyStream(c->stream);
+            c->stream = nullptr;
         }
+        retired.clear();
 
-        // --- 性能计时 ---
-        auto start = std::chrono::high_resolution_clock::now();
+        // 阶段变化后按新预算调整线程数和绑核 (必须在解码线程里做)
+        int threads = 0;
+        if (g_recognizer && budget.Poll(CPU_ENGINE_ASR, &budget_gen, &threads)) {
+            SetNumThreads(g_recognizer, threads);
+            budget.ApplyAffinity(CPU_ENGINE_ASR, threads);
+        }
 
-        if (g_recognizer && g_stream) {
-            AcceptWaveform(g_stream, 16000, samples.data(), samples.size());
-            
-            while (IsReady(g_recognizer, g_stream)) {
-                Decode(g_recognizer, g_stream);
-            }
-            
-            SherpaNcnnResult* result = GetResult(g_recognizer, g_stream);
-            std::string text = result->text;
-            DestroyResult(result);
-
-            if (!text.empty()) {
-                std::lock_guard<std::mutex> lock(g_data_mutex);
-                g_result_buffer = text;
+        // 1. 每个有音频的客户端送一块
+        fed.clear();
+        bool consumed_any = false;
+        if (g_recognizer) {
+            for (auto& c : round) {
+                bool consumed = false;
+                if (FeedClient(c.get(), samples, &consumed)) fed.push_back(c.get());
+                consumed_any = consumed_any || consumed;
             }
         }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        
-        // 只打印耗时较长的日志，避免刷屏
-        if (duration > 200) {
-             LOGI("⚡ 耗时: %{public}lldms | 积压: %{public}d", duration, queue_size);
+        if (!fed.empty()) {
+            // --- 性能计时 ---
+            auto start = std::chrono::high_resolution_clock::now();
+
+            // 2. 所有就绪的 stream 一起解码 (joiner/decoder 按批运行)，直到都没有完整的块
+            while (true) {
+                ready.clear();
+                for (AsrClient* c : fed) {
+                    if (IsReady(g_recognizer, c->stream)) ready.push_back(c->stream);
+                }
+                if (ready.empty()) break;
+                DecodeStreams(g_recognizer, ready.data(), (int32_t)ready.size());
+            }
+
+            // 3. 取结果，到端点的直接定稿
+            for (AsrClient* c : fed) {
+                PublishResult(c);
+                FinalizeIfEndpoint(c);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+            long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+            // 只打印耗时较长的日志，避免刷屏
+            if (duration > 200) {
+                 LOGI("⚡ 耗时: %{public}lldms | 客户端: %{public}d", duration, (int)fed.size());
+            }
+            continue;
         }
+
+        // 这一轮的音频全被 VAD 判为静音：缓冲里可能还有，接着取
+        if (consumed_any) continue;
+
+        // 没数据就阻塞，AcceptWaveform / ResetSherpa 之后唤醒
+        std::unique_lock<std::mutex> lock(g_wake_mutex);
+        g_worker_idle = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        g_wake_cv.wait(lock, [seen] { return g_work_seq.load() != seen || !g_running; });
+        g_worker_idle = false;
     }
 }
 
@@ -92,26 +415,34 @@ napi_value InitSherpa(napi_env env, napi_callback_info info) {
         napi_value res; napi_get_boolean(env, true, &res); return res;
     }
 
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     char pathBuf[512];
     size_t strSize;
     napi_get_value_string_utf8(env, args[0], pathBuf, 512, &strSize);
     std::string modelDir = pathBuf;
 
+    // 可选的第二个参数：Silero VAD 模型目录 (含 silero.ncnn.param/bin)，传了才开门控
+    std::string vadDir;
+    napi_valuetype vadType = napi_undefined;
+    if (argc >= 2) napi_typeof(env, args[1], &vadType);
+    if (vadType == napi_string) {
+        napi_get_value_string_utf8(env, args[1], pathBuf, 512, &strSize);
+        vadDir = pathBuf;
+    }
+
     // 🔥 1. 环境变量优化 (32位系统专用) 🔥
     setenv("NCNN_USE_FP16_PACKED", "0", 1);
     setenv("NCNN_USE_FP16_STORAGE", "0", 1);
     setenv("NCNN_USE_FP16_ARITHMETIC", "0", 1); // 禁用FP16，防止软解卡死
     setenv("NCNN_CPU_POWERSAVE", "0", 1);       // 绑定大核
-    setenv("OMP_NUM_THREADS", "2", 1);          // 配合下面的 num_threads
 
     SherpaNcnnRecognizerConfig config;
     memset(&config, 0, sizeof(config)); 
     
-    // 🔥 2. 开启双线程 (Int8模型在2线程下更快) 🔥
-    config.model_config.num_threads = 2; 
+    // 🔥 2. 线程数由 CPU 预算决定 (聆听阶段默认占一半核心)，之后按阶段动态调整 🔥
+    config.model_config.num_threads = CpuBudget::Instance().Threads(CPU_ENGINE_ASR);
 
     std::string tokens = modelDir + "/tokens.txt";
     std::string encoder_bin = modelDir + "/encoder_jit_trace-pnnx.ncnn.bin";
@@ -143,10 +474,18 @@ napi_value InitSherpa(napi_env env, napi_callback_info info) {
     config.feat_config.sampling_rate = 16000;
     config.feat_config.feature_dim = 80;
 
+    if (!vadDir.empty() && access((vadDir + "/silero.ncnn.param").c_str(), F_OK) == 0) {
+        g_vad_config.model_dir = vadDir;
+        g_vad_config.use_vulkan_compute = false;
+        g_vad_config.num_threads = 1; // 每个窗口只有 512 点，多线程得不偿失
+        g_vad_enabled = true;
+        LOGI("🔇 VAD 门控已开启: %{public}s", vadDir.c_str());
+    }
+
     g_recognizer = CreateRecognizer(&config);
     if (g_recognizer) {
-        g_stream = CreateStream(g_recognizer);
-        LOGI("✅ Sherpa Init OK (Threads=2, Paths=4)");
+        // 每个客户端的 stream 在它第一次送音频时由后台线程创建
+        LOGI("✅ Sherpa Init OK (Threads=%{public}d, Paths=4)", config.model_config.num_threads);
         if (!g_running) {
             g_running = true;
             g_worker_thread = new std::thread(BackgroundWorker);
@@ -158,60 +497,125 @@ napi_value InitSherpa(napi_env env, napi_callback_info info) {
     return res;
 }
 
-// 生产者：只负责入队
+// 生产者：只负责入队 acceptWaveform(buffer, sessionId?)
 napi_value AcceptWaveform(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     void* data = nullptr;
     size_t len = 0;
     napi_get_arraybuffer_info(env, args[0], &data, &len);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 1);
 
     if (len > 0) {
-        int16_t* pcm16 = (int16_t*)data;
-        int count = len / 2;
-        std::lock_guard<std::mutex> lock(g_data_mutex);
-        for(int i=0; i<count; ++i) {
-            g_audio_buffer.push_back(pcm16[i] / 32768.0f);
+        LatencyTracer::Instance().OnAudio(sessionId);
+        std::shared_ptr<AsrClient> client;
+        {
+            std::lock_guard<std::mutex> lock(g_data_mutex);
+            client = GetClientLocked(sessionId, true);
         }
+        const int16_t* pcm16 = (const int16_t*)data;
+        size_t count = len / 2;
+        size_t written = client->audio.Write(pcm16, count);
+        if (written < count) {
+            LOGI("⚠️ [%{public}s] 音频积压溢出，丢弃 %{public}d 点", sessionId.c_str(), (int)(count - written));
+        }
+        WakeWorker();
     }
     napi_value res;
     napi_create_string_utf8(env, "", 0, &res);
     return res;
 }
 
-// 消费者：JS 轮询
+// 消费者：JS 轮询 getRecognizedText(sessionId?)
 napi_value GetRecognizedText(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
     std::string res = "";
     {
         std::lock_guard<std::mutex> lock(g_data_mutex);
-        res = g_result_buffer;
+        std::shared_ptr<AsrClient> client = GetClientLocked(sessionId, false);
+        if (client) res = client->result;
     }
     napi_value output;
     napi_create_string_utf8(env, res.c_str(), NAPI_AUTO_LENGTH, &output);
     return output;
 }
 
-// 手动重置
+// 手动重置 resetSherpa(sessionId?)：stream 只在后台线程里操作，这里记录位置后唤醒它
 napi_value ResetSherpa(napi_env env, napi_callback_info info) {
-    std::lock_guard<std::mutex> lock(g_data_mutex);
-    if (g_recognizer && g_stream) {
-        Reset(g_recognizer, g_stream);
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    std::shared_ptr<AsrClient> client;
+    {
+        std::lock_guard<std::mutex> lock(g_data_mutex);
+        client = GetClientLocked(sessionId, false);
+        if (client) client->result = "";
+    }
+    if (client) {
+        client->finish_pending = false;
+        client->reset_position = client->audio.WritePosition();
+        client->reset_pending = true;
+        WakeWorker();
+    }
+    LOGI("🔄 Manual Reset Done [%{public}s]", sessionId.c_str());
+    return nullptr;
+}
+
+// 客户端说完 finishSherpa(sessionId?)：取完已收到的音频后由后台线程定稿，
+// 结果通过 onFinal("asr", text, sessionId) 推送并直接交给 LLM，取代 JS 轮询 getQueueSize
+napi_value FinishSherpa(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    std::shared_ptr<AsrClient> client;
+    {
+        std::lock_guard<std::mutex> lock(g_data_mutex);
+        client = GetClientLocked(sessionId, false);
+    }
+    if (client) {
+        client->finish_position = client->audio.WritePosition();
+        client->finish_pending = true;
+        WakeWorker();
     }
-    g_result_buffer = "";
-    g_audio_buffer.clear();
-    LOGI("🔄 Manual Reset Done");
     return nullptr;
 }
 
-// 查岗接口
+// 查岗接口 getQueueSize(sessionId?)
 napi_value GetQueueSize(napi_env env, napi_callback_info info) {
-    int size = 0;
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string sessionId = GetOptionalSessionId(env, args, argc, 0);
+
+    std::shared_ptr<AsrClient> client;
     {
         std::lock_guard<std::mutex> lock(g_data_mutex);
-        size = (int)g_audio_buffer.size();
+        client = GetClientLocked(sessionId, false);
     }
+    // 未取出的 + 正在解码的，都算作未完成
+    int size = client ? (int)(client->audio.Size() + client->inflight.load()) : 0;
     napi_value result;
     napi_create_int32(env, size, &result);
     return result;
-}
\ No newline at end of file
+}
+
+void ReleaseAsrSession(const std::string& sessionId) {
+    {
+        std::lock_guard<std::mutex> lock(g_data_mutex);
+        auto it = g_clients.find(sessionId);
+        if (it == g_clients.end()) return;
+        g_retired.push_back(it->second);
+        g_clients.erase(it);
+    }
+    WakeWorker();
+    LOGI("🗑️ 释放 ASR 会话: %{public}s", sessionId.c_str());
+}
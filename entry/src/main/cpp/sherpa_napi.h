@@ -3,10 +3,15 @@
 #define SHERPA_NAPI_H
 
 #include "napi/native_api.h"
+#include <string>
 
 // 声明 Sherpa 的三个核心函数
 napi_value InitSherpa(napi_env env, napi_callback_info info);
 napi_value AcceptWaveform(napi_env env, napi_callback_info info);
 napi_value ResetSherpa(napi_env env, napi_callback_info info);
+napi_value FinishSherpa(napi_env env, napi_callback_info info);
+
+// 客户端断开：释放它的识别 stream 和音频缓冲
+void ReleaseAsrSession(const std::string& sessionId);
 
 #endif // SHERPA_NAPI_H
\ No newline at end of file
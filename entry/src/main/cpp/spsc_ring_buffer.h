@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// ==========================================
+// 单生产者/单消费者无锁环形缓冲区
+// 读写位置是单调递增的计数，按 2 的幂容量取模；
+// 两个位置分别独占一条 cache line，避免生产者和消费者互相伪共享
+// ==========================================
+template <typename T>
+class SpscRingBuffer {
+public:
+    static constexpr size_t kCacheLine = 64;
+
+    // capacity 会向上取整到 2 的幂
+    explicit SpscRingBuffer(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        buffer_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t Capacity() const { return mask_ + 1; }
+
+    // 近似大小，任意线程可调用
+    size_t Size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    // ---- 生产者 ----
+
+    // 写入最多 n 个元素，空间不足时只写能放下的部分，返回实际写入数量
+    size_t Write(const T* data, size_t n) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t free_space = Capacity() - (head - cached_tail_);
+        if (free_space < n) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            free_space = Capacity() - (head - cached_tail_);
+        }
+        if (n > free_space) n = free_space;
+        if (n == 0) return 0;
+
+        size_t offset = head & mask_;
+        size_t first = n < Capacity() - offset ? n : Capacity() - offset;
+        memcpy(buffer_.data() + offset, data, first * sizeof(T));
+        if (n > first) memcpy(buffer_.data(), data + first, (n - first) * sizeof(T));
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // 已写入的总数 (生产者视角的当前位置)
+    size_t WritePosition() const { return head_.load(std::memory_order_acquire); }
+
+    // ---- 消费者 ----
+
+    // 零拷贝读取：返回最多两段连续内存，读完后调用 Consume
+    size_t Peek(size_t max, const T** p1, size_t* n1, const T** p2, size_t* n2) const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t avail = head_.load(std::memory_order_acquire) - tail;
+        if (avail > max) avail = max;
+
+        size_t offset = tail & mask_;
+        size_t first = avail < Capacity() - offset ? avail : Capacity() - offset;
+        *p1 = buffer_.data() + offset;
+        *n1 = first;
+        *p2 = buffer_.data();
+        *n2 = avail - first;
+        return avail;
+    }
+
+    // 已取走的总数 (消费者视角的当前位置)
+    size_t ReadPosition() const { return tail_.load(std::memory_order_acquire); }
+
+    void Consume(size_t n) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 读取并拷贝最多 n 个元素
+    size_t Read(T* out, size_t n) {
+        const T* p1;
+        const T* p2;
+        size_t n1, n2;
+        size_t got = Peek(n, &p1, &n1, &p2, &n2);
+        if (n1) memcpy(out, p1, n1 * sizeof(T));
+        if (n2) memcpy(out + n1, p2, n2 * sizeof(T));
+        Consume(got);
+        return got;
+    }
+
+    // 丢弃直到生产者位置 pos 之前的所有数据 (用于消费端执行的重置)
+    void DiscardTo(size_t pos) {
+        // 计数可能回绕，用差值比较
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t avail = head_.load(std::memory_order_acquire) - tail;
+        ptrdiff_t ahead = (ptrdiff_t)(pos - tail);
+        if (ahead <= 0) return;
+        if ((size_t)ahead > avail) ahead = (ptrdiff_t)avail;
+        tail_.store(tail + (size_t)ahead, std::memory_order_release);
+    }
+
+private:
+    alignas(kCacheLine) std::atomic<size_t> head_{0};  // 生产者写
+    size_t cached_tail_ = 0;                            // 生产者本地缓存的读位置
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};  // 消费者写
+    alignas(kCacheLine) std::vector<T> buffer_;
+    size_t mask_ = 0;
+};
@@ -0,0 +1,319 @@
+#include "tts_cache.h"
+#include "hash_util.h"
+
+#include <hilog/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#undef LOG_DOMAIN
+#undef LOG_TAG
+#define LOG_DOMAIN 0x0000
+#define LOG_TAG "TTS_CACHE"
+#define LOGI(...) OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, LOG_TAG, __VA_ARGS__)
+
+// 磁盘文件：头 + 完整的键 (校验哈希碰撞/截断) + 4 字节对齐的 PCM
+struct TtsCacheFileHeader {
+    char magic[4];          // "TTSC"
+    uint32_t key_bytes;
+    uint32_t num_samples;
+    uint32_t reserved;
+};
+
+static const char kMagic[4] = {'T', 'T', 'S', 'C'};
+
+static size_t PcmOffset(size_t key_bytes) {
+    return sizeof(TtsCacheFileHeader) + ((key_bytes + 3) & ~static_cast<size_t>(3));
+}
+
+static size_t EntryBytes(const std::string& key, const std::vector<int16_t>& pcm) {
+    return key.size() + pcm.size() * sizeof(int16_t);
+}
+
+static void RemoveFiles(const std::vector<std::string>& paths) {
+    for (const auto& path : paths) unlink(path.c_str());
+}
+
+void TtsCache::Configure(const std::string& model_dir, const std::string& cache_dir) {
+    // 不读整个模型：目录下每个文件的 名字/大小/修改时间 做指纹，按名字排序保证稳定
+    std::vector<std::string> names;
+    if (DIR* d = opendir(model_dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') names.push_back(e->d_name);
+        }
+        closedir(d);
+    }
+    std::sort(names.begin(), names.end());
+
+    uint64_t h = Fnv1a(model_dir.data(), model_dir.size());
+    for (const auto& name : names) {
+        struct stat st = {};
+        if (stat((model_dir + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        uint64_t fields[] = {(uint64_t)st.st_size, (uint64_t)st.st_mtime};
+        h = Fnv1a(name.data(), name.size(), h);
+        h = Fnv1a(fields, sizeof(fields), h);
+    }
+
+    // 收集本模型的缓存文件，按修改时间排好作为淘汰顺序；别的模型留下的直接删掉
+    // 扫目录不持锁
+    std::vector<std::pair<time_t, std::pair<std::string, size_t>>> found;
+    if (!cache_dir.empty()) {
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "tts-%016llx-", (unsigned long long)h);
+        if (DIR* d = opendir(cache_dir.c_str())) {
+            while (dirent* e = readdir(d)) {
+                std::string name = e->d_name;
+                if (name.compare(0, 4, "tts-") != 0) continue;
+                std::string path = cache_dir + "/" + name;
+                struct stat st = {};
+                if (name.compare(0, strlen(prefix), prefix) != 0 || stat(path.c_str(), &st) != 0) {
+                    unlink(path.c_str());
+                    continue;
+                }
+                found.push_back({st.st_mtime, {path, (size_t)st.st_size}});
+            }
+            closedir(d);
+        }
+        std::sort(found.begin(), found.end());
+    }
+
+    std::vector<std::string> doomed;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (h != model_fingerprint) {
+            lru.clear();
+            index.clear();
+            memory_bytes = 0;
+        }
+        model_fingerprint = h;
+        dir = cache_dir;
+        pending_writes.clear();
+        files.clear();
+        disk_bytes = 0;
+        for (auto& f : found) {
+            disk_bytes += f.second.second;
+            files.push_back(std::move(f.second));
+        }
+        EvictLocked(&doomed);
+        if (!dir.empty()) {
+            LOGI("💾 TTS 缓存: %{public}zu 个文件, %{public}zu KB", files.size(), disk_bytes >> 10);
+        }
+    }
+    RemoveFiles(doomed);
+}
+
+std::string TtsCache::MakeKey(const std::string& text, int32_t sid, float speed) const {
+    // 去掉首尾空白、连续空白合并成一个空格、ASCII 转小写 (词典本身就是小写)
+    std::string norm;
+    norm.reserve(text.size());
+    bool pending_space = false;
+    for (unsigned char c : text) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            pending_space = !norm.empty();
+            continue;
+        }
+        if (pending_space) norm.push_back(' ');
+        pending_space = false;
+        norm.push_back((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+    }
+    if (norm.empty() || norm.size() > kMaxTextBytes) return "";
+
+    char head[64];
+    snprintf(head, sizeof(head), "%016llx|%d|%.3f|", (unsigned long long)model_fingerprint.load(), sid, speed);
+    return head + norm;
+}
+
+std::string TtsCache::PathOf(const std::string& dir, uint64_t fingerprint, const std::string& key) {
+    char name[64];
+    snprintf(name, sizeof(name), "/tts-%016llx-%016llx.pcm",
+             (unsigned long long)fingerprint,
+             (unsigned long long)Fnv1a(key.data(), key.size()));
+    return dir + name;
+}
+
+TtsPcm TtsCache::Lookup(const std::string& key) {
+    if (key.empty()) return nullptr;
+
+    std::string path;
+    uint64_t fingerprint = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            Entry& e = lru.front();
+            // 第二次用到：说明是常用句，排队落盘，先把 PCM 交出去
+            if (!e.on_disk && !dir.empty()) {
+                pending_writes.push_back({e.key, e.pcm});
+                e.on_disk = true;
+            }
+            return e.pcm;
+        }
+        if (dir.empty()) return nullptr;
+        fingerprint = model_fingerprint;
+        path = PathOf(dir, fingerprint, key);
+    }
+
+    // 读文件不持锁
+    TtsPcm pcm = ReadFile(path, key);
+    if (!pcm) return nullptr;
+
+    std::vector<std::string> doomed;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // 读的时候换了模型：结果照样用，但不进缓存
+        if (fingerprint != model_fingerprint) return pcm;
+        auto it = index.find(key);
+        if (it != index.end()) {
+            // 另一个线程先读到了
+            lru.splice(lru.begin(), lru, it->second);
+            return lru.front().pcm;
+        }
+        lru.push_front({key, pcm, true});
+        index[key] = lru.begin();
+        memory_bytes += EntryBytes(key, *pcm);
+        EvictLocked(&doomed);
+    }
+    RemoveFiles(doomed);
+    return pcm;
+}
+
+void TtsCache::Insert(const std::string& key, std::vector<int16_t> pcm, bool persist) {
+    if (key.empty() || pcm.empty()) return;
+    size_t bytes = EntryBytes(key, pcm);
+    TtsPcm shared = std::make_shared<const std::vector<int16_t>>(std::move(pcm));
+
+    std::vector<std::string> doomed;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            memory_bytes -= EntryBytes(key, *it->second->pcm);
+            lru.erase(it->second);
+            index.erase(it);
+        }
+
+        bool on_disk = persist && !dir.empty();
+        if (on_disk) pending_writes.push_back({key, shared});
+
+        memory_bytes += bytes;
+        lru.push_front({key, shared, on_disk});
+        index[key] = lru.begin();
+        EvictLocked(&doomed);
+    }
+    RemoveFiles(doomed);
+}
+
+void TtsCache::PersistPending() {
+    std::vector<std::pair<std::string, TtsPcm>> writes;
+    std::string cache_dir;
+    uint64_t fingerprint = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (pending_writes.empty()) return;
+        writes.swap(pending_writes);
+        cache_dir = dir;
+        fingerprint = model_fingerprint;
+    }
+
+    for (const auto& w : writes) {
+        std::string path = PathOf(cache_dir, fingerprint, w.first);
+        size_t bytes = WriteFile(path, w.first, *w.second);
+        if (bytes == 0) continue;
+
+        std::vector<std::string> doomed;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            // 写的时候换了模型或目录：Configure 已经不认这个文件了
+            if (fingerprint != model_fingerprint || cache_dir != dir) {
+                doomed.push_back(path);
+            } else {
+                for (auto it = files.begin(); it != files.end(); ++it) {
+                    if (it->first == path) {
+                        disk_bytes -= it->second;
+                        files.erase(it);
+                        break;
+                    }
+                }
+                files.push_back({path, bytes});
+                disk_bytes += bytes;
+                EvictLocked(&doomed);
+            }
+        }
+        RemoveFiles(doomed);
+    }
+}
+
+TtsPcm TtsCache::ReadFile(const std::string& path, const std::string& key) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    // 先读头和键做校验，PCM 直接读进最终的 vector，只拷一次
+    struct stat st = {};
+    TtsCacheFileHeader header = {};
+    std::string stored_key(key.size(), '\0');
+    TtsPcm pcm;
+    // 文件名只是哈希：键不一致 (碰撞) 或长度不对 (写了一半) 都当作未命中
+    if (fstat(fd, &st) == 0 &&
+        pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        memcmp(header.magic, kMagic, 4) == 0 && header.key_bytes == key.size() &&
+        PcmOffset(key.size()) + (size_t)header.num_samples * sizeof(int16_t) == (size_t)st.st_size &&
+        pread(fd, &stored_key[0], key.size(), sizeof(header)) == (ssize_t)key.size() &&
+        stored_key == key) {
+        std::vector<int16_t> samples(header.num_samples);
+        size_t bytes = samples.size() * sizeof(int16_t);
+        if (pread(fd, samples.data(), bytes, PcmOffset(key.size())) == (ssize_t)bytes) {
+            pcm = std::make_shared<const std::vector<int16_t>>(std::move(samples));
+        }
+    }
+    close(fd);
+    return pcm;
+}
+
+size_t TtsCache::WriteFile(const std::string& path, const std::string& key, const std::vector<int16_t>& pcm) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        LOGE("❌ TTS 缓存写入失败: %{public}s", tmp.c_str());
+        return 0;
+    }
+
+    TtsCacheFileHeader header = {};
+    memcpy(header.magic, kMagic, 4);
+    header.key_bytes = (uint32_t)key.size();
+    header.num_samples = (uint32_t)pcm.size();
+    const char zeros[4] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(key.data(), 1, key.size(), f) == key.size() &&
+              fwrite(zeros, 1, PcmOffset(key.size()) - sizeof(header) - key.size(), f) ==
+                  PcmOffset(key.size()) - sizeof(header) - key.size() &&
+              fwrite(pcm.data(), sizeof(int16_t), pcm.size(), f) == pcm.size();
+    ok = fclose(f) == 0 && ok;
+
+    // 先写临时文件再 rename，进程中途被杀也不会留下半个文件
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return 0;
+    }
+    return PcmOffset(key.size()) + pcm.size() * sizeof(int16_t);
+}
+
+void TtsCache::EvictLocked(std::vector<std::string>* doomed) {
+    while (memory_bytes > kMemoryBytes && lru.size() > 1) {
+        Entry& e = lru.back();
+        memory_bytes -= EntryBytes(e.key, *e.pcm);
+        index.erase(e.key);
+        lru.pop_back();
+    }
+    // 磁盘层按写入先后淘汰；内存里对应条目的 on_disk 不改，最多少落一次盘
+    while (disk_bytes > kDiskBytes && files.size() > 1) {
+        doomed->push_back(files.front().first);
+        disk_bytes -= files.front().second;
+        files.pop_front();
+    }
+}
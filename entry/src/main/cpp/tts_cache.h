@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ==========================================
+// TTS 合成结果缓存
+// 助手反复说的短句 (问候、"没听清"、报错提示) 按 (规范化文本, sid, speed, 模型指纹)
+// 缓存 int16 PCM，命中时直接送出，跳过整条 VITS 推理
+// 两级：内存 LRU + 可选的磁盘层 (每条一个文件，重启后仍有效)
+// 磁盘读写都不持锁：命中先返回 PCM，要落盘的条目排队，等 PersistPending 在空闲时写
+// ==========================================
+
+using TtsPcm = std::shared_ptr<const std::vector<int16_t>>;
+
+class TtsCache {
+public:
+    static TtsCache& Instance() {
+        static TtsCache instance;
+        return instance;
+    }
+
+    // 超过这个长度 (UTF-8 字节) 的句子基本不会重复，不缓存
+    static constexpr size_t kMaxTextBytes = 96;
+    static constexpr size_t kMemoryBytes = 4 << 20;  // 内存层上限，约 90 秒 22050Hz 音频
+    static constexpr size_t kDiskBytes = 32 << 20;   // 磁盘层上限
+
+    // 换模型时调用：指纹由模型目录下文件的 名字/大小/修改时间 得出，旧条目自然失效
+    // cache_dir 为空则只用内存层
+    void Configure(const std::string& model_dir, const std::string& cache_dir);
+
+    // 规范化后的缓存键，文本过长或为空时返回空串 (不缓存)
+    std::string MakeKey(const std::string& text, int32_t sid, float speed) const;
+
+    // 先查内存再查磁盘，磁盘命中会提升到内存层
+    TtsPcm Lookup(const std::string& key);
+
+    // 第二次用到的句子和预加载的句子才写磁盘，一次性的回复只进内存
+    // 这里只把要写的条目排队，不碰磁盘
+    void Insert(const std::string& key, std::vector<int16_t> pcm, bool persist);
+
+    // 把排队的条目写到磁盘，由 TTS 线程在空闲时调用
+    void PersistPending();
+
+private:
+    TtsCache() = default;
+
+    struct Entry {
+        std::string key;
+        TtsPcm pcm;
+        bool on_disk = false;  // 已落盘或已排队等待落盘
+    };
+
+    static std::string PathOf(const std::string& dir, uint64_t fingerprint, const std::string& key);
+    static TtsPcm ReadFile(const std::string& path, const std::string& key);
+    // 成功返回文件字节数，失败返回 0
+    static size_t WriteFile(const std::string& path, const std::string& key, const std::vector<int16_t>& pcm);
+    // 超出上限的磁盘文件放进 doomed，由调用方放锁后删除
+    void EvictLocked(std::vector<std::string>* doomed);
+
+    std::mutex mtx;
+    // MakeKey 不持锁读，其余成员都由 mtx 保护
+    std::atomic<uint64_t> model_fingerprint{0};
+    std::string dir;
+
+    // 等待落盘的条目
+    std::vector<std::pair<std::string, TtsPcm>> pending_writes;
+
+    // 内存层：表头最近使用
+    std::list<Entry> lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t memory_bytes = 0;
+
+    // 磁盘层：按写入先后淘汰 (文件名, 字节数)
+    std::list<std::pair<std::string, size_t>> files;
+    size_t disk_bytes = 0;
+};
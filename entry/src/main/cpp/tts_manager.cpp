@@ -3,14 +3,27 @@
 #include "sherpa-ncnn/csrc/offline-tts.h"
 #include "sherpa-ncnn/csrc/offline-tts-model-config.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model-config.h" 
+#include "native_events.h"
+#include "spsc_ring_buffer.h"
+#include "pcm_utils.h"
+#include "cpu_budget.h"
+#include "latency_tracer.h"
+#include "tts_cache.h"
 
 #include <hilog/log.h>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <deque>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
 #include <unistd.h>
 #include <stdlib.h> 
 
@@ -24,72 +37,361 @@
 // ==========================================
 // 全局静态资源
 // ==========================================
+
+// 每个客户端一路合成：独立的文本队列、PCM 缓冲和打断计数，共享同一个模型
+struct TtsClient {
+    std::string id;
+    std::deque<std::string> texts;          // g_tts_mutex 保护
+    // TTS 线程写、JS 线程读的预分配 PCM 环形缓冲 (2^20 点)
+    SpscRingBuffer<int16_t> pcm{1 << 20};
+    std::atomic<uint32_t> epoch{0};         // Stop() 时递增，丢弃打断前正在合成的音频
+    // 打断时缓冲里没播的音频交给消费端 (PeekAudio) 丢弃：Stop 可能在 ASR 线程调用，不能碰读位置
+    std::atomic<bool> discard_pending{false};
+    std::atomic<size_t> discard_position{0}; // 打断时生产者的写位置
+    // 缓冲满时 TTS 线程在这里等 JS 取走数据，取走、丢弃、打断、释放时通知
+    std::mutex space_mtx;
+    std::condition_variable space_cv;
+
+    // 两个工作线程可能同时合成同一会话的相邻两句：按出队序号重排，保证播放顺序
+    struct Held {
+        std::vector<int16_t> pcm;           // 还没轮到它时合成好的部分
+        bool done = false;                  // 整句已合成完
+    };
+    uint64_t next_seq = 0;                  // 下一句的序号，g_tts_mutex 保护
+    std::mutex order_mtx;                   // 保护下面两项；加锁顺序：g_tts_mutex -> order_mtx
+    uint64_t play_seq = 0;                  // 当前可以直接送出的句子
+    std::map<uint64_t, Held> held;
+};
+
+// 两个工作线程都在 Init 时启动，第二个只在 TTS 此刻分到 2 个核以上时接句子
+static const int kMaxTtsWorkers = 2;
+// 一句话里最多提前几个分句跑声学模型 (每个分句一个线程，占一份核)
+static const int kMaxTtsAhead = 2;
+
 static sherpa_ncnn::OfflineTts* g_tts = nullptr;
 static std::mutex g_tts_mutex;
-static std::deque<std::string> g_text_queue;       
-static std::deque<int16_t> g_pcm_buffer;           
+static std::condition_variable g_tts_cv; // 有新文本时唤醒 TTS 线程
+// Generate 持共享锁；SetNumThreads 改的是所有网络共用的 opt，只在没有合成进行时 (独占锁) 改
+static std::shared_mutex g_tts_model_mutex;
+static std::atomic<int> g_tts_pending_threads{0};  // 还没来得及设置的线程数
+static std::atomic<int> g_tts_synthesizing{0};     // 正在跑 Generate 的工作线程数
+// 已出队还没处理完的句子数 (含缓存命中和预加载) 及其最近一次归零的时间，g_tts_mutex 保护
+static int g_tts_busy = 0;
+static std::chrono::steady_clock::time_point g_tts_idle_since;
+static std::unordered_map<std::string, std::shared_ptr<TtsClient>> g_tts_clients;
+// 有待合成文本的会话，按轮转顺序排队：每次只合成队首会话的一句，没合成完就排回队尾
+static std::deque<std::string> g_ready_sessions;
+// 预加载的常用句：没有会话要合成时才处理，结果直接进缓存 (g_tts_mutex 保护)
+static std::deque<std::string> g_preload_texts;
 static std::atomic<bool> g_tts_running = false;
-static std::thread* g_tts_thread = nullptr;
+static std::thread* g_tts_threads[kMaxTtsWorkers] = {};
+
+// 取 (或新建) 会话，调用方持有 g_tts_mutex
+static std::shared_ptr<TtsClient> GetClientLocked(const std::string& id, bool create) {
+    auto it = g_tts_clients.find(id);
+    if (it != g_tts_clients.end()) return it->second;
+    if (!create) return nullptr;
+    auto client = std::make_shared<TtsClient>();
+    client->id = id;
+    g_tts_clients[id] = client;
+    return client;
+}
+
+// 按轮转顺序取下一句并给出它在会话内的序号，调用方持有 g_tts_mutex
+static std::shared_ptr<TtsClient> NextSentenceLocked(std::string* text, uint64_t* seq) {
+    while (!g_ready_sessions.empty()) {
+        std::string id = g_ready_sessions.front();
+        g_ready_sessions.pop_front();
+        std::shared_ptr<TtsClient> client = GetClientLocked(id, false);
+        // 会话已释放或被打断清空
+        if (!client || client->texts.empty()) continue;
+        *text = client->texts.front();
+        *seq = client->next_seq++;
+        client->texts.pop_front();
+        if (!client->texts.empty()) g_ready_sessions.push_back(id);
+        return client;
+    }
+    return nullptr;
+}
+
+// 唤醒等缓冲空间的 TTS 线程
+static void WakeWriter(TtsClient* c) {
+    std::lock_guard<std::mutex> lock(c->space_mtx);
+    c->space_cv.notify_all();
+}
+
+// 把一段 PCM 交给会话：注册了 onAudioChunk 就直接推送，否则写入会话的环形缓冲留给 getTtsAudio
+// 被打断或线程退出时返回 false
+static bool DeliverPcm(TtsClient* c, uint32_t epoch, const int16_t* pcm, size_t n) {
+    if (epoch != c->epoch) return false;
+    LatencyTracer::Instance().Mark(c->id, TURN_FIRST_PCM);
+    LatencyTracer::Instance().Mark(c->id, TURN_LAST_PCM);
+
+    if (EmitAudioChunk(pcm, n, c->id)) return true;
+
+    size_t written = 0;
+    while (written < n) {
+        written += c->pcm.Write(pcm + written, n - written);
+        if (written < n) {
+            // 缓冲满：等 JS 取走，不轮询
+            std::unique_lock<std::mutex> lock(c->space_mtx);
+            c->space_cv.wait(lock, [c, epoch] {
+                return c->pcm.Size() < c->pcm.Capacity() || epoch != c->epoch || !g_tts_running;
+            });
+            if (epoch != c->epoch || !g_tts_running) return false;
+        }
+    }
+    return true;
+}
+
+// 按句子顺序送出：轮到这句就直接送，否则先存起来，等前面的句子送完再由 FinishSentence 送出
+static bool EmitOrdered(TtsClient* c, uint64_t seq, uint32_t epoch, const int16_t* pcm, size_t n) {
+    {
+        std::lock_guard<std::mutex> lock(c->order_mtx);
+        if (epoch != c->epoch) return false;
+        if (seq != c->play_seq) {
+            std::vector<int16_t>& buf = c->held[seq].pcm;
+            buf.insert(buf.end(), pcm, pcm + n);
+            return true;
+        }
+    }
+    // 只有本句自己的线程会把 play_seq 推过 seq，这里不用持锁
+    return DeliverPcm(c, epoch, pcm, n);
+}
+
+// 一句合成结束 (包括失败和被打断)：还没轮到就记为完成；
+// 轮到了就依次送出后面已经攒下的句子，最后把播放权交给第一个还没合成完的句子
+static void FinishSentence(TtsClient* c, uint64_t seq, uint32_t epoch) {
+    std::unique_lock<std::mutex> lock(c->order_mtx);
+    if (epoch != c->epoch) return;
+    if (seq != c->play_seq) {
+        c->held[seq].done = true;
+        return;
+    }
+
+    uint64_t next = seq + 1;
+    while (true) {
+        auto it = c->held.find(next);
+        if (it == c->held.end() || (it->second.pcm.empty() && !it->second.done)) {
+            // 下一句还在合成且没有积压：之后它自己直接送
+            if (it != c->held.end()) c->held.erase(it);
+            c->play_seq = next;
+            return;
+        }
+
+        std::vector<int16_t> pcm = std::move(it->second.pcm);
+        it->second.pcm.clear();
+        bool done = it->second.done;
+        if (done) c->held.erase(it);
+
+        // 送的时候放锁，下一句的线程可以继续往积压里追加
+        lock.unlock();
+        bool ok = pcm.empty() || DeliverPcm(c, epoch, pcm.data(), pcm.size());
+        lock.lock();
+        if (!ok || epoch != c->epoch) return;
+        if (done) next++;
+    }
+}
+
+// 线程数先记下，等没有合成在进行时再设置，避免和正在创建的 extractor 抢 opt
+// 另一个线程正在合成时设置不了，记下的值留着，由它合成完离开 SynthesisScope 时补上
+static void ApplyPendingThreads() {
+    int threads = g_tts_pending_threads.load();
+    if (threads <= 0) return;
+    std::unique_lock<std::shared_mutex> lock(g_tts_model_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    if (g_tts_pending_threads.compare_exchange_strong(threads, 0)) g_tts->SetNumThreads(threads);
+}
+
+// 一次合成的计数：离开时 (包括 Generate 抛异常) 减一，再试着设置没来得及设置的线程数
+// 要在 Generate 的共享锁之外构造，析构时才拿得到独占锁
+struct SynthesisScope {
+    int count; // 加上自己此刻在合成的个数
+    SynthesisScope() : count(++g_tts_synthesizing) {}
+    ~SynthesisScope() {
+        g_tts_synthesizing--;
+        ApplyPendingThreads();
+    }
+};
+
+// 此刻 TTS 分到的核够几个工作线程接句子：每个线程至少一个核
+// RK3568 (4 核) 边生成边播报时 TTS 只有 1 个核，顺序合成；LLM 生成完、只剩播报时分到 3 个核才并行
+static int ActiveTtsWorkers() {
+    return std::min(kMaxTtsWorkers, CpuBudget::Instance().Threads(CPU_ENGINE_TTS));
+}
 
 // ==========================================
 // 后台线程
 // ==========================================
-void TtsBackgroundWorker() {
-    LOGI("🧵 TTS 后台线程启动 (ModelDir Mode)");
-    
-    // RK3568 32位系统优化环境变量 (必加!)
-    setenv("NCNN_USE_FP16_PACKED", "0", 1);
-    setenv("NCNN_USE_FP16_STORAGE", "0", 1);
-    setenv("NCNN_USE_FP16_ARITHMETIC", "0", 1); 
-    setenv("NCNN_CPU_POWERSAVE", "0", 1);
-    setenv("OMP_NUM_THREADS", "1", 1); 
+
+// 处理出队的一句：先查缓存，没命中再合成。c 为空表示预加载
+static void RunSentence(TtsClient* c, const std::string& text, uint64_t seq, uint32_t epoch,
+                        bool preload, uint32_t* budget_gen) {
+    if (text.empty()) {
+        if (c) FinishSentence(c, seq, epoch);
+        return;
+    }
+
+    // 合成前先查缓存：命中就直接送出，不占 CPU 预算也不跑 VITS
+    const int32_t sid = 0;
+    const float speed = 1.2f;
+    TtsCache& cache = TtsCache::Instance();
+    std::string key = cache.MakeKey(text, sid, speed);
+    if (TtsPcm cached = cache.Lookup(key)) {
+        if (c) {
+            EmitOrdered(c, seq, epoch, cached->data(), cached->size());
+            FinishSentence(c, seq, epoch);
+        }
+        return;
+    }
+
+    if (g_tts) {
+        CpuBudget& budget = CpuBudget::Instance();
+        SynthesisScope synthesizing;
+        budget.SetActive(CPU_ENGINE_TTS, true);
+        int threads = 0;
+        if (budget.Poll(CPU_ENGINE_TTS, budget_gen, &threads)) {
+            budget.ApplyAffinity(CPU_ENGINE_TTS, threads);
+            // 分到的核变了：闲着的工作线程可能可以接队列里的下一句了
+            std::lock_guard<std::mutex> lock(g_tts_mutex);
+            g_tts_cv.notify_all();
+        }
+        // TTS 的核按此刻真正在跑的合成平分；每一路还有多的核，就让这句的后几个分句
+        // 在前瞻线程上提前跑声学模型，每个前瞻线程也算一份
+        int share = std::max(1, budget.Threads(CPU_ENGINE_TTS) / synthesizing.count);
+        int num_ahead = std::min(kMaxTtsAhead, share - 1);
+        g_tts_pending_threads = std::max(1, share / (num_ahead + 1));
+        ApplyPendingThreads();
+
+        // 使用 TtsArgs 传参
+        sherpa_ncnn::TtsArgs args;
+        args.text = text;
+        args.sid = sid;
+        args.speed = speed;
+        args.num_ahead = num_ahead;
+
+        // 每解码完一窗（短句为整句）就回调一次，按句子顺序送出这段音频
+        // 可缓存的短句顺便攒下整句 PCM，完整合成后写入缓存
+        std::vector<int16_t> pcm;
+        std::vector<int16_t> full;
+        bool stopped = false;
+        auto on_sentence = [&](const float* samples, int32_t n, int32_t, int32_t, void*) -> int32_t {
+            // 合成期间被打断：丢弃并停止剩余分句
+            if (c && epoch != c->epoch) {
+                stopped = true;
+                return 0;
+            }
+            if (n <= 0) return 1;
+
+            pcm.resize(n);
+            FloatToInt16(samples, pcm.data(), n);
+            if (!key.empty()) full.insert(full.end(), pcm.begin(), pcm.end());
+
+            if (preload || EmitOrdered(c, seq, epoch, pcm.data(), pcm.size())) return 1;
+            stopped = true;
+            return 0;
+        };
+
+        {
+            std::shared_lock<std::shared_mutex> model_lock(g_tts_model_mutex);
+            g_tts->Generate(args, on_sentence);
+        }
+
+        // 被打断的句子不完整，不缓存；预加载本来就在空闲时做，顺手落盘
+        if (!stopped) cache.Insert(key, std::move(full), preload);
+        if (preload) cache.PersistPending();
+    }
+    if (c) FinishSentence(c, seq, epoch);
+}
+
+void TtsBackgroundWorker(int worker) {
+    LOGI("🧵 TTS 后台线程 %{public}d 启动 (ModelDir Mode)", worker);
+
+    // 线程数和绑核交给 CPU 预算，不再改进程级的 OMP_NUM_THREADS
+    CpuBudget& budget = CpuBudget::Instance();
+    budget.RegisterCurrentThread(CPU_ENGINE_TTS);
+    uint32_t budget_gen = 0;
+    // 线程 0 上次交还核心时的空闲时间点，之后没有新句子就不用再交还
+    std::chrono::steady_clock::time_point released_at;
+    bool released = false;
 
     while (g_tts_running) {
         std::string current_text = "";
+        std::shared_ptr<TtsClient> client;
+        uint32_t epoch = 0;
+        uint64_t seq = 0;
+        bool preload = false;
         
         {
-            std::lock_guard<std::mutex> lock(g_tts_mutex);
-            if (!g_text_queue.empty()) {
-                current_text = g_text_queue.front();
-                g_text_queue.pop_front();
+            // 队列为空时阻塞等待，不再 20ms 轮询
+            std::unique_lock<std::mutex> lock(g_tts_mutex);
+            // 预加载只由第一个线程做；第二个线程在 TTS 分到的核不够时不接句子
+            auto has_work = [worker] {
+                if (!g_tts_running) return true;
+                if (worker == 0) return !g_ready_sessions.empty() || !g_preload_texts.empty();
+                return !g_ready_sessions.empty() && worker < ActiveTtsWorkers();
+            };
+            if (worker == 0) {
+                // 句子之间的短暂空档不算结束播报：没有句子在处理、队列也空了 300ms，才把核心还给其他引擎
+                // 只有第一个线程做这件事，第二个线程空闲时一直睡着
+                while (!has_work()) {
+                    // 别的线程还在处理句子 (结束时会通知)，或者这段空闲已经交还过
+                    if (g_tts_busy > 0 || (released && released_at == g_tts_idle_since)) {
+                        g_tts_cv.wait(lock);
+                        continue;
+                    }
+                    auto deadline = g_tts_idle_since + std::chrono::milliseconds(300);
+                    if (std::chrono::steady_clock::now() < deadline) {
+                        g_tts_cv.wait_until(lock, deadline);
+                        continue;
+                    }
+                    budget.SetActive(CPU_ENGINE_TTS, false);
+                    released = true;
+                    released_at = g_tts_idle_since;
+                    // 空闲时才把排队的常用句落盘，不拖慢命中的那一句
+                    lock.unlock();
+                    TtsCache::Instance().PersistPending();
+                    lock.lock();
+                }
+            } else {
+                g_tts_cv.wait(lock, has_work);
             }
+            if (!g_tts_running) break;
+            client = NextSentenceLocked(&current_text, &seq);
+            if (client) {
+                epoch = client->epoch;
+            } else if (worker == 0 && !g_preload_texts.empty()) {
+                current_text = g_preload_texts.front();
+                g_preload_texts.pop_front();
+                preload = true;
+            } else {
+                continue;
+            }
+            // 出队时就记为忙，和线程 0 的空闲判断在同一把锁下，不会有空档
+            g_tts_busy++;
         }
 
-        if (current_text.empty()) {
-            usleep(20000); 
-            continue;
-        }
+        RunSentence(client.get(), current_text, seq, epoch, preload, &budget_gen);
 
-        if (g_tts) {
-            // 使用 TtsArgs 传参
-            sherpa_ncnn::TtsArgs args;
-            args.text = current_text;
-            args.sid = 0;      
-            args.speed = 1.2f; 
-            
-            auto audio = g_tts->Generate(args);
-            
-            if (!audio.samples.empty()) {
-                std::lock_guard<std::mutex> lock(g_tts_mutex);
-                
-                // float -> int16
-                for (float s : audio.samples) {
-                    if (s > 1.0f) s = 1.0f;
-                    if (s < -1.0f) s = -1.0f;
-                    int16_t val = static_cast<int16_t>(s * 32767.0f);
-                    g_pcm_buffer.push_back(val);
-                }
+        bool idle = false;
+        {
+            std::lock_guard<std::mutex> lock(g_tts_mutex);
+            if (--g_tts_busy == 0) {
+                g_tts_idle_since = std::chrono::steady_clock::now();
+                idle = true;
             }
         }
+        // 让线程 0 从这一刻开始计空闲时间
+        if (idle) g_tts_cv.notify_all();
     }
-    LOGI("🛑 TTS 线程退出");
+    LOGI("🛑 TTS 线程 %{public}d 退出", worker);
 }
 
 // ==========================================
 // TtsManager 实现
 // ==========================================
 
-bool TtsManager::Init(const std::string& modelPath) {
+bool TtsManager::Init(const std::string& modelPath, const std::string& cacheDir) {
     std::lock_guard<std::mutex> lock(g_tts_mutex);
     if (g_tts) return true;
 
@@ -103,9 +405,12 @@ bool TtsManager::Init(const std::string& modelPath) {
     config.model.vits.model_dir = modelPath; 
 
     // 性能配置
-    config.model.num_threads = 1; 
+    config.model.num_threads = CpuBudget::Instance().Threads(CPU_ENGINE_TTS);
     config.model.debug = 0;
 
+    // 长句按 32 帧（约 0.37 秒音频）一窗分块解码，首包不必等整句解码完
+    config.decoder_chunk_size = 32;
+
     // 简单校验目录是否存在
     if (access(modelPath.c_str(), F_OK) != 0) {
         LOGE("❌ 模型目录缺失: %{public}s", modelPath.c_str());
@@ -114,11 +419,20 @@ bool TtsManager::Init(const std::string& modelPath) {
 
     try {
         g_tts = new sherpa_ncnn::OfflineTts(config);
+        TtsCache::Instance().Configure(modelPath, cacheDir);
         
         if (!g_tts_running) {
+            // RK3568 32位系统优化环境变量 (必加!)，在工作线程启动前设置
+            setenv("NCNN_USE_FP16_PACKED", "0", 1);
+            setenv("NCNN_USE_FP16_STORAGE", "0", 1);
+            setenv("NCNN_USE_FP16_ARITHMETIC", "0", 1);
+            setenv("NCNN_CPU_POWERSAVE", "0", 1);
+
             g_tts_running = true;
-            g_tts_thread = new std::thread(TtsBackgroundWorker);
-            g_tts_thread->detach();
+            for (int i = 0; i < kMaxTtsWorkers; i++) {
+                g_tts_threads[i] = new std::thread(TtsBackgroundWorker, i);
+                g_tts_threads[i]->detach();
+            }
         }
         
         LOGI("✅ TTS Init OK");
@@ -132,30 +446,90 @@ bool TtsManager::Init(const std::string& modelPath) {
     }
 }
 
-void TtsManager::PushText(const std::string& text) {
+void TtsManager::PushText(const std::string& sessionId, const std::string& text) {
     if (text.empty()) return;
-    std::lock_guard<std::mutex> lock(g_tts_mutex);
-    g_text_queue.push_back(text);
+    LatencyTracer::Instance().Mark(sessionId, TURN_FIRST_SENTENCE);
+    {
+        std::lock_guard<std::mutex> lock(g_tts_mutex);
+        std::shared_ptr<TtsClient> client = GetClientLocked(sessionId, true);
+        // 队列从空变为非空时才排进轮转队列，避免同一会话重复排队
+        if (client->texts.empty()) g_ready_sessions.push_back(sessionId);
+        client->texts.push_back(text);
+    }
+    // 第二个工作线程可能因为核不够不接句子，只唤醒一个可能落到它身上
+    g_tts_cv.notify_all();
 }
 
-std::vector<int16_t> TtsManager::PopAudio() {
-    std::vector<int16_t> chunk;
-    std::lock_guard<std::mutex> lock(g_tts_mutex);
-    if (g_pcm_buffer.empty()) return chunk;
+size_t TtsManager::Preload(const std::vector<std::string>& texts) {
+    size_t n = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_tts_mutex);
+        for (const auto& text : texts) {
+            if (text.empty()) continue;
+            g_preload_texts.push_back(text);
+            n++;
+        }
+    }
+    // 预加载只由线程 0 做，只唤醒一个可能落到线程 1 身上
+    if (n) g_tts_cv.notify_all();
+    return n;
+}
+
+size_t TtsManager::PeekAudio(const std::string& sessionId, size_t max,
+                             const int16_t** p1, size_t* n1, const int16_t** p2, size_t* n2) {
+    std::shared_ptr<TtsClient> client;
+    {
+        std::lock_guard<std::mutex> lock(g_tts_mutex);
+        client = GetClientLocked(sessionId, false);
+    }
+    if (!client) return 0;
+    // 先执行打断留下的丢弃，读位置只在 JS 线程移动
+    if (client->discard_pending.exchange(false)) {
+        client->pcm.DiscardTo(client->discard_position.load());
+        WakeWriter(client.get());
+    }
+    // 环形缓冲归会话所有，Release 只在 JS 线程调用，返回的指针在本次 JS 调用内有效
+    return client->pcm.Peek(max, p1, n1, p2, n2);
+}
 
-    size_t fetch_size = std::min((size_t)8192, g_pcm_buffer.size());
-    chunk.reserve(fetch_size);
+void TtsManager::ConsumeAudio(const std::string& sessionId, size_t n) {
+    std::shared_ptr<TtsClient> client;
+    {
+        std::lock_guard<std::mutex> lock(g_tts_mutex);
+        client = GetClientLocked(sessionId, false);
+    }
+    if (!client) return;
+    client->pcm.Consume(n);
+    WakeWriter(client.get());
+}
 
-    for (size_t i = 0; i < fetch_size; ++i) {
-        chunk.push_back(g_pcm_buffer.front());
-        g_pcm_buffer.pop_front();
+void TtsManager::Stop(const std::string& sessionId) {
+    std::lock_guard<std::mutex> lock(g_tts_mutex);
+    std::shared_ptr<TtsClient> client = GetClientLocked(sessionId, false);
+    if (!client) return;
+    client->texts.clear();
+    {
+        // 已出队但还没送完的句子全部作废，之后出队的句子从 next_seq 开始排
+        std::lock_guard<std::mutex> order_lock(client->order_mtx);
+        client->epoch++;
+        client->play_seq = client->next_seq;
+        client->held.clear();
     }
-    return chunk;
+    // Stop 可能在 ASR 线程 (端点定稿 -> LlmSubmit) 调用，不是环形缓冲的消费端：
+    // 只记下写位置，由 JS 线程下次 getTtsAudio 时丢弃
+    client->discard_position = client->pcm.WritePosition();
+    client->discard_pending = true;
+    WakeWriter(client.get());
+    LOGI("🚫 TTS Queue Cleared [%{public}s]", sessionId.c_str());
 }
 
-void TtsManager::Stop() {
+void TtsManager::Release(const std::string& sessionId) {
     std::lock_guard<std::mutex> lock(g_tts_mutex);
-    g_text_queue.clear();
-    g_pcm_buffer.clear();
-    LOGI("🚫 TTS Queue Cleared");
-}
\ No newline at end of file
+    auto it = g_tts_clients.find(sessionId);
+    if (it == g_tts_clients.end()) return;
+    // 正在合成的句子持有 shared_ptr，epoch 变化后会尽快返回
+    it->second->texts.clear();
+    it->second->epoch++;
+    WakeWriter(it->second.get());
+    g_tts_clients.erase(it);
+}
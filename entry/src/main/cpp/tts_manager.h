@@ -3,6 +3,7 @@
 #include <vector>
 #include <queue>
 #include <mutex>
+#include <thread>
 #include <condition_variable>
 #include <atomic>
 #include "sherpa-ncnn/csrc/offline-tts.h"
@@ -14,17 +15,26 @@ public:
         return instance;
     }
 
-    // 初始化模型
-    bool Init(const std::string& modelPath);
+    // 初始化模型；cacheDir 非空时合成结果缓存带磁盘层，常用句重启后仍然命中
+    bool Init(const std::string& modelPath, const std::string& cacheDir = "");
     
-    // 输入待合成文本（由 LLM 线程调用）
-    void PushText(const std::string& text);
+    // 输入待合成文本（由 LLM 线程调用），每个会话有自己的文本队列和音频缓冲
+    void PushText(const std::string& sessionId, const std::string& text);
+
+    // 预加载常用句 (问候、报错提示等)：空闲时合成并写入缓存，返回排队的句数
+    size_t Preload(const std::vector<std::string>& texts);
     
-    // 获取合成好的音频数据（由 JS 轮询调用）
-    std::vector<int16_t> PopAudio();
+    // 获取合成好的音频数据（未注册 onAudioChunk 时由 JS 轮询调用）
+    // 零拷贝：返回该会话环形缓冲里最多两段连续内存，拷走后调用 ConsumeAudio
+    size_t PeekAudio(const std::string& sessionId, size_t max,
+                     const int16_t** p1, size_t* n1, const int16_t** p2, size_t* n2);
+    void ConsumeAudio(const std::string& sessionId, size_t n);
+
+    // 停止并清理（打断机制），只影响这个会话
+    void Stop(const std::string& sessionId);
 
-    // 停止并清理（打断机制）
-    void Stop();
+    // 客户端断开：停止并释放会话的队列和缓冲
+    void Release(const std::string& sessionId);
 
 private:
     TtsManager() : g_running(false), tts_thread(nullptr) {}
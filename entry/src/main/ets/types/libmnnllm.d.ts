@@ -1,6 +1,45 @@
+export interface SamplingParams {
+  temperature?: number;
+  topK?: number;
+  topP?: number;
+  minP?: number;
+  penaltyLastN?: number;
+  repeatPenalty?: number;
+  frequencyPenalty?: number;
+  presencePenalty?: number;
+  seed?: number;
+}
+
 export interface MNNNativeAPI {
-  nativeLoad(modelPath: string): boolean;
-  nativeChat(question: string, onToken: (token: string) => void): string;
+  nativeLoad(modelPath: string, cacheDir?: string): boolean;
+  nativeChat(question: string, sessionId?: string, onToken?: (token: string, sessionId: string) => void): string;
+  setSystemPrompt(text: string): boolean;
+  releaseLlmSession(sessionId: string): boolean;
+  setSamplingParams(sessionId: string, params: SamplingParams): boolean;
+  benchmarkSampling(nVocab?: number, iterations?: number): string;
+  releaseSession(sessionId: string): boolean;
+  getCpuStats(): string;
+  // JSON: { turns, stages, llama, ncnn }
+  getMetrics(): string;
+  getLlmResult(sessionId?: string): string;
+  acceptWaveform(pcm: ArrayBuffer, sessionId?: string): string;
+  resetSherpa(sessionId?: string): void;
+  // 说完：C++ 取完已收到的音频后定稿，结果经 onFinal("asr", ...) 推送并直接交给 LLM
+  finishSherpa(sessionId?: string): void;
+  getRecognizedText(sessionId?: string): string;
+  getQueueSize(sessionId?: string): number;
+  // 传 cacheDir 时常用句的合成结果会落盘，重启后仍然命中
+  initTts(modelPath: string, cacheDir?: string): boolean;
+  // TTS 空闲时把这些句子合成进缓存，返回排队的句数
+  preloadTts(texts: string[]): number;
+  getTtsAudio(sessionId?: string): ArrayBuffer | undefined;
+  stopTts(sessionId?: string): number;
+  onToken(cb: ((token: string, sessionId: string) => void) | null): boolean;
+  onAudioChunk(cb: ((pcm: ArrayBuffer, sessionId: string) => void) | null): boolean;
+  onPartialTranscript(cb: ((text: string, sessionId: string) => void) | null): boolean;
+  onFinal(cb: ((source: string, text: string, sessionId: string) => void) | null): boolean;
+  // 需要 initSherpa 时传入 VAD 模型目录，state 为 "start" / "end"
+  onVad(cb: ((state: string, sessionId: string) => void) | null): boolean;
 }
 
 declare module 'libmnnllm.so' {